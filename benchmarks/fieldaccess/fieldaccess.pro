@@ -0,0 +1,33 @@
+#-------------------------------------------------
+#
+# Microbenchmark of the native decoder field accessors
+#
+#-------------------------------------------------
+
+QT       += core concurrent
+
+QT       -= gui
+
+TARGET = fieldaccess
+CONFIG   += console
+CONFIG   -= app_bundle
+CONFIG += link_pkgconfig
+
+TEMPLATE = app
+
+ROOT = $$PWD/../..
+
+SOURCES += main.cpp \
+    $$ROOT/src/common/packetindex.cpp \
+    $$ROOT/src/common/streamfilepool.cpp \
+    $$ROOT/src/common/tracemetadata.cpp \
+    $$ROOT/src/common/traceindex.cpp \
+    $$ROOT/src/ctf/ctfmetadata.cpp \
+    $$ROOT/src/ctf/ctftrace.cpp
+
+QMAKE_CXXFLAGS += -fpermissive
+QMAKE_CXXFLAGS += -std=gnu++0x
+QMAKE_CXXFLAGS_RELEASE += -O2
+
+INCLUDEPATH += $$ROOT/src
+DEPENDPATH += $$ROOT/src
@@ -0,0 +1,166 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmark of the field accessors of the native decoder: reads the
+ * sched_switch and syscall fields used by the CPU and I/O analyses, once
+ * looking them up by name and once through precompiled handles, and
+ * prints the time spent per event for each.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "ctf/ctftrace.h"
+
+enum class Access { NONE, NAME, HANDLE };
+
+/* Handles of one event class, each channel has its own */
+struct Handles {
+    bool isSchedSwitch = false;
+    bool isSyscall = false;
+    CtfFieldHandle prevTid;
+    CtfFieldHandle nextTid;
+    CtfFieldHandle prevComm;
+    CtfFieldHandle tid;
+    CtfFieldHandle procname;
+    CtfFieldHandle ret;
+};
+
+static const std::vector<std::string> syscalls = {"syscall_entry_read", "syscall_entry_write",
+                                                  "syscall_exit_read", "syscall_exit_write"};
+
+struct Result {
+    uint64_t schedSwitch = 0;
+    uint64_t syscall = 0;
+    uint64_t checksum = 0;
+    double seconds = 0;
+};
+
+static Result run(const CtfTrace &trace, const CtfProjection &projection,
+                  const std::vector<Handles> &eventHandles, Access access)
+{
+    Result result;
+    auto start = std::chrono::steady_clock::now();
+    CtfTrace::Iterator iter = trace.between(nullptr, nullptr, projection);
+    CtfTrace::Iterator endIter = trace.end();
+    for ((void)iter; iter != endIter; ++iter) {
+        const CtfEvent &event = *iter;
+        const Handles &handles = eventHandles[event.getEventClass().index];
+        if (handles.isSchedSwitch) {
+            result.schedSwitch++;
+            if (access == Access::NAME) {
+                result.checksum += event.getInteger(CtfScope::FIELDS, "prev_tid")
+                        + event.getInteger(CtfScope::FIELDS, "next_tid")
+                        + event.getString(CtfScope::FIELDS, "prev_comm").size();
+            } else if (access == Access::HANDLE) {
+                result.checksum += event.getInteger(handles.prevTid) + event.getInteger(handles.nextTid)
+                        + event.getString(handles.prevComm).size();
+            }
+            continue;
+        }
+        if (handles.isSyscall) {
+            result.syscall++;
+            if (access == Access::NAME) {
+                result.checksum += event.getInteger(CtfScope::STREAM_EVENT_CONTEXT, "tid")
+                        + event.getString(CtfScope::STREAM_EVENT_CONTEXT, "procname").size()
+                        + event.getInteger(CtfScope::FIELDS, "ret");
+            } else if (access == Access::HANDLE) {
+                result.checksum += event.getInteger(handles.tid)
+                        + event.getString(handles.procname).size()
+                        + event.getInteger(handles.ret);
+            }
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " TRACE_PATH [REPETITIONS]" << std::endl;
+        return 1;
+    }
+    int repetitions = argc > 2 ? std::max(1, atoi(argv[2])) : 5;
+
+    CtfTrace trace;
+    if (!trace.open(QString(argv[1]))) {
+        return 1;
+    }
+
+    CtfProjection projection;
+    projection.addEvent("sched_switch", {"prev_tid", "next_tid", "prev_comm"});
+    std::vector<Handles> eventHandles(trace.getNumEventClasses());
+    for (const CtfEventClass *eventClass : trace.getEventClasses("sched_switch")) {
+        Handles &handles = eventHandles[eventClass->index];
+        handles.isSchedSwitch = true;
+        handles.prevTid = trace.getFieldHandle(*eventClass, CtfScope::FIELDS, "prev_tid");
+        handles.nextTid = trace.getFieldHandle(*eventClass, CtfScope::FIELDS, "next_tid");
+        handles.prevComm = trace.getFieldHandle(*eventClass, CtfScope::FIELDS, "prev_comm");
+    }
+    for (const std::string &name : syscalls) {
+        projection.addEvent(name, {"tid", "procname", "ret"});
+        for (const CtfEventClass *eventClass : trace.getEventClasses(name)) {
+            Handles &handles = eventHandles[eventClass->index];
+            handles.isSyscall = true;
+            handles.tid = trace.getFieldHandle(*eventClass, CtfScope::STREAM_EVENT_CONTEXT, "tid");
+            handles.procname = trace.getFieldHandle(*eventClass, CtfScope::STREAM_EVENT_CONTEXT, "procname");
+            handles.ret = trace.getFieldHandle(*eventClass, CtfScope::FIELDS, "ret");
+        }
+    }
+
+    // Keep the fastest run of each, the first one also warms the page cache
+    Result best[3];
+    for (int i = 0; i < repetitions; i++) {
+        for (Access access : {Access::NONE, Access::NAME, Access::HANDLE}) {
+            Result result = run(trace, projection, eventHandles, access);
+            Result &current = best[static_cast<int>(access)];
+            if (i == 0 || result.seconds < current.seconds) {
+                current = result;
+            }
+        }
+    }
+    if (best[1].checksum != best[2].checksum) {
+        std::cerr << "Error: name and handle accesses read different values" << std::endl;
+        return 1;
+    }
+
+    uint64_t events = best[0].schedSwitch + best[0].syscall;
+    if (events == 0) {
+        std::cerr << "Error: the trace has no sched_switch or syscall events" << std::endl;
+        return 1;
+    }
+    std::cout << events << " events (" << best[0].schedSwitch << " sched_switch, "
+              << best[0].syscall << " syscalls)" << std::endl;
+    const char *names[3] = {"decode only", "by name", "by handle"};
+    for (int i = 0; i < 3; i++) {
+        double nsPerEvent = best[i].seconds * 1e9 / events;
+        double accessNs = (best[i].seconds - best[0].seconds) * 1e9 / events;
+        std::cout << names[i] << ": " << nsPerEvent << " ns/event";
+        if (i > 0) {
+            std::cout << " (" << accessNs << " ns/event for field access)";
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+#-------------------------------------------------
+#
+# Microbenchmark of the CPU and I/O analysis handlers
+#
+#-------------------------------------------------
+
+QT       += core
+
+QT       -= gui
+
+TARGET = handlers
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+ROOT = $$PWD/../..
+
+SOURCES += main.cpp \
+    $$ROOT/src/common/nametable.cpp \
+    $$ROOT/src/cpu/cpucontext.cpp \
+    $$ROOT/src/io/iocontext.cpp \
+    $$ROOT/src/common/latencyhistogram.cpp \
+    $$ROOT/src/common/spacesaving.cpp
+
+QMAKE_LFLAGS += '-Wl,-rpath,\'$$ROOT/contrib/tigerbeetle/contrib/babeltrace/lib/.libs\''
+QMAKE_LFLAGS += '-Wl,-rpath,\'$$ROOT/contrib/tigerbeetle/contrib/babeltrace/formats/ctf/.libs\''
+QMAKE_LFLAGS += '-Wl,-rpath,\'$$ROOT/contrib/tigerbeetle/src/\''
+QMAKE_LFLAGS += '-Wl,-rpath-link,\'$$ROOT/contrib/tigerbeetle/contrib/libdelorean/src\''
+
+QMAKE_CXXFLAGS += -fpermissive
+QMAKE_CXXFLAGS += -std=gnu++0x
+QMAKE_CXXFLAGS_RELEASE += -O2
+
+LIBS += -L$$ROOT/contrib/tigerbeetle/src/ -ltigerbeetle
+
+QMAKE_CXXFLAGS += -isystem$$ROOT/contrib/babeltrace/include
+QMAKE_CXXFLAGS += -isystem$$ROOT/contrib/tigerbeetle/src
+INCLUDEPATH += $$ROOT/contrib/tigerbeetle/src
+INCLUDEPATH += $$ROOT/src
+DEPENDPATH += $$ROOT/src
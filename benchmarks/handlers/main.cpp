@@ -0,0 +1,182 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmark of the CPU and I/O analysis handlers: replays synthetic
+ * sched_switch and syscall records through the per-event handlers and
+ * through the batch handlers, and prints the throughput of each. No trace
+ * is read, so only the cost of the analysis state machines is measured.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "common/recordbatch.h"
+#include "cpu/cpucontext.h"
+#include "io/iocontext.h"
+
+static const int NUM_CPUS = 16;
+static const int NUM_TIDS = 4096;
+
+static std::vector<SchedSwitchRecord> makeSchedSwitches(size_t count, const std::vector<name_id_t> &comms)
+{
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> tids(0, NUM_TIDS - 1);
+    std::vector<int> running(NUM_CPUS, 0);
+    std::vector<SchedSwitchRecord> records(count);
+    uint64_t timestamp = 0;
+    for (SchedSwitchRecord &record : records) {
+        timestamp += 1 + random() % 1000;
+        int cpu = random() % NUM_CPUS;
+        record.timestamp = timestamp;
+        record.cpu = cpu;
+        record.prevTid = running[cpu];
+        record.nextTid = tids(random);
+        record.prevComm = comms[record.prevTid];
+        running[cpu] = record.nextTid;
+    }
+    return records;
+}
+
+static std::vector<SyscallRecord> makeSyscalls(size_t count, const std::vector<name_id_t> &comms)
+{
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> tids(0, NUM_TIDS - 1);
+    name_id_t read = NameTable::instance().intern("syscall_entry_read");
+    name_id_t write = NameTable::instance().intern("syscall_entry_write");
+    std::vector<SyscallRecord> records(count);
+    uint64_t timestamp = 0;
+    for (size_t i = 0; i + 1 < count; i += 2) {
+        // An entry and its exit
+        int tid = tids(random);
+        bool isRead = random() % 2;
+        timestamp += 1 + random() % 1000;
+        records[i] = {timestamp, 0, tid, (int32_t) (random() % 64), comms[tid], isRead ? read : write,
+                      isRead ? IOType::READ : IOType::WRITE, false};
+        timestamp += 1 + random() % 1000;
+        records[i + 1] = {timestamp, (int64_t) (random() % 65536), tid, -1, comms[tid], NameTable::EMPTY,
+                          IOType::UNKNOWN, true};
+    }
+    return records;
+}
+
+/*
+ * Time a run, keeping the fastest of the repetitions.
+ */
+template <typename F>
+static double time(int repetitions, F f)
+{
+    double best = 0;
+    for (int i = 0; i < repetitions; i++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+/*
+ * Hand the records to the batch handler through a RecordBatch, as the
+ * workers do.
+ */
+template <typename Record, typename Handler>
+static void replayBatches(const std::vector<Record> &records, Handler handler)
+{
+    RecordBatch<Record> batch;
+    for (const Record &record : records) {
+        batch.add() = record;
+        if (batch.isFull()) {
+            handler(batch.data(), batch.size());
+            batch.clear();
+        }
+    }
+    handler(batch.data(), batch.size());
+}
+
+static void print(const char *name, size_t count, double seconds)
+{
+    std::cout << name << ": " << count / seconds / 1e6 << " M events/s ("
+              << seconds * 1e9 / count << " ns/event)" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = argc > 1 ? std::max(1, atoi(argv[1])) : 10000000;
+    int repetitions = argc > 2 ? std::max(1, atoi(argv[2])) : 5;
+
+    std::vector<name_id_t> comms;
+    for (int tid = 0; tid < NUM_TIDS; tid++) {
+        comms.push_back(NameTable::instance().intern("task-" + std::to_string(tid)));
+    }
+    std::vector<SchedSwitchRecord> schedSwitches = makeSchedSwitches(count, comms);
+    std::vector<SyscallRecord> syscalls = makeSyscalls(count, comms);
+
+    uint64_t perEventNs = 0, batchNs = 0;
+    double seconds = time(repetitions, [&]() {
+        CpuContext context;
+        for (const SchedSwitchRecord &record : schedSwitches) {
+            context.handleSchedSwitch(record.timestamp, record.cpu, record.prevTid, record.nextTid, record.prevComm);
+        }
+        perEventNs = context.getTopTids(1).front().cpu_ns;
+    });
+    print("sched_switch, per event", count, seconds);
+    seconds = time(repetitions, [&]() {
+        CpuContext context;
+        replayBatches(schedSwitches, [&](const SchedSwitchRecord *records, size_t size) {
+            context.handleSchedSwitches(records, size);
+        });
+        batchNs = context.getTopTids(1).front().cpu_ns;
+    });
+    print("sched_switch, batched", count, seconds);
+
+    uint64_t perEventBytes = 0, batchBytes = 0;
+    seconds = time(repetitions, [&]() {
+        IoContext context;
+        for (const SyscallRecord &record : syscalls) {
+            if (record.isExit) {
+                context.handleSyscallExit(record.timestamp, record.tid, record.comm, record.ret);
+            } else {
+                context.handleSyscallEntry(record.timestamp, record.tid, record.comm, record.name, record.type, record.fd);
+            }
+        }
+        perEventBytes = context.getTopTidsByRead(1).front().readBytes;
+    });
+    print("syscall, per event", count, seconds);
+    seconds = time(repetitions, [&]() {
+        IoContext context;
+        replayBatches(syscalls, [&](const SyscallRecord *records, size_t size) {
+            context.handleSyscalls(records, size);
+        });
+        batchBytes = context.getTopTidsByRead(1).front().readBytes;
+    });
+    print("syscall, batched", count, seconds);
+
+    if (perEventNs != batchNs || perEventBytes != batchBytes) {
+        std::cerr << "Error: the per event and batch handlers disagree" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -19,24 +19,72 @@ TEMPLATE = app
 
 SOURCES += src/main.cpp \
     src/count/countanalysis.cpp \
+    src/countbytype/countbytypeanalysis.cpp \
+    src/countbytype/typecountcontext.cpp \
     src/common/tracewrapper.cpp \
     src/cpu/cpuanalysis.cpp \
     src/cpu/cpucontext.cpp \
     src/io/ioanalysis.cpp \
     src/io/iocontext.cpp \
+    src/sched/schedanalysis.cpp \
+    src/sched/schedcontext.cpp \
     src/common/utils.cpp \
-    src/common/packetindex.cpp
+    src/common/packetindex.cpp \
+    src/common/decompress.cpp \
+    src/common/readahead.cpp \
+    src/common/packetreader.cpp \
+    src/common/streamfilepool.cpp \
+    src/common/tracemetadata.cpp \
+    src/read/readanalysis.cpp \
+    src/columns/columnstore.cpp \
+    src/common/resultcache.cpp \
+    src/extract/extractanalysis.cpp \
+    src/common/traceindex.cpp \
+    src/indexstats/indexstatsanalysis.cpp \
+    src/ctf/ctfmetadata.cpp \
+    src/ctf/ctftrace.cpp \
+    src/common/nametable.cpp \
+    src/common/tracesetcache.cpp \
+    src/common/latencyhistogram.cpp \
+    src/common/spacesaving.cpp
 
 HEADERS += \
     src/count/countanalysis.h \
+    src/countbytype/countbytypeanalysis.h \
+    src/countbytype/typecountcontext.h \
     src/common/traceanalysis.h \
     src/common/tracewrapper.h \
     src/cpu/cpuanalysis.h \
     src/cpu/cpucontext.h \
     src/io/ioanalysis.h \
     src/io/iocontext.h \
+    src/sched/schedanalysis.h \
+    src/sched/schedcontext.h \
     src/common/utils.h \
-    src/common/packetindex.h
+    src/common/packetindex.h \
+    src/common/decompress.h \
+    src/common/readahead.h \
+    src/common/packetreader.h \
+    src/common/streamfilepool.h \
+    src/common/tracemetadata.h \
+    src/read/readanalysis.h \
+    src/columns/columnstore.h \
+    src/common/resultcache.h \
+    src/extract/extractanalysis.h \
+    src/common/traceindex.h \
+    src/indexstats/indexstatsanalysis.h \
+    src/ctf/ctfmetadata.h \
+    src/ctf/ctftrace.h \
+    src/common/eventdispatch.h \
+    src/common/nametable.h \
+    src/common/flatmap.h \
+    src/common/recordbatch.h \
+    src/common/spscqueue.h \
+    src/common/pipeline.h \
+    src/common/tracesetcache.h \
+    src/common/timeseries.h \
+    src/common/latencyhistogram.h \
+    src/common/spacesaving.h
 
 QMAKE_LFLAGS += '-Wl,-rpath,\'$$PWD/contrib/tigerbeetle/contrib/babeltrace/lib/.libs\''
 QMAKE_LFLAGS += '-Wl,-rpath,\'$$PWD/contrib/tigerbeetle/contrib/babeltrace/formats/ctf/.libs\''
@@ -57,6 +105,22 @@ LIBS += -lboost_filesystem -lboost_system
 
 PKGCONFIG += glib-2.0
 
+# Optional decompression of zstd and xz compressed traces
+packagesExist(libzstd) {
+    PKGCONFIG += libzstd
+    DEFINES += HAVE_ZSTD
+}
+packagesExist(liblzma) {
+    PKGCONFIG += liblzma
+    DEFINES += HAVE_LZMA
+}
+
+# Optional io_uring packet reader
+packagesExist(liburing) {
+    PKGCONFIG += liburing
+    DEFINES += HAVE_LIBURING
+}
+
 QMAKE_CXXFLAGS += -isystem$$PWD/contrib/babeltrace/include
 DEPENDPATH += $$PWD/contrib/babeltrace/include
 
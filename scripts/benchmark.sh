@@ -23,7 +23,7 @@ main() {
     for analysis in count cpu io
     do
         out=${analysis}.csv
-        echo "threads,cache_cold,time" > $out
+        echo "threads,cache_cold,cold_cache_policy,time" > $out
         local t=
         for (( t=1; t<=max_threads; t=t*2 ))
         do
@@ -32,11 +32,15 @@ main() {
             echo -e "${blue}Cache cold${NC}"
             ms=$(./cache_cold.sh $program $args $trace_dir | awk '/Analysis time/{ print $NF; }')
             echo -e "$ms ms"
-            echo "$t,1,$ms" >> $out
+            echo "$t,1,0,$ms" >> $out
+            echo -e "${blue}Cache cold (cold cache I/O policy)${NC}"
+            ms=$(./cache_cold.sh $program $args --cold-cache $trace_dir | awk '/Analysis time/{ print $NF; }')
+            echo -e "$ms ms"
+            echo "$t,1,1,$ms" >> $out
             echo -e "${red}Cache hot${NC}"
             ms=$($program $args $trace_dir | awk '/Analysis time/{ print $NF; }')
             echo -e "$ms ms"
-            echo "$t,0,$ms" >> $out
+            echo "$t,0,0,$ms" >> $out
             echo $separator
         done
     done
@@ -0,0 +1,73 @@
+#!/bin/bash
+
+# Compares the analysis time of a raw trace with compressed copies of it
+main() {
+    if [[ $EUID -ne 0 ]]
+    then
+        echo "Must be root to flush cache"
+        return
+    fi
+
+    local program=${1:?missing program name}
+    local trace_dir=${2:?missing trace directory}
+    local max_threads=${3:-8}
+    local work_dir=$(mktemp -d)
+    local args=
+    local out=
+    local ms=
+
+    local separator="--------------------------------------------------------------------------------"
+    local blue='\033[0;34m'
+    local red='\033[0;31m'
+    local cyan='\033[0;36m'
+    local NC='\033[0m'
+
+    # Make the compressed copies, keeping the index uncompressed
+    local format=
+    for format in zst xz
+    do
+        mkdir -p $work_dir/$format
+        cp -r $trace_dir/index $work_dir/$format/
+        local file=
+        for file in $trace_dir/*
+        do
+            [[ -f $file ]] || continue
+            if [[ $format == zst ]]
+            then
+                zstd -q -T0 $file -o $work_dir/$format/$(basename $file).zst
+            else
+                xz -T0 -c $file > $work_dir/$format/$(basename $file).xz
+            fi
+        done
+    done
+
+    for analysis in count cpu
+    do
+        out=${analysis}_compression.csv
+        echo "format,threads,cache_cold,time" > $out
+        local t=
+        for (( t=1; t<=max_threads; t=t*2 ))
+        do
+            for format in raw zst xz
+            do
+                local dir=$trace_dir
+                [[ $format == raw ]] || dir=$work_dir/$format
+                echo -e "${cyan}Testing $analysis analysis on $format trace with $t threads${NC}"
+                args="--analysis $analysis --thread $t --benchmark --balanced"
+                echo -e "${blue}Cache cold${NC}"
+                ms=$(./cache_cold.sh $program $args $dir | awk '/Analysis time/{ print $NF; }')
+                echo -e "$ms ms"
+                echo "$format,$t,1,$ms" >> $out
+                echo -e "${red}Cache hot${NC}"
+                ms=$($program $args $dir | awk '/Analysis time/{ print $NF; }')
+                echo -e "$ms ms"
+                echo "$format,$t,0,$ms" >> $out
+                echo $separator
+            done
+        done
+    done
+
+    rm -rf $work_dir
+}
+
+main $@
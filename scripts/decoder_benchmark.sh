@@ -0,0 +1,37 @@
+#!/bin/bash
+
+# Compares the event rate of the tigerbeetle and native decoders using the
+# count analysis
+main() {
+    local program=${1:?missing program name}
+    local trace_dir=${2:?missing trace directory}
+    local max_threads=${3:-8}
+    local args=
+    local out=decoders.csv
+    local output=
+    local ms=
+    local events=
+
+    local separator="--------------------------------------------------------------------------------"
+    local cyan='\033[0;36m'
+    local NC='\033[0m'
+
+    echo "decoder,threads,events,time,events_per_second" > $out
+    for decoder in tigerbeetle native
+    do
+        local t=
+        for (( t=1; t<=max_threads; t=t*2 ))
+        do
+            echo -e "${cyan}Testing $decoder decoder with $t threads${NC}"
+            args="--analysis count --decoder $decoder --thread $t --benchmark"
+            output=$(LC_ALL=C $program $args $trace_dir)
+            ms=$(echo "$output" | awk '/Analysis time/{ print $NF; }')
+            events=$(echo "$output" | awk '/Number of events/{ gsub(/[^0-9]/, "", $NF); print $NF; }')
+            echo -e "$events events in $ms ms"
+            echo "$decoder,$t,$events,$ms,$(( events * 1000 / (ms > 0 ? ms : 1) ))" >> $out
+            echo $separator
+        done
+    done
+}
+
+main $@
@@ -0,0 +1,46 @@
+#!/bin/bash
+
+# Compares the packet I/O engines using the read analysis
+main() {
+    if [[ $EUID -ne 0 ]]
+    then
+        echo "Must be root to flush cache"
+        return
+    fi
+
+    local program=${1:?missing program name}
+    local trace_dir=${2:?missing trace directory}
+    local max_threads=${3:-8}
+    local queue_depth=${4:-32}
+    local args=
+    local out=io_engines.csv
+    local ms=
+
+    local separator="--------------------------------------------------------------------------------"
+    local blue='\033[0;34m'
+    local red='\033[0;31m'
+    local cyan='\033[0;36m'
+    local NC='\033[0m'
+
+    echo "engine,threads,cache_cold,time" > $out
+    for engine in mmap read uring
+    do
+        local t=
+        for (( t=1; t<=max_threads; t=t*2 ))
+        do
+            echo -e "${cyan}Testing $engine engine with $t threads${NC}"
+            args="--analysis read --io-engine $engine --queue-depth $queue_depth --thread $t --benchmark"
+            echo -e "${blue}Cache cold${NC}"
+            ms=$(./cache_cold.sh $program $args $trace_dir | awk '/Analysis time/{ print $NF; }')
+            echo -e "$ms ms"
+            echo "$engine,$t,1,$ms" >> $out
+            echo -e "${red}Cache hot${NC}"
+            ms=$($program $args $trace_dir | awk '/Analysis time/{ print $NF; }')
+            echo -e "$ms ms"
+            echo "$engine,$t,0,$ms" >> $out
+            echo $separator
+        done
+    done
+}
+
+main $@
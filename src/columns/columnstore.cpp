@@ -0,0 +1,507 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "columnstore.h"
+#include "io/ioanalysis.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <limits>
+
+using namespace tibee::trace;
+
+static const char *MANIFEST_NAME = "manifest";
+static const uint64_t MAX_BLOCK_ROWS = 65536;
+
+ColumnWriter::ColumnWriter(const std::string &path)
+{
+    fp = fopen(path.c_str(), "w");
+    if (!fp) {
+        std::cerr << "Error: could not create column file " << path << std::endl;
+        return;
+    }
+    setvbuf(fp, nullptr, _IOFBF, 1 << 20);
+}
+
+ColumnWriter::~ColumnWriter()
+{
+    close();
+}
+
+bool ColumnWriter::close()
+{
+    if (!fp) {
+        return false;
+    }
+    bool ok = !ferror(fp);
+    ok = fclose(fp) == 0 && ok;
+    fp = nullptr;
+    return ok;
+}
+
+TimestampColumnWriter::TimestampColumnWriter(const std::string &path) :
+    deltas(path), index(path + ".idx"), rows(0), base(0), blockFirstRow(0)
+{
+}
+
+void TimestampColumnWriter::append(uint64_t timestamp)
+{
+    // Start a new block when the delta doesn't fit or the block is full
+    if (rows == 0 || timestamp < base || timestamp - base > std::numeric_limits<uint32_t>::max() ||
+            rows - blockFirstRow >= MAX_BLOCK_ROWS) {
+        base = timestamp;
+        blockFirstRow = rows;
+        TimeIndexEntry entry;
+        entry.base = base;
+        entry.firstRow = rows;
+        index.append(entry);
+    }
+    deltas.append<uint32_t>(timestamp - base);
+    rows++;
+}
+
+bool TimestampColumnWriter::close()
+{
+    bool ok = deltas.close();
+    return index.close() && ok;
+}
+
+bool TimestampColumnReader::open(const std::string &path)
+{
+    return deltas.open(path) && index.open(path + ".idx");
+}
+
+size_t TimestampColumnReader::size() const
+{
+    return deltas.size();
+}
+
+size_t TimestampColumnReader::lowerBound(uint64_t timestamp) const
+{
+    if (index.size() == 0) {
+        return 0;
+    }
+
+    // Last block starting at or before the timestamp
+    size_t low = 0;
+    size_t high = index.size();
+    while (high - low > 1) {
+        size_t mid = (low + high) / 2;
+        if (index[mid].base <= timestamp) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    size_t block = low;
+    if (index[block].base > timestamp) {
+        return 0;
+    }
+
+    // First row of the block at or after the timestamp
+    size_t first = index[block].firstRow;
+    size_t last = block + 1 < index.size() ? index[block + 1].firstRow : deltas.size();
+    uint64_t base = index[block].base;
+    while (first < last) {
+        size_t mid = (first + last) / 2;
+        if (base + deltas[mid] < timestamp) {
+            first = mid + 1;
+        } else {
+            last = mid;
+        }
+    }
+    return first;
+}
+
+size_t TimestampColumnReader::blockOf(size_t row) const
+{
+    size_t low = 0;
+    size_t high = index.size();
+    while (high - low > 1) {
+        size_t mid = (low + high) / 2;
+        if (index[mid].firstRow <= row) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static std::string tablePath(const std::string &segmentPath, const std::string &table, const std::string &column)
+{
+    return segmentPath + "/" + table + "/" + column;
+}
+
+/*
+ * Create the directory of a table and return the path of its timestamp
+ * column, which is the first column opened.
+ */
+static std::string makeTable(const std::string &segmentPath, const std::string &table)
+{
+    QDir().mkpath(QString::fromStdString(segmentPath + "/" + table));
+    return tablePath(segmentPath, table, "ts");
+}
+
+ColumnSegmentWriter::ColumnSegmentWriter(const std::string &segmentPath, const TraceMetadata &metadata) :
+    segmentPath(segmentPath),
+    schedSwitchTs(makeTable(segmentPath, "sched_switch")),
+    schedSwitchCpu(tablePath(segmentPath, "sched_switch", "cpu")),
+    schedSwitchPrevTid(tablePath(segmentPath, "sched_switch", "prev_tid")),
+    schedSwitchNextTid(tablePath(segmentPath, "sched_switch", "next_tid")),
+    schedSwitchPrevComm(tablePath(segmentPath, "sched_switch", "prev_comm")),
+    syscallTs(makeTable(segmentPath, "syscall")),
+    syscallTid(tablePath(segmentPath, "syscall", "tid")),
+    syscallComm(tablePath(segmentPath, "syscall", "comm")),
+    syscallKind(tablePath(segmentPath, "syscall", "kind")),
+    syscallName(tablePath(segmentPath, "syscall", "name")),
+    syscallFd(tablePath(segmentPath, "syscall", "fd")),
+    syscallRet(tablePath(segmentPath, "syscall", "ret"))
+{
+    eventKinds.resize(metadata.getNumEventIds(), EventKind::NONE);
+    auto setKind = [&](const std::string &eventName, EventKind kind) {
+        event_id_t id = metadata.getEventId(eventName);
+        if (id >= 0 && (size_t) id < eventKinds.size()) {
+            eventKinds[id] = kind;
+        }
+    };
+    setKind("sched_switch", EventKind::SCHED_SWITCH);
+    for (const std::string &eventName : readSyscalls) {
+        setKind(eventName, EventKind::READ);
+    }
+    for (const std::string &eventName : writeSyscalls) {
+        setKind(eventName, EventKind::WRITE);
+    }
+    for (const std::string &eventName : readWriteSyscalls) {
+        setKind(eventName, EventKind::READWRITE);
+    }
+    for (const std::string &eventName : exitSyscalls) {
+        setKind(eventName, EventKind::EXIT);
+    }
+}
+
+void ColumnSegmentWriter::handleEvent(const EventValue &event)
+{
+    event_id_t id = event.getId();
+    if (id < 0 || (size_t) id >= eventKinds.size()) {
+        return;
+    }
+    EventKind kind = eventKinds[id];
+    switch (kind) {
+    case EventKind::NONE:
+        break;
+    case EventKind::SCHED_SWITCH:
+        handleSchedSwitch(event);
+        break;
+    default:
+        handleSyscall(event, kind);
+        break;
+    }
+}
+
+void ColumnSegmentWriter::handleSchedSwitch(const EventValue &event)
+{
+    schedSwitchTs.append(event.getTimestamp());
+    schedSwitchCpu.append<uint32_t>(event.getStreamPacketContext()->GetField("cpu_id")->AsUInteger());
+    schedSwitchPrevTid.append<int32_t>(event.getFields()->GetField("prev_tid")->AsInteger());
+    schedSwitchNextTid.append<int32_t>(event.getFields()->GetField("next_tid")->AsInteger());
+    schedSwitchPrevComm.append<uint32_t>(intern(event.getFields()->GetField("prev_comm")->AsString()));
+}
+
+void ColumnSegmentWriter::handleSyscall(const EventValue &event, EventKind kind)
+{
+    if (!event.getStreamEventContext()->HasField("tid")) {
+        std::cerr << "Missing tid context info" << std::endl;
+        return;
+    }
+    std::string comm = "";
+    if (event.getStreamEventContext()->HasField("procname")) {
+        comm = event.getStreamEventContext()->GetField("procname")->AsString();
+    }
+
+    SyscallRowKind rowKind;
+    int32_t fd = -1;
+    int64_t ret = 0;
+    switch (kind) {
+    case EventKind::READ:
+        rowKind = SyscallRowKind::READ;
+        fd = event.getFields()->GetField("fd")->AsInteger();
+        break;
+    case EventKind::WRITE:
+        rowKind = SyscallRowKind::WRITE;
+        fd = event.getFields()->GetField("fd")->AsInteger();
+        break;
+    case EventKind::READWRITE:
+        rowKind = SyscallRowKind::READWRITE;
+        break;
+    default:
+        rowKind = SyscallRowKind::EXIT;
+        ret = event.getFields()->GetField("ret")->AsLong();
+        break;
+    }
+
+    syscallTs.append(event.getTimestamp());
+    syscallTid.append<int32_t>(event.getStreamEventContext()->GetField("tid")->AsInteger());
+    syscallComm.append<uint32_t>(intern(comm));
+    syscallKind.append<uint8_t>(static_cast<uint8_t>(rowKind));
+    syscallName.append<uint32_t>(rowKind == SyscallRowKind::EXIT ? intern("") : intern(event.getName()));
+    syscallFd.append<int32_t>(fd);
+    syscallRet.append<int64_t>(ret);
+}
+
+uint32_t ColumnSegmentWriter::intern(const std::string &string)
+{
+    auto iter = stringIds.find(string);
+    if (iter != stringIds.end()) {
+        return iter->second;
+    }
+    uint32_t id = strings.size();
+    stringIds.emplace(string, id);
+    strings.push_back(string);
+    return id;
+}
+
+bool ColumnSegmentWriter::close()
+{
+    bool ok = schedSwitchTs.close();
+    ok = schedSwitchCpu.close() && ok;
+    ok = schedSwitchPrevTid.close() && ok;
+    ok = schedSwitchNextTid.close() && ok;
+    ok = schedSwitchPrevComm.close() && ok;
+    ok = syscallTs.close() && ok;
+    ok = syscallTid.close() && ok;
+    ok = syscallComm.close() && ok;
+    ok = syscallKind.close() && ok;
+    ok = syscallName.close() && ok;
+    ok = syscallFd.close() && ok;
+    ok = syscallRet.close() && ok;
+
+    // String table: length prefixed strings, in id order
+    ColumnWriter stringsWriter(segmentPath + "/strings");
+    for (const std::string &string : strings) {
+        stringsWriter.append<uint32_t>(string.size());
+        for (char c : string) {
+            stringsWriter.append(c);
+        }
+    }
+    return stringsWriter.close() && ok;
+}
+
+ColumnSegment::ColumnSegment(const std::string &segmentPath, uint64_t begin, uint64_t end) :
+    segmentPath(segmentPath), begin(begin), end(end)
+{
+}
+
+bool ColumnSegment::open()
+{
+    ColumnReader<char> stringsReader;
+    if (!stringsReader.open(segmentPath + "/strings")) {
+        return false;
+    }
+    size_t pos = 0;
+    while (pos + sizeof(uint32_t) <= stringsReader.size()) {
+        uint32_t length = 0;
+        for (size_t i = 0; i < sizeof(uint32_t); i++) {
+            length |= (uint32_t) (uint8_t) stringsReader[pos + i] << (8 * i);
+        }
+        pos += sizeof(uint32_t);
+        std::string string;
+        string.reserve(length);
+        for (uint32_t i = 0; i < length && pos < stringsReader.size(); i++) {
+            string.push_back(stringsReader[pos++]);
+        }
+        names.push_back(NameTable::instance().intern(string));
+    }
+
+    return schedSwitchTs.open(tablePath(segmentPath, "sched_switch", "ts")) &&
+            schedSwitchCpu.open(tablePath(segmentPath, "sched_switch", "cpu")) &&
+            schedSwitchPrevTid.open(tablePath(segmentPath, "sched_switch", "prev_tid")) &&
+            schedSwitchNextTid.open(tablePath(segmentPath, "sched_switch", "next_tid")) &&
+            schedSwitchPrevComm.open(tablePath(segmentPath, "sched_switch", "prev_comm")) &&
+            syscallTs.open(tablePath(segmentPath, "syscall", "ts")) &&
+            syscallTid.open(tablePath(segmentPath, "syscall", "tid")) &&
+            syscallComm.open(tablePath(segmentPath, "syscall", "comm")) &&
+            syscallKind.open(tablePath(segmentPath, "syscall", "kind")) &&
+            syscallName.open(tablePath(segmentPath, "syscall", "name")) &&
+            syscallFd.open(tablePath(segmentPath, "syscall", "fd")) &&
+            syscallRet.open(tablePath(segmentPath, "syscall", "ret"));
+}
+
+uint64_t ColumnSegment::getBegin() const
+{
+    return begin;
+}
+
+uint64_t ColumnSegment::getEnd() const
+{
+    return end;
+}
+
+ColumnStore::ColumnStore(const QString &storePath) : storePath(storePath)
+{
+}
+
+QStringList ColumnStore::getTraceIdentity(const QString &tracePath)
+{
+    QStringList identity;
+    identity << QString("version %1").arg(VERSION);
+    QDir traceDir(tracePath);
+    for (const QFileInfo &fileInfo : traceDir.entryInfoList(QStringList(), QDir::Files)) {
+        identity << QString("file %1 %2 %3").arg(fileInfo.fileName())
+                    .arg(fileInfo.size()).arg(fileInfo.lastModified().toMSecsSinceEpoch());
+    }
+    return identity;
+}
+
+bool ColumnStore::open(const QString &identityPath)
+{
+    segments.clear();
+
+    QFile manifest(QDir(storePath).absoluteFilePath(MANIFEST_NAME));
+    if (!manifest.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream in(&manifest);
+    QStringList identity = getTraceIdentity(identityPath);
+    for (const QString &expected : identity) {
+        if (in.readLine() != expected) {
+            return false;
+        }
+    }
+
+    // Remaining lines are the segments, in time order
+    while (!in.atEnd()) {
+        QStringList fields = in.readLine().split(' ');
+        if (fields.size() != 4 || fields[0] != "segment") {
+            return false;
+        }
+        std::string segmentPath = QDir(storePath).absoluteFilePath(fields[1]).toStdString();
+        segments.emplace_back(segmentPath, fields[2].toULongLong(), fields[3].toULongLong());
+        if (!segments.back().open()) {
+            segments.clear();
+            return false;
+        }
+    }
+    return !segments.empty();
+}
+
+bool ColumnStore::convert(const QString &tracePath, const QString &identityPath, int numSegments, bool verbose)
+{
+    // Only remove what an earlier conversion wrote, the directory is given
+    // by the user
+    QDir storeDir(storePath);
+    if (storeDir.exists()) {
+        bool hasManifest = storeDir.exists(MANIFEST_NAME);
+        if (!hasManifest && !storeDir.entryList(QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot).isEmpty()) {
+            std::cerr << "Error: " << qPrintable(storePath) << " is not empty and is not a column store" << std::endl;
+            return false;
+        }
+        storeDir.remove(MANIFEST_NAME);
+        for (const QFileInfo &fileInfo : storeDir.entryInfoList(QStringList() << "segment-*",
+                                                                QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot)) {
+            // The pool may still map the files being replaced
+            StreamFilePool::instance().invalidate(fileInfo.absoluteFilePath().toStdString());
+            if (fileInfo.isDir()) {
+                QDir(fileInfo.absoluteFilePath()).removeRecursively();
+            } else {
+                storeDir.remove(fileInfo.fileName());
+            }
+        }
+    }
+    storeDir.mkpath(".");
+
+    TraceSet set;
+    set.addTrace(tracePath.toStdString());
+    TraceMetadata metadata(set);
+
+    // Same split as the unbalanced analysis
+    timestamp_t traceBegin = set.getBegin();
+    timestamp_t traceEnd = set.getEnd();
+    timestamp_t step = (traceEnd - traceBegin) / numSegments;
+
+    struct SegmentSpec {
+        int id;
+        timestamp_t begin;
+        timestamp_t end;
+        bool isFirst;
+        bool isLast;
+    };
+    std::vector<SegmentSpec> specs;
+    for (int i = 0; i < numSegments; i++) {
+        SegmentSpec spec;
+        spec.id = i;
+        spec.isFirst = i == 0;
+        spec.isLast = i == numSegments - 1;
+        spec.begin = spec.isFirst ? traceBegin : traceBegin + i * step + 1;
+        spec.end = spec.isLast ? traceEnd : traceBegin + (i + 1) * step;
+        specs.push_back(spec);
+    }
+
+    std::atomic<int> failures(0);
+    auto f = QtConcurrent::map(specs, [&](SegmentSpec &spec) {
+        std::string segmentPath = storeDir.absoluteFilePath(QString("segment-%1").arg(spec.id)).toStdString();
+        ColumnSegmentWriter writer(segmentPath, metadata);
+        TraceSet::Iterator iter = set.between(spec.isFirst ? nullptr : &spec.begin,
+                                              spec.isLast ? nullptr : &spec.end);
+        TraceSet::Iterator endIter = set.end();
+        uint64_t count = 0;
+        for ((void)iter; iter != endIter; ++iter) {
+            writer.handleEvent(*iter);
+            count++;
+        }
+        if (!writer.close()) {
+            failures++;
+        }
+        if (verbose) {
+            std::cout << "Segment " << spec.id << " converted " << count << " events" << std::endl;
+        }
+    });
+    f.waitForFinished();
+
+    if (failures > 0) {
+        std::cerr << "Error: could not write the column store" << std::endl;
+        return false;
+    }
+
+    // The manifest is written last, so an interrupted conversion is redone
+    QFile manifest(storeDir.absoluteFilePath(MANIFEST_NAME));
+    if (!manifest.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        std::cerr << "Error: could not write the column store manifest" << std::endl;
+        return false;
+    }
+    QTextStream out(&manifest);
+    for (const QString &line : getTraceIdentity(identityPath)) {
+        out << line << "\n";
+    }
+    for (const SegmentSpec &spec : specs) {
+        out << QString("segment segment-%1 %2 %3").arg(spec.id).arg(spec.begin).arg(spec.end) << "\n";
+    }
+    return true;
+}
+
+const std::vector<ColumnSegment> &ColumnStore::getSegments() const
+{
+    return segments;
+}
@@ -0,0 +1,324 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COLUMNSTORE_H
+#define COLUMNSTORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+#include <QStringList>
+
+#include <trace/BasicTypes.hpp>
+#include <trace/TraceSet.hpp>
+
+#include "common/nametable.h"
+#include "common/streamfilepool.h"
+#include "common/tracemetadata.h"
+
+/*
+ * Kind of a row of the syscall table. Entries and exits share a table so
+ * that they are replayed in trace order.
+ */
+enum class SyscallRowKind : uint8_t { EXIT, READ, WRITE, READWRITE };
+
+/*
+ * Entry of a timestamp column index. Timestamps of a block are stored as
+ * 32 bit deltas from the base of the block.
+ */
+struct TimeIndexEntry {
+    uint64_t base;
+    uint64_t firstRow;
+} __attribute__((__packed__));
+
+/*!
+ * \brief Appends fixed width values to a column file.
+ */
+class ColumnWriter
+{
+public:
+    ColumnWriter(const std::string &path);
+    ColumnWriter(const ColumnWriter &other) = delete;
+    ColumnWriter &operator=(const ColumnWriter &other) = delete;
+    ~ColumnWriter();
+
+    template <typename T>
+    void append(const T &value)
+    {
+        if (fp) {
+            fwrite(&value, sizeof(T), 1, fp);
+        }
+    }
+
+    bool close();
+
+private:
+    FILE *fp;
+};
+
+/*!
+ * \brief Appends timestamps, delta encoded, to a column file and its index.
+ */
+class TimestampColumnWriter
+{
+public:
+    TimestampColumnWriter(const std::string &path);
+    void append(uint64_t timestamp);
+    bool close();
+
+private:
+    ColumnWriter deltas;
+    ColumnWriter index;
+    uint64_t rows;
+    uint64_t base;
+    uint64_t blockFirstRow;
+};
+
+/*!
+ * \brief Read-only view of a mapped column file.
+ */
+template <typename T>
+class ColumnReader
+{
+public:
+    bool open(const std::string &path)
+    {
+        file = StreamFilePool::instance().acquire(path);
+        if (!file) {
+            return false;
+        }
+        rows = file->getSize() / sizeof(T);
+        data = rows ? file->getData() : nullptr;
+        return rows == 0 || data != nullptr;
+    }
+
+    T operator[](size_t row) const
+    {
+        T value;
+        memcpy(&value, data + row * sizeof(T), sizeof(T));
+        return value;
+    }
+
+    size_t size() const
+    {
+        return rows;
+    }
+
+private:
+    std::shared_ptr<StreamFile> file;
+    const char *data = nullptr;
+    size_t rows = 0;
+};
+
+/*!
+ * \brief Read-only view of a mapped timestamp column and its index.
+ */
+class TimestampColumnReader
+{
+public:
+    bool open(const std::string &path);
+
+    size_t size() const;
+
+    /*!
+     * \brief Find the first row at or after a timestamp.
+     */
+    size_t lowerBound(uint64_t timestamp) const;
+
+    /*!
+     * \brief Find the index block holding a row.
+     */
+    size_t blockOf(size_t row) const;
+
+    /*!
+     * \brief Get the timestamp of a row, given its index block. Sequential
+     * scans move to the next block when the row reaches its end.
+     */
+    uint64_t at(size_t row, size_t &block) const
+    {
+        while (block + 1 < index.size() && index[block + 1].firstRow <= row) {
+            block++;
+        }
+        return index[block].base + deltas[row];
+    }
+
+private:
+    ColumnReader<uint32_t> deltas;
+    ColumnReader<TimeIndexEntry> index;
+};
+
+/*!
+ * \brief Converts the events of one time range of the trace to columns.
+ */
+class ColumnSegmentWriter
+{
+public:
+    ColumnSegmentWriter(const std::string &segmentPath, const TraceMetadata &metadata);
+    void handleEvent(const tibee::trace::EventValue &event);
+    bool close();
+
+private:
+    enum class EventKind : uint8_t { NONE, SCHED_SWITCH, READ, WRITE, READWRITE, EXIT };
+
+    uint32_t intern(const std::string &string);
+    void handleSchedSwitch(const tibee::trace::EventValue &event);
+    void handleSyscall(const tibee::trace::EventValue &event, EventKind kind);
+
+    std::string segmentPath;
+    std::vector<EventKind> eventKinds;
+    std::unordered_map<std::string, uint32_t> stringIds;
+    std::vector<std::string> strings;
+
+    // sched_switch table
+    TimestampColumnWriter schedSwitchTs;
+    ColumnWriter schedSwitchCpu;
+    ColumnWriter schedSwitchPrevTid;
+    ColumnWriter schedSwitchNextTid;
+    ColumnWriter schedSwitchPrevComm;
+
+    // syscall table
+    TimestampColumnWriter syscallTs;
+    ColumnWriter syscallTid;
+    ColumnWriter syscallComm;
+    ColumnWriter syscallKind;
+    ColumnWriter syscallName;
+    ColumnWriter syscallFd;
+    ColumnWriter syscallRet;
+};
+
+/*!
+ * \brief A time range of the trace converted to columns.
+ */
+class ColumnSegment
+{
+public:
+    ColumnSegment(const std::string &segmentPath, uint64_t begin, uint64_t end);
+    bool open();
+
+    uint64_t getBegin() const;
+    uint64_t getEnd() const;
+
+    /*!
+     * \brief Call f(timestamp, cpu, prevTid, nextTid, prevComm) for every
+     * sched_switch between begin and end, inclusively, in trace order.
+     * Names are given as NameTable ids.
+     */
+    template <typename F>
+    void forEachSchedSwitch(uint64_t begin, uint64_t end, F f) const
+    {
+        size_t row = schedSwitchTs.lowerBound(begin);
+        size_t block = schedSwitchTs.blockOf(row);
+        for (; row < schedSwitchTs.size(); row++) {
+            uint64_t timestamp = schedSwitchTs.at(row, block);
+            if (timestamp > end) {
+                break;
+            }
+            f(timestamp, schedSwitchCpu[row], schedSwitchPrevTid[row], schedSwitchNextTid[row],
+              names[schedSwitchPrevComm[row]]);
+        }
+    }
+
+    /*!
+     * \brief Call f(timestamp, kind, tid, comm, name, fd, ret) for every
+     * I/O syscall entry and exit between begin and end, inclusively, in
+     * trace order. Names are given as NameTable ids.
+     */
+    template <typename F>
+    void forEachSyscall(uint64_t begin, uint64_t end, F f) const
+    {
+        size_t row = syscallTs.lowerBound(begin);
+        size_t block = syscallTs.blockOf(row);
+        for (; row < syscallTs.size(); row++) {
+            uint64_t timestamp = syscallTs.at(row, block);
+            if (timestamp > end) {
+                break;
+            }
+            f(timestamp, static_cast<SyscallRowKind>(syscallKind[row]), syscallTid[row],
+              names[syscallComm[row]], names[syscallName[row]], syscallFd[row], syscallRet[row]);
+        }
+    }
+
+private:
+    std::string segmentPath;
+    uint64_t begin;
+    uint64_t end;
+    std::vector<name_id_t> names; // Strings of the segment, interned
+
+    TimestampColumnReader schedSwitchTs;
+    ColumnReader<uint32_t> schedSwitchCpu;
+    ColumnReader<int32_t> schedSwitchPrevTid;
+    ColumnReader<int32_t> schedSwitchNextTid;
+    ColumnReader<uint32_t> schedSwitchPrevComm;
+
+    TimestampColumnReader syscallTs;
+    ColumnReader<int32_t> syscallTid;
+    ColumnReader<uint32_t> syscallComm;
+    ColumnReader<uint8_t> syscallKind;
+    ColumnReader<uint32_t> syscallName;
+    ColumnReader<int32_t> syscallFd;
+    ColumnReader<int64_t> syscallRet;
+};
+
+/*!
+ * \brief The ColumnStore class is a columnar copy of the events used by
+ * the CPU and I/O analyses, split in time segments.
+ *
+ * It is written once by convert(), and then mapped by the analyses,
+ * which replay the columns instead of decoding the trace. A manifest
+ * records the identity of the trace (file names, sizes and modification
+ * times), so a store made from another trace is never used.
+ */
+class ColumnStore
+{
+public:
+    static const int VERSION = 1;
+
+    ColumnStore(const QString &storePath);
+
+    /*!
+     * \brief Open the store made from the given trace.
+     * \param identityPath The trace directory given by the user.
+     * \return false if there is no valid store for this trace.
+     */
+    bool open(const QString &identityPath);
+
+    /*!
+     * \brief Convert a trace to columns, in parallel, one segment per task.
+     * \param tracePath The trace to read.
+     * \param identityPath The trace directory given by the user, whose
+     * files identify the trace. It differs from tracePath when the trace
+     * was decompressed to a temporary copy.
+     */
+    bool convert(const QString &tracePath, const QString &identityPath, int numSegments, bool verbose);
+
+    const std::vector<ColumnSegment> &getSegments() const;
+
+private:
+    static QStringList getTraceIdentity(const QString &tracePath);
+
+    QString storePath;
+    std::vector<ColumnSegment> segments;
+};
+
+#endif // COLUMNSTORE_H
@@ -0,0 +1,353 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "decompress.h"
+#include "common/streamfilepool.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QtConcurrent>
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <endian.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
+static const size_t OUTPUT_BUFFER_SIZE = 1 << 20;
+
+/*
+ * Output file mapped for writing, shared by the frames written into it.
+ */
+struct MappedOutput {
+    int fd = -1;
+    char *data = nullptr;
+    size_t size = 0;
+
+    ~MappedOutput()
+    {
+        if (data) {
+            munmap(data, size);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+/*
+ * A unit of decompression work: either a single zstd frame written at a
+ * known offset of a mapped output file, or a whole file decompressed as
+ * a stream.
+ */
+struct DecompressTask {
+    Compression compression = Compression::NONE;
+    std::shared_ptr<StreamFile> source;
+    size_t sourceOffset = 0;
+    size_t sourceSize = 0;
+    std::string outputPath;
+    std::shared_ptr<MappedOutput> output;
+    size_t outputOffset = 0;
+    size_t outputSize = 0;
+};
+
+static bool writeFully(int fd, const char *buf, size_t size)
+{
+    while (size > 0) {
+        ssize_t ret = write(fd, buf, size);
+        if (ret <= 0) {
+            return false;
+        }
+        buf += ret;
+        size -= ret;
+    }
+    return true;
+}
+
+#ifdef HAVE_ZSTD
+static bool decompressZstdFrame(const DecompressTask &task)
+{
+    // Contexts are reused by each thread of the pool
+    static thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx *)> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    const char *src = task.source->getData() + task.sourceOffset;
+    char *dst = task.output->data + task.outputOffset;
+    size_t ret = ZSTD_decompressDCtx(dctx.get(), dst, task.outputSize, src, task.sourceSize);
+    return !ZSTD_isError(ret) && ret == task.outputSize;
+}
+
+static bool decompressZstdStream(const DecompressTask &task, int fd)
+{
+    std::unique_ptr<ZSTD_DStream, size_t (*)(ZSTD_DStream *)> dstream(ZSTD_createDStream(), ZSTD_freeDStream);
+    ZSTD_initDStream(dstream.get());
+    std::vector<char> buffer(OUTPUT_BUFFER_SIZE);
+    ZSTD_inBuffer in = { task.source->getData(), task.source->getSize(), 0 };
+    while (in.pos < in.size) {
+        ZSTD_outBuffer out = { buffer.data(), buffer.size(), 0 };
+        size_t ret = ZSTD_decompressStream(dstream.get(), &out, &in);
+        if (ZSTD_isError(ret)) {
+            std::cerr << "Error: " << ZSTD_getErrorName(ret) << std::endl;
+            return false;
+        }
+        if (!writeFully(fd, buffer.data(), out.pos)) {
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+#ifdef HAVE_LZMA
+static bool decompressXzStream(const DecompressTask &task, int fd)
+{
+    lzma_stream strm = LZMA_STREAM_INIT;
+    if (lzma_stream_decoder(&strm, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+        return false;
+    }
+    std::vector<char> buffer(OUTPUT_BUFFER_SIZE);
+    strm.next_in = reinterpret_cast<const uint8_t *>(task.source->getData());
+    strm.avail_in = task.source->getSize();
+    lzma_ret ret = LZMA_OK;
+    while (ret == LZMA_OK) {
+        strm.next_out = reinterpret_cast<uint8_t *>(buffer.data());
+        strm.avail_out = buffer.size();
+        ret = lzma_code(&strm, LZMA_FINISH);
+        if (!writeFully(fd, buffer.data(), buffer.size() - strm.avail_out)) {
+            ret = LZMA_PROG_ERROR;
+        }
+    }
+    lzma_end(&strm);
+    return ret == LZMA_STREAM_END;
+}
+#endif
+
+static bool runTask(const DecompressTask &task)
+{
+    // Empty files can't be mapped, and decompress to empty files
+    bool empty = task.source->getSize() == 0;
+    if (!empty && !task.source->getData()) {
+        return false;
+    }
+
+#ifdef HAVE_ZSTD
+    if (task.output) {
+        return decompressZstdFrame(task);
+    }
+#endif
+
+    int fd = open(task.outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = false;
+    if (empty) {
+        close(fd);
+        return true;
+    }
+    switch (task.compression) {
+    case Compression::ZSTD:
+#ifdef HAVE_ZSTD
+        ok = decompressZstdStream(task, fd);
+#endif
+        break;
+    case Compression::XZ:
+#ifdef HAVE_LZMA
+        ok = decompressXzStream(task, fd);
+#endif
+        break;
+    case Compression::NONE:
+        break;
+    }
+    close(fd);
+    return ok;
+}
+
+#ifdef HAVE_ZSTD
+/*
+ * Split a zstd file into frames, and map the output file so that each
+ * frame can be decompressed in place. Files with frames of unknown
+ * content size are decompressed as a single stream.
+ */
+static void addZstdTasks(const DecompressTask &fileTask, std::vector<DecompressTask> &tasks)
+{
+    const char *data = fileTask.source->getData();
+    size_t size = fileTask.source->getSize();
+    std::vector<DecompressTask> frames;
+    size_t pos = 0;
+    size_t outputSize = 0;
+    while (data && pos < size) {
+        size_t frameSize = ZSTD_findFrameCompressedSize(data + pos, size - pos);
+        if (ZSTD_isError(frameSize)) {
+            frames.clear();
+            break;
+        }
+        uint32_t magic;
+        memcpy(&magic, data + pos, sizeof(magic));
+        if ((le32toh(magic) & 0xFFFFFFF0) == ZSTD_MAGIC_SKIPPABLE_START) {
+            // Skippable frames hold the seek table
+            pos += frameSize;
+            continue;
+        }
+        unsigned long long contentSize = ZSTD_getFrameContentSize(data + pos, size - pos);
+        if (contentSize == ZSTD_CONTENTSIZE_UNKNOWN || contentSize == ZSTD_CONTENTSIZE_ERROR) {
+            frames.clear();
+            break;
+        }
+        DecompressTask frame = fileTask;
+        frame.sourceOffset = pos;
+        frame.sourceSize = frameSize;
+        frame.outputOffset = outputSize;
+        frame.outputSize = contentSize;
+        frames.push_back(frame);
+        pos += frameSize;
+        outputSize += contentSize;
+    }
+
+    std::shared_ptr<MappedOutput> output;
+    if (!frames.empty() && outputSize > 0) {
+        output = std::make_shared<MappedOutput>();
+        output->fd = open(fileTask.outputPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (output->fd >= 0 && ftruncate(output->fd, outputSize) == 0) {
+            void *addr = mmap(nullptr, outputSize, PROT_READ | PROT_WRITE, MAP_SHARED, output->fd, 0);
+            if (addr != MAP_FAILED) {
+                output->data = static_cast<char *>(addr);
+                output->size = outputSize;
+            }
+        }
+    }
+
+    if (!output || !output->data) {
+        tasks.push_back(fileTask);
+        return;
+    }
+    for (DecompressTask &frame : frames) {
+        frame.output = output;
+        tasks.push_back(frame);
+    }
+}
+#endif
+
+Compression getCompression(const QString &fileName)
+{
+    if (fileName.endsWith(".zst")) {
+        return Compression::ZSTD;
+    } else if (fileName.endsWith(".xz")) {
+        return Compression::XZ;
+    }
+    return Compression::NONE;
+}
+
+QString stripCompressionSuffix(const QString &fileName)
+{
+    switch (getCompression(fileName)) {
+    case Compression::ZSTD:
+        return fileName.left(fileName.size() - 4);
+    case Compression::XZ:
+        return fileName.left(fileName.size() - 3);
+    case Compression::NONE:
+        break;
+    }
+    return fileName;
+}
+
+bool hasCompressedFiles(const QString &tracePath)
+{
+    QDir traceDir(tracePath);
+    for (const QFileInfo &fileInfo : traceDir.entryInfoList(QStringList(), QDir::Files)) {
+        if (getCompression(fileInfo.fileName()) != Compression::NONE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool decompressTrace(const QString &tracePath, const QString &destPath)
+{
+    QDir traceDir(tracePath);
+    QDir destDir(destPath);
+    std::vector<DecompressTask> tasks;
+    bool ok = true;
+
+    for (const QFileInfo &fileInfo : traceDir.entryInfoList(QStringList(), QDir::Files)) {
+        QString fileName = fileInfo.fileName();
+        Compression compression = getCompression(fileName);
+        if (compression == Compression::NONE) {
+            QFile::link(fileInfo.absoluteFilePath(), destDir.absoluteFilePath(fileName));
+            continue;
+        }
+
+        DecompressTask task;
+        task.compression = compression;
+        task.source = StreamFilePool::instance().acquire(fileInfo.absoluteFilePath().toStdString());
+        task.outputPath = destDir.absoluteFilePath(stripCompressionSuffix(fileName)).toStdString();
+        if (!task.source) {
+            ok = false;
+            continue;
+        }
+        task.sourceSize = task.source->getSize();
+
+        switch (compression) {
+        case Compression::ZSTD:
+#ifdef HAVE_ZSTD
+            addZstdTasks(task, tasks);
+#else
+            std::cerr << "Error: built without zstd support, cannot read " << qPrintable(fileName) << std::endl;
+            ok = false;
+#endif
+            break;
+        case Compression::XZ:
+#ifdef HAVE_LZMA
+            tasks.push_back(task);
+#else
+            std::cerr << "Error: built without xz support, cannot read " << qPrintable(fileName) << std::endl;
+            ok = false;
+#endif
+            break;
+        case Compression::NONE:
+            break;
+        }
+    }
+
+    // The index files are not compressed
+    if (traceDir.exists("index")) {
+        QFile::link(traceDir.absoluteFilePath("index"), destDir.absoluteFilePath("index"));
+    }
+
+    std::atomic<int> failures(0);
+    auto f = QtConcurrent::map(tasks, [&](DecompressTask &task) {
+        if (!runTask(task)) {
+            std::cerr << "Error: could not decompress into " << task.outputPath << std::endl;
+            failures++;
+        }
+    });
+    f.waitForFinished();
+
+    return ok && failures == 0;
+}
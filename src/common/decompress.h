@@ -0,0 +1,59 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H
+
+#include <QString>
+
+enum class Compression { NONE, ZSTD, XZ };
+
+/*!
+ * \brief Get the compression of a trace file from its suffix.
+ */
+Compression getCompression(const QString &fileName);
+
+/*!
+ * \brief Remove the compression suffix of a trace file name, if any.
+ */
+QString stripCompressionSuffix(const QString &fileName);
+
+/*!
+ * \brief Check if a trace directory has compressed stream or metadata files.
+ */
+bool hasCompressedFiles(const QString &tracePath);
+
+/*!
+ * \brief Make a readable copy of a trace with compressed files.
+ *
+ * Compressed files are decompressed into destPath, and the other files,
+ * including the index directory, are symlinked. All the files are
+ * decompressed concurrently. Zstd files made of several frames with
+ * known content sizes (e.g. the seekable format, with one frame per
+ * packet or group of packets) are also decompressed frame by frame in
+ * parallel, straight into their place in the output file. Empty
+ * compressed files give empty files.
+ *
+ * The whole trace is written out before it is decoded, so its data goes
+ * through the disk, or TMPDIR, twice.
+ *
+ * \return false if a file could not be decompressed.
+ */
+bool decompressTrace(const QString &tracePath, const QString &destPath);
+
+#endif // DECOMPRESS_H
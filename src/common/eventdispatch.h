@@ -0,0 +1,93 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EVENTDISPATCH_H
+#define EVENTDISPATCH_H
+
+#include <string>
+#include <vector>
+
+#include <trace/value/EventValue.hpp>
+
+#include "common/tracemetadata.h"
+
+/*!
+ * \brief The EventDispatch class maps event ids to the handlers of an
+ * analysis context.
+ *
+ * The event names are resolved once per analysis, and the table is
+ * shared read-only by all the workers. Dispatching an event is a single
+ * load from an array indexed by its id.
+ */
+template <typename Context>
+class EventDispatch
+{
+public:
+    typedef void (Context::*Handler)(const tibee::trace::EventValue &event);
+
+    /*!
+     * \brief Create an empty table, sized for the event ids of the trace.
+     */
+    EventDispatch(const TraceMetadata &metadata) :
+        handlers(metadata.getNumEventIds(), nullptr)
+    {
+    }
+
+    /*!
+     * \brief Handle the given events, if the trace has them.
+     * \param metadata The metadata the table was created with, to resolve
+     * the event names.
+     */
+    void add(const TraceMetadata &metadata, const std::vector<std::string> &eventNames, Handler handler)
+    {
+        for (const std::string &eventName : eventNames) {
+            tibee::trace::event_id_t id = metadata.getEventId(eventName);
+            if (id >= 0 && (size_t) id < handlers.size()) {
+                handlers[id] = handler;
+            }
+        }
+    }
+
+    /*!
+     * \brief Get the handler of an event id, or nullptr.
+     */
+    Handler get(tibee::trace::event_id_t id) const
+    {
+        // Negative ids wrap around past the end of the table
+        return (size_t) id < handlers.size() ? handlers[id] : nullptr;
+    }
+
+    /*!
+     * \brief Call the handler of the event on the context.
+     * \return false if the event has no handler.
+     */
+    bool dispatch(Context &context, const tibee::trace::EventValue &event) const
+    {
+        Handler handler = get(event.getId());
+        if (!handler) {
+            return false;
+        }
+        (context.*handler)(event);
+        return true;
+    }
+
+private:
+    std::vector<Handler> handlers;
+};
+
+#endif // EVENTDISPATCH_H
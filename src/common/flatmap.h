@@ -0,0 +1,226 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLATMAP_H
+#define FLATMAP_H
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*!
+ * \brief The FlatMap class is an open addressing hash map from int keys,
+ * such as TIDs, to values.
+ *
+ * Keys and values are kept in separate arrays, so a lookup only probes
+ * the packed keys and touches a single value. INT_MIN can't be used as a
+ * key.
+ */
+template <typename Value>
+class FlatMap
+{
+public:
+    FlatMap() : keys(16, EMPTY_KEY), values(16), count(0), shift(60)
+    {
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    bool contains(int key) const
+    {
+        return find(key) != nullptr;
+    }
+
+    /*!
+     * \brief Get the value of a key, or nullptr.
+     */
+    const Value *find(int key) const
+    {
+        size_t mask = keys.size() - 1;
+        for (size_t i = slot(key); keys[i] != EMPTY_KEY; i = (i + 1) & mask) {
+            if (keys[i] == key) {
+                return &values[i];
+            }
+        }
+        return nullptr;
+    }
+    Value *find(int key)
+    {
+        return const_cast<Value *>(static_cast<const FlatMap *>(this)->find(key));
+    }
+
+    /*!
+     * \brief Get the value of a key, inserting a default value if the key
+     * is missing.
+     */
+    Value &operator[](int key)
+    {
+        size_t mask = keys.size() - 1;
+        size_t i = slot(key);
+        for (; keys[i] != EMPTY_KEY; i = (i + 1) & mask) {
+            if (keys[i] == key) {
+                return values[i];
+            }
+        }
+        // Keep the load factor under one half
+        if ((count + 1) * 2 > keys.size()) {
+            grow();
+            return (*this)[key];
+        }
+        keys[i] = key;
+        count++;
+        return values[i];
+    }
+
+    /*!
+     * \brief Remove a key, if present.
+     */
+    void erase(int key)
+    {
+        size_t mask = keys.size() - 1;
+        size_t i = slot(key);
+        for (; keys[i] != key; i = (i + 1) & mask) {
+            if (keys[i] == EMPTY_KEY) {
+                return;
+            }
+        }
+        // Move back the entries probed after the removed one, so that
+        // lookups don't stop at the hole
+        size_t hole = i;
+        for (size_t j = (i + 1) & mask; keys[j] != EMPTY_KEY; j = (j + 1) & mask) {
+            size_t home = slot(keys[j]);
+            if (((j - home) & mask) >= ((j - hole) & mask)) {
+                keys[hole] = keys[j];
+                values[hole] = std::move(values[j]);
+                hole = j;
+            }
+        }
+        keys[hole] = EMPTY_KEY;
+        values[hole] = Value();
+        count--;
+    }
+
+    void clear()
+    {
+        std::fill(keys.begin(), keys.end(), EMPTY_KEY);
+        std::fill(values.begin(), values.end(), Value());
+        count = 0;
+    }
+
+    /*!
+     * \brief Call f(key, value) for every entry, in no particular order.
+     */
+    template <typename F>
+    void forEach(F f) const
+    {
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] != EMPTY_KEY) {
+                f(keys[i], values[i]);
+            }
+        }
+    }
+
+    /*!
+     * \brief Get copies of the first values in the order given by
+     * compare, without sorting the others.
+     */
+    template <typename Compare>
+    std::vector<Value> getTop(size_t number, Compare compare) const
+    {
+        std::vector<const Value *> candidates;
+        candidates.reserve(count);
+        forEach([&](int, const Value &value) {
+            candidates.push_back(&value);
+        });
+        number = std::min(number, candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + number, candidates.end(),
+                          [&](const Value *a, const Value *b) {
+            return compare(*a, *b);
+        });
+        std::vector<Value> top;
+        top.reserve(number);
+        for (size_t i = 0; i < number; i++) {
+            top.push_back(*candidates[i]);
+        }
+        return top;
+    }
+
+    /*!
+     * \brief Get copies of the values with the highest rank, computing
+     * the rank of each value once, for ranks that are costly to compute.
+     */
+    template <typename Rank>
+    std::vector<Value> getTopBy(size_t number, Rank rank) const
+    {
+        typedef decltype(rank(std::declval<const Value &>())) RankType;
+        std::vector<std::pair<RankType, const Value *>> candidates;
+        candidates.reserve(count);
+        forEach([&](int, const Value &value) {
+            candidates.emplace_back(rank(value), &value);
+        });
+        number = std::min(number, candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + number, candidates.end(),
+                          [](const std::pair<RankType, const Value *> &a,
+                             const std::pair<RankType, const Value *> &b) {
+            return a.first > b.first;
+        });
+        std::vector<Value> top;
+        top.reserve(number);
+        for (size_t i = 0; i < number; i++) {
+            top.push_back(*candidates[i].second);
+        }
+        return top;
+    }
+
+private:
+    static const int EMPTY_KEY = INT_MIN;
+
+    size_t slot(int key) const
+    {
+        // Fibonacci hashing, keys with a common stride are spread too
+        return ((uint32_t) key * 11400714819323198485ULL) >> shift;
+    }
+
+    void grow()
+    {
+        std::vector<int> oldKeys(keys.size() * 2, EMPTY_KEY);
+        std::vector<Value> oldValues(values.size() * 2);
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        count = 0;
+        shift--;
+        for (size_t i = 0; i < oldKeys.size(); i++) {
+            if (oldKeys[i] != EMPTY_KEY) {
+                (*this)[oldKeys[i]] = std::move(oldValues[i]);
+            }
+        }
+    }
+
+    std::vector<int> keys;
+    std::vector<Value> values;
+    size_t count;
+    int shift; // 64 minus log2 of the number of slots
+};
+
+#endif // FLATMAP_H
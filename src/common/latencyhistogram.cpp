@@ -0,0 +1,142 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "latencyhistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+size_t LatencyHistogram::getIndex(uint64_t latency)
+{
+    if (latency < SUB_BUCKETS) {
+        return latency;
+    }
+    // Bucket of the power of two, then linear bucket inside it
+    int exponent = 63 - __builtin_clzll(latency);
+    int shift = exponent - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + ((latency >> shift) - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::getUpperBound(size_t index)
+{
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    int shift = index / SUB_BUCKETS - 1;
+    uint64_t lower = (uint64_t) (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    return lower + ((uint64_t) 1 << shift) - 1;
+}
+
+void LatencyHistogram::cover(size_t first, size_t last)
+{
+    if (counts.empty()) {
+        offset = first;
+        counts.resize(last - first + 1);
+        return;
+    }
+    if (first < offset) {
+        counts.insert(counts.begin(), offset - first, 0);
+        offset = first;
+    }
+    if (last >= offset + counts.size()) {
+        counts.resize(last - offset + 1);
+    }
+}
+
+void LatencyHistogram::add(uint64_t latency)
+{
+    size_t index = getIndex(latency);
+    cover(index, index);
+    counts[index - offset]++;
+    count++;
+    max = std::max(max, latency);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    if (other.counts.empty()) {
+        return;
+    }
+    cover(other.offset, other.offset + other.counts.size() - 1);
+    for (size_t i = 0; i < other.counts.size(); i++) {
+        counts[other.offset + i - offset] += other.counts[i];
+    }
+    count += other.count;
+    max = std::max(max, other.max);
+}
+
+uint64_t LatencyHistogram::getCount() const
+{
+    return count;
+}
+
+uint64_t LatencyHistogram::getMax() const
+{
+    return max;
+}
+
+uint64_t LatencyHistogram::getPercentile(double percentile) const
+{
+    if (!count) {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, std::ceil(percentile / 100 * count));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return std::min(getUpperBound(offset + i), max);
+        }
+    }
+    return max;
+}
+
+QDataStream &operator<<(QDataStream &out, const LatencyHistogram &histogram)
+{
+    // Only the buckets in use, most of them are empty
+    quint32 used = std::count_if(histogram.counts.begin(), histogram.counts.end(),
+                                 [](uint64_t count) { return count != 0; });
+    out << (quint64) histogram.count << (quint64) histogram.max << used;
+    for (size_t i = 0; i < histogram.counts.size(); i++) {
+        if (histogram.counts[i]) {
+            out << (quint32) (histogram.offset + i) << (quint64) histogram.counts[i];
+        }
+    }
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, LatencyHistogram &histogram)
+{
+    quint64 count, max;
+    quint32 used;
+    in >> count >> max >> used;
+    histogram.count = count;
+    histogram.max = max;
+    histogram.counts.clear();
+    histogram.offset = 0;
+    for (quint32 i = 0; i < used && in.status() == QDataStream::Ok; i++) {
+        quint32 index;
+        quint64 bucketCount;
+        in >> index >> bucketCount;
+        if (index < LatencyHistogram::NUM_BUCKETS) {
+            histogram.cover(index, index);
+            histogram.counts[index - histogram.offset] = bucketCount;
+        }
+    }
+    return in;
+}
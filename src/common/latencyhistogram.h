@@ -0,0 +1,80 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QDataStream>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*!
+ * \brief The LatencyHistogram class counts latencies in log-linear
+ * buckets, like HdrHistogram, to report their percentiles without keeping
+ * the samples.
+ *
+ * Each power of two is split in SUB_BUCKETS linear buckets, so a reported
+ * latency is at most 1/SUB_BUCKETS above the real one. The buckets cover
+ * all 64-bit values, but only the range between the lowest and highest
+ * bucket used is allocated: latencies of a thread usually span a few
+ * powers of two, so a histogram per thread stays small.
+ */
+class LatencyHistogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const size_t NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    void add(uint64_t latency);
+    void merge(const LatencyHistogram &other);
+
+    uint64_t getCount() const;
+    uint64_t getMax() const;
+
+    /*!
+     * \brief Get the latency under which the given percentage of the
+     * samples fall, rounded up to the end of its bucket.
+     * \param percentile Between 0 and 100.
+     * \return The latency, or 0 if the histogram is empty.
+     */
+    uint64_t getPercentile(double percentile) const;
+
+    // Serialization of the map results, for the result cache
+    friend QDataStream &operator<<(QDataStream &out, const LatencyHistogram &histogram);
+    friend QDataStream &operator>>(QDataStream &in, LatencyHistogram &histogram);
+
+private:
+    static size_t getIndex(uint64_t latency);
+    static uint64_t getUpperBound(size_t index);
+
+    /*!
+     * \brief Grow the allocated range to include the buckets from first
+     * to last.
+     */
+    void cover(size_t first, size_t last);
+
+    std::vector<uint64_t> counts;	/* buckets from offset on, or empty */
+    size_t offset = 0;
+    uint64_t count = 0;
+    uint64_t max = 0;
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -0,0 +1,149 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "nametable.h"
+
+#include <cstring>
+#include <vector>
+
+static uint64_t hashName(const char *name, size_t length)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char) name[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*
+ * Names already interned by the current thread, in an open addressing
+ * table, so that hits don't build a std::string.
+ */
+class LocalNameCache
+{
+public:
+    LocalNameCache() : entries(256), used(0)
+    {
+    }
+
+    bool find(uint64_t hash, const char *name, size_t length, name_id_t &id) const
+    {
+        size_t mask = entries.size() - 1;
+        for (size_t i = hash & mask; entries[i].isUsed; i = (i + 1) & mask) {
+            const Entry &entry = entries[i];
+            if (entry.hash == hash && entry.name.size() == length &&
+                    memcmp(entry.name.data(), name, length) == 0) {
+                id = entry.id;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void insert(uint64_t hash, const char *name, size_t length, name_id_t id)
+    {
+        // Keep the load factor under one half
+        if ((used + 1) * 2 > entries.size()) {
+            std::vector<Entry> old(entries.size() * 2);
+            old.swap(entries);
+            used = 0;
+            for (Entry &entry : old) {
+                if (entry.isUsed) {
+                    place(std::move(entry));
+                }
+            }
+        }
+        Entry entry;
+        entry.isUsed = true;
+        entry.hash = hash;
+        entry.id = id;
+        entry.name.assign(name, length);
+        place(std::move(entry));
+    }
+
+private:
+    struct Entry {
+        bool isUsed = false;
+        uint64_t hash = 0;
+        name_id_t id = 0;
+        std::string name;
+    };
+
+    void place(Entry &&entry)
+    {
+        size_t mask = entries.size() - 1;
+        size_t i = entry.hash & mask;
+        while (entries[i].isUsed) {
+            i = (i + 1) & mask;
+        }
+        entries[i] = std::move(entry);
+        used++;
+    }
+
+    std::vector<Entry> entries;
+    size_t used;
+};
+
+NameTable &NameTable::instance()
+{
+    static NameTable table;
+    return table;
+}
+
+NameTable::NameTable()
+{
+    insert("", 0);
+}
+
+name_id_t NameTable::intern(const char *name, size_t length)
+{
+    static thread_local LocalNameCache cache;
+    uint64_t hash = hashName(name, length);
+    name_id_t id;
+    if (!cache.find(hash, name, length, id)) {
+        id = insert(name, length);
+        cache.insert(hash, name, length, id);
+    }
+    return id;
+}
+
+name_id_t NameTable::intern(const std::string &name)
+{
+    return intern(name.data(), name.size());
+}
+
+const std::string &NameTable::resolve(name_id_t id) const
+{
+    std::lock_guard<std::mutex> guard(mutex); (void) guard;
+    return names.at(id);
+}
+
+name_id_t NameTable::insert(const char *name, size_t length)
+{
+    std::lock_guard<std::mutex> guard(mutex); (void) guard;
+    std::string key(name, length);
+    auto iter = ids.find(key);
+    if (iter != ids.end()) {
+        return iter->second;
+    }
+    name_id_t id = names.size();
+    names.push_back(key);
+    ids.emplace(std::move(key), id);
+    return id;
+}
@@ -0,0 +1,67 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NAMETABLE_H
+#define NAMETABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+typedef uint32_t name_id_t;
+
+/*!
+ * \brief The NameTable class interns the process and syscall names read
+ * by the analyses, so that contexts carry and merge integer ids instead
+ * of copying strings for every event.
+ *
+ * Ids are only meaningful within the process: they are resolved back to
+ * strings to print or cache the results. Each thread keeps its own cache
+ * of the names it has seen, so interning a known name takes no lock and
+ * allocates nothing.
+ */
+class NameTable
+{
+public:
+    static NameTable &instance();
+
+    // Id of the empty string
+    static const name_id_t EMPTY = 0;
+
+    name_id_t intern(const char *name, size_t length);
+    name_id_t intern(const std::string &name);
+
+    /*!
+     * \brief Get the string of an id. The reference stays valid for the
+     * life of the program.
+     */
+    const std::string &resolve(name_id_t id) const;
+
+private:
+    NameTable();
+    name_id_t insert(const char *name, size_t length);
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, name_id_t> ids;
+    std::deque<std::string> names; // Never moves its elements
+};
+
+#endif // NAMETABLE_H
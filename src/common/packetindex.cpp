@@ -18,6 +18,7 @@
 
 #include "packetindex.h"
 
+#include <cstddef>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
@@ -30,46 +31,11 @@
 #define CTF_INDEX_MAJOR 1
 #define CTF_INDEX_MINOR 0
 
-using namespace tibee::trace;
-
-static inline
-uint64_t clock_cycles_to_ns(const ClockInfos &clock, uint64_t cycles)
-{
-    if (clock.freq == 1000000000ULL) {
-        /* 1GHZ freq, no need to scale cycles value */
-        return cycles;
-    } else {
-        return (double) cycles * 1000000000.0
-                / (double) clock.freq;
-    }
-}
-
-static inline
-uint64_t clock_offset_ns(const ClockInfos &clock)
-{
-    return clock.offset_s * 1000000000ULL
-            + clock_cycles_to_ns(clock, clock.offset);
-}
-
-static inline
-uint64_t ctf_get_real_timestamp(const ClockInfos &clock, uint64_t timestamp)
-{
-    uint64_t ts_nsec;
-    uint64_t tc_offset;
-
-    tc_offset = clock_offset_ns(clock);
-
-    ts_nsec = clock_cycles_to_ns(clock, timestamp);
-    ts_nsec += tc_offset;	/* Add offset */
-    return ts_nsec;
-}
-
-PacketIndex::PacketIndex(std::string packetIndexPath, const TraceSet &trace)
+PacketIndex::PacketIndex(std::string packetIndexPath, const TraceClock &clock)
 {
     FILE *fp = fopen(packetIndexPath.c_str(), "r");
     if (!fp) {
         std::cerr << "Error: could not open index file" << std::endl;
-        fclose(fp);
         return;
     }
 
@@ -99,11 +65,13 @@ PacketIndex::PacketIndex(std::string packetIndexPath, const TraceSet &trace)
         return;
     }
 
+    valid = true;
     CtfPacketIndex *ctfIndex = (CtfPacketIndex*) calloc(packetIndexLen, sizeof(char));
-    const auto &traceInfos = *trace.getTracesInfos().begin();
-    const auto &clockInfos = traceInfos->getClockInfos();
 
+    entryLen = packetIndexLen;
     while (fread(ctfIndex, packetIndexLen, 1, fp) == 1) {
+        const char *entry = reinterpret_cast<const char *>(ctfIndex);
+        rawEntries.insert(rawEntries.end(), entry, entry + packetIndexLen);
         PacketHeader index;
         memset(&index, 0, sizeof(index));
         index.offset = be64toh(ctfIndex->offset);
@@ -111,8 +79,8 @@ PacketIndex::PacketIndex(std::string packetIndexPath, const TraceSet &trace)
         index.contentSize = be64toh(ctfIndex->contentSize);
         index.tsCycles.timestampBegin = be64toh(ctfIndex->timestampBegin);
         index.tsCycles.timestampEnd = be64toh(ctfIndex->timestampEnd);
-        index.tsReal.timestampBegin = ctf_get_real_timestamp(clockInfos, index.tsCycles.timestampBegin);
-        index.tsReal.timestampEnd = ctf_get_real_timestamp(clockInfos, index.tsCycles.timestampEnd);
+        index.tsReal.timestampBegin = clock.toRealTimestamp(index.tsCycles.timestampBegin);
+        index.tsReal.timestampEnd = clock.toRealTimestamp(index.tsCycles.timestampEnd);
         index.eventsDiscarded = be64toh(ctfIndex->eventsDiscarded);
         index.eventsDiscardedLen = 64;
         index.dataOffset = -1;
@@ -133,3 +101,34 @@ int PacketIndex::getStreamId() const
 {
     return streamId;
 }
+
+bool PacketIndex::isValid() const
+{
+    return valid;
+}
+
+bool PacketIndex::writeSubset(const std::string &path, const std::vector<unsigned int> &packets,
+                              const std::vector<off_t> &offsets) const
+{
+    FILE *fp = fopen(path.c_str(), "w");
+    if (!fp) {
+        std::cerr << "Error: could not create index file " << path << std::endl;
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    std::vector<char> entry(entryLen);
+    for (unsigned int i = 0; ok && i < packets.size(); i++) {
+        // Copy the entry as is, only the offset changes
+        memcpy(entry.data(), &rawEntries[(size_t) packets[i] * entryLen], entryLen);
+        uint64_t offset = htobe64(offsets[i]);
+        memcpy(entry.data() + offsetof(CtfPacketIndex, offset), &offset, sizeof(offset));
+        ok = fwrite(entry.data(), entryLen, 1, fp) == 1;
+    }
+
+    ok = fclose(fp) == 0 && ok;
+    if (!ok) {
+        std::cerr << "Error: could not write index file " << path << std::endl;
+    }
+    return ok;
+}
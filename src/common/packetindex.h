@@ -25,9 +25,7 @@
 
 #include <sys/types.h>
 
-#include <trace/TraceSet.hpp>
-
-using namespace tibee::trace;
+#include "common/tracemetadata.h"
 
 /*
  * Header at the beginning of each index file.
@@ -75,13 +73,33 @@ typedef std::vector<PacketHeader> Indices;
 class PacketIndex
 {
 private:
-    int streamId;
+    int streamId = -1;
+    bool valid = false;
     CtfPacketIndexFileHeader header;
     std::vector<PacketHeader> indices;
+    std::vector<char> rawEntries;	/* entries as read from the file */
+    uint32_t entryLen = 0;
 public:
-    PacketIndex(std::string packetIndexPath, const TraceSet &trace);
+    PacketIndex(std::string packetIndexPath, const TraceClock &clock);
     const std::vector<PacketHeader> &getPacketIndex() const;
     int getStreamId() const;
+
+    /*!
+     * \brief Check that the index file could be opened and has a valid
+     * header. A valid index may have no packets.
+     */
+    bool isValid() const;
+
+    /*!
+     * \brief Write an index file for some of the packets, moved to new
+     * offsets. Entries are copied from the original file, so the fields
+     * that aren't parsed here are kept.
+     * \param path Path of the index file to write.
+     * \param packets Positions of the packets in this index.
+     * \param offsets New offset of each packet, in bytes.
+     */
+    bool writeSubset(const std::string &path, const std::vector<unsigned int> &packets,
+                     const std::vector<off_t> &offsets) const;
 };
 
 #endif // PACKETINDEX_H
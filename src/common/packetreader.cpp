@@ -0,0 +1,376 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "packetreader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "common/streamfilepool.h"
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+static size_t packetBytes(const PacketHeader &header)
+{
+    return header.packetSize / 8;
+}
+
+/*
+ * Read the whole range, even if the kernel returns less than asked.
+ */
+static bool preadFully(int fd, char *buf, size_t size, off_t offset)
+{
+    while (size > 0) {
+        ssize_t ret = pread(fd, buf, size, offset);
+        if (ret <= 0) {
+            return false;
+        }
+        buf += ret;
+        size -= ret;
+        offset += ret;
+    }
+    return true;
+}
+
+/*!
+ * \brief Maps the whole stream file and hands out pointers into it.
+ */
+class MmapPacketReader : public PacketReader
+{
+public:
+    MmapPacketReader(const Indices &packets) : PacketReader(packets), base(nullptr), length(0)
+    {
+    }
+
+    bool open(std::shared_ptr<StreamFile> streamFile)
+    {
+        file = streamFile;
+        base = file->getData();
+        length = file->getSize();
+        return base != nullptr;
+    }
+
+    virtual bool next(PacketBuffer &packet)
+    {
+        if (current >= packets.size()) {
+            return false;
+        }
+        const PacketHeader &header = packets[current];
+        if ((size_t) header.offset + packetBytes(header) > length) {
+            std::cerr << "Error: packet " << current << " is past the end of the stream file" << std::endl;
+            return false;
+        }
+        packet.data = base + header.offset;
+        packet.size = packetBytes(header);
+        packet.index = current++;
+        return true;
+    }
+
+private:
+    std::shared_ptr<StreamFile> file;
+    const char *base;
+    size_t length;
+};
+
+/*!
+ * \brief Reads each packet into a private buffer with pread().
+ */
+class ReadPacketReader : public PacketReader
+{
+public:
+    ReadPacketReader(const Indices &packets) : PacketReader(packets), fd(-1)
+    {
+    }
+
+    bool open(std::shared_ptr<StreamFile> streamFile)
+    {
+        file = streamFile;
+        fd = file->getFd();
+        return true;
+    }
+
+    virtual bool next(PacketBuffer &packet)
+    {
+        if (current >= packets.size()) {
+            return false;
+        }
+        const PacketHeader &header = packets[current];
+        buffer.resize(packetBytes(header));
+        if (!preadFully(fd, buffer.data(), buffer.size(), header.offset)) {
+            std::cerr << "Error: could not read packet " << current << std::endl;
+            return false;
+        }
+        packet.data = buffer.data();
+        packet.size = buffer.size();
+        packet.index = current++;
+        return true;
+    }
+
+private:
+    std::shared_ptr<StreamFile> file;
+    int fd;
+    std::vector<char> buffer;
+};
+
+#ifdef HAVE_LIBURING
+/*!
+ * \brief Keeps up to queueDepth packet reads in flight with io_uring.
+ *
+ * Packet i is always read into slot (i % slots), so packets complete
+ * in any order but are handed out in file order. The slot of the
+ * packet returned by the previous call is reused for the next packet
+ * to fetch, so the device always has a full queue.
+ */
+class UringPacketReader : public PacketReader
+{
+public:
+    UringPacketReader(const Indices &packets) : PacketReader(packets), fd(-1),
+        ringInitialized(false), fixedBuffers(false), nextToSubmit(0), lastSlot(-1)
+    {
+    }
+
+    ~UringPacketReader()
+    {
+        if (ringInitialized) {
+            // Wait for reads still in flight before freeing their buffers
+            for (unsigned int slot = 0; slot < slots.size(); slot++) {
+                while (slots[slot].inFlight && reap()) {
+                }
+            }
+            io_uring_queue_exit(&ring);
+        }
+        for (Slot &slot : slots) {
+            free(slot.buffer);
+        }
+    }
+
+    bool open(std::shared_ptr<StreamFile> streamFile, unsigned int queueDepth)
+    {
+        file = streamFile;
+        fd = file->getFd();
+        if (packets.empty()) {
+            return true;
+        }
+
+        size_t bufferSize = 0;
+        for (const PacketHeader &header : packets) {
+            bufferSize = std::max(bufferSize, packetBytes(header));
+        }
+        unsigned int numSlots = std::min<size_t>(std::max(queueDepth, 1u), packets.size());
+        slots.resize(numSlots);
+        std::vector<struct iovec> iovecs(numSlots);
+        for (unsigned int i = 0; i < numSlots; i++) {
+            if (posix_memalign(&slots[i].buffer, 4096, bufferSize) != 0) {
+                slots[i].buffer = nullptr;
+                return false;
+            }
+            iovecs[i].iov_base = slots[i].buffer;
+            iovecs[i].iov_len = bufferSize;
+        }
+
+        if (io_uring_queue_init(numSlots, &ring, 0) < 0) {
+            return false;
+        }
+        ringInitialized = true;
+
+        // Registered buffers need locked memory, fall back to plain reads
+        fixedBuffers = io_uring_register_buffers(&ring, iovecs.data(), numSlots) == 0;
+
+        for (unsigned int i = 0; i < numSlots; i++) {
+            submit(i);
+        }
+        return true;
+    }
+
+    virtual bool next(PacketBuffer &packet)
+    {
+        if (current >= packets.size()) {
+            return false;
+        }
+        if (lastSlot >= 0) {
+            submit(lastSlot);
+        }
+
+        unsigned int slotIndex = current % slots.size();
+        Slot &slot = slots[slotIndex];
+        while (slot.inFlight) {
+            if (!reap()) {
+                return false;
+            }
+        }
+
+        const PacketHeader &header = packets[current];
+        size_t size = packetBytes(header);
+        if (slot.result < 0) {
+            std::cerr << "Error: could not read packet " << current << ": "
+                      << strerror(-slot.result) << std::endl;
+            return false;
+        }
+        if ((size_t) slot.result < size) {
+            // Short read, get the rest synchronously
+            char *buf = static_cast<char *>(slot.buffer);
+            if (!preadFully(fd, buf + slot.result, size - slot.result, header.offset + slot.result)) {
+                std::cerr << "Error: could not read packet " << current << std::endl;
+                return false;
+            }
+        }
+
+        packet.data = static_cast<const char *>(slot.buffer);
+        packet.size = size;
+        packet.index = current++;
+        lastSlot = slotIndex;
+        return true;
+    }
+
+private:
+    struct Slot {
+        void *buffer = nullptr;
+        bool inFlight = false;
+        int result = 0;
+    };
+
+    void submit(unsigned int slotIndex)
+    {
+        if (nextToSubmit >= packets.size()) {
+            return;
+        }
+        const PacketHeader &header = packets[nextToSubmit++];
+        Slot &slot = slots[slotIndex];
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+        if (fixedBuffers) {
+            io_uring_prep_read_fixed(sqe, fd, slot.buffer, packetBytes(header), header.offset, slotIndex);
+        } else {
+            io_uring_prep_read(sqe, fd, slot.buffer, packetBytes(header), header.offset);
+        }
+        io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(static_cast<uintptr_t>(slotIndex)));
+        slot.inFlight = true;
+        io_uring_submit(&ring);
+    }
+
+    bool reap()
+    {
+        struct io_uring_cqe *cqe;
+        if (io_uring_wait_cqe(&ring, &cqe) < 0) {
+            std::cerr << "Error: io_uring_wait_cqe failed" << std::endl;
+            return false;
+        }
+        uintptr_t slotIndex = reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe));
+        slots[slotIndex].inFlight = false;
+        slots[slotIndex].result = cqe->res;
+        io_uring_cqe_seen(&ring, cqe);
+        return true;
+    }
+
+    std::shared_ptr<StreamFile> file;
+    int fd;
+    struct io_uring ring;
+    bool ringInitialized;
+    bool fixedBuffers;
+    std::vector<Slot> slots;
+    unsigned int nextToSubmit;
+    int lastSlot;
+};
+#endif
+
+PacketReader::PacketReader(const Indices &packets) : packets(packets)
+{
+}
+
+PacketReader::~PacketReader()
+{
+}
+
+std::unique_ptr<PacketReader> PacketReader::create(IoEngine engine, const std::string &streamPath,
+                                                   const Indices &packets, unsigned int queueDepth)
+{
+    (void) queueDepth;
+    std::shared_ptr<StreamFile> file = StreamFilePool::instance().acquire(streamPath);
+    if (!file) {
+        return nullptr;
+    }
+
+    switch (engine) {
+    case IoEngine::URING:
+#ifdef HAVE_LIBURING
+    {
+        std::unique_ptr<UringPacketReader> reader(new UringPacketReader(packets));
+        if (reader->open(file, queueDepth)) {
+            return std::move(reader);
+        }
+        std::cerr << "Warning: could not set up io_uring for " << streamPath
+                  << ", falling back to read" << std::endl;
+    }
+#else
+        std::cerr << "Warning: built without io_uring support, falling back to read" << std::endl;
+#endif
+        // Fall through
+    case IoEngine::READ:
+    {
+        std::unique_ptr<ReadPacketReader> reader(new ReadPacketReader(packets));
+        if (reader->open(file)) {
+            return std::move(reader);
+        }
+        break;
+    }
+    case IoEngine::MMAP:
+    {
+        std::unique_ptr<MmapPacketReader> reader(new MmapPacketReader(packets));
+        if (reader->open(file)) {
+            return std::move(reader);
+        }
+        break;
+    }
+    }
+    std::cerr << "Error: could not read stream file " << streamPath << std::endl;
+    return nullptr;
+}
+
+bool parseIoEngine(const std::string &name, IoEngine &engine)
+{
+    if (name == "mmap") {
+        engine = IoEngine::MMAP;
+    } else if (name == "read") {
+        engine = IoEngine::READ;
+    } else if (name == "uring") {
+        engine = IoEngine::URING;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string ioEngineName(IoEngine engine)
+{
+    switch (engine) {
+    case IoEngine::MMAP:
+        return "mmap";
+    case IoEngine::READ:
+        return "read";
+    case IoEngine::URING:
+        return "uring";
+    }
+    return "unknown";
+}
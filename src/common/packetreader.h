@@ -0,0 +1,77 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PACKETREADER_H
+#define PACKETREADER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/packetindex.h"
+
+enum class IoEngine { MMAP, READ, URING };
+
+/*
+ * A packet of a stream file, as read by a PacketReader.
+ */
+struct PacketBuffer {
+    const char *data = nullptr;
+    size_t size = 0;		/* packet size, in bytes */
+    unsigned int index = 0;	/* position of the packet in the reader's packet list */
+};
+
+/*!
+ * \brief The PacketReader class reads the packets of a stream file,
+ * in order, using the offsets and sizes given by the packet index.
+ */
+class PacketReader
+{
+public:
+    /*!
+     * \brief Create a reader for the given engine.
+     * \param engine The I/O engine to use.
+     * \param streamPath Path to the stream file.
+     * \param packets The packets to read, in file order.
+     * \param queueDepth Number of packets in flight (io_uring only).
+     * \return The reader, or nullptr if the stream could not be opened.
+     */
+    static std::unique_ptr<PacketReader> create(IoEngine engine, const std::string &streamPath,
+                                                const Indices &packets, unsigned int queueDepth);
+
+    virtual ~PacketReader();
+
+    /*!
+     * \brief Get the next packet. The buffer stays valid until the
+     * following call to next().
+     * \return false once all the packets have been read.
+     */
+    virtual bool next(PacketBuffer &packet) = 0;
+
+protected:
+    PacketReader(const Indices &packets);
+
+    Indices packets;
+    unsigned int current = 0;
+};
+
+bool parseIoEngine(const std::string &name, IoEngine &engine);
+std::string ioEngineName(IoEngine engine);
+
+#endif // PACKETREADER_H
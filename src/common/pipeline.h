@@ -0,0 +1,254 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "common/recordbatch.h"
+#include "common/spscqueue.h"
+#include "ctf/ctftrace.h"
+
+/*
+ * Work done by a stage of a Pipeline.
+ */
+struct PipelineStageStats {
+    uint64_t events = 0;	/* decoded, decoder stages only */
+    uint64_t records = 0;	/* pushed or handled */
+    double seconds = 0;
+    double stalledSeconds = 0;	/* waiting on a full or empty queue */
+    bool failed = false;	/* could not open its streams, decoder stages only */
+};
+
+/*!
+ * \brief The Pipeline class runs the decoding and the analysis of a chunk
+ * on separate threads.
+ *
+ * The stream files are split between decoder threads, each merging its
+ * streams in time order and pushing the records of the events it decodes
+ * into its own SpscQueue. The calling thread merges the queues in time
+ * order and hands the records to the analysis in batches. Records must
+ * have a timestamp member.
+ */
+template <typename Record>
+class Pipeline
+{
+public:
+    static const size_t DEFAULT_QUEUE_CAPACITY = 1 << 14;
+
+    /*!
+     * \param decoders Number of decoder threads, at most one per stream.
+     */
+    Pipeline(unsigned int decoders, size_t queueCapacity = DEFAULT_QUEUE_CAPACITY) :
+        decoders(std::max(decoders, 1u)), queueCapacity(queueCapacity)
+    {
+    }
+
+    /*!
+     * \brief Decode and analyze the events between two timestamps.
+     * \param decode Called as decode(event, record) on the decoder
+     * threads, returns false if the event has no record. It must be safe
+     * to call from several threads at once.
+     * \param handle Called as handle(records, count) on the calling
+     * thread, in time order.
+     * \return false if a stream file could not be opened, the records are
+     * then incomplete.
+     */
+    template <typename Decode, typename Handle>
+    bool run(const CtfTrace &trace, const uint64_t *begin, const uint64_t *end,
+             const CtfProjection &projection, Decode decode, Handle handle)
+    {
+        // Spread the streams over the decoders
+        size_t numStreams = trace.getIndex().getStreams().size();
+        std::vector<std::vector<size_t>> streams(std::min<size_t>(decoders, numStreams));
+        for (size_t i = 0; i < numStreams; i++) {
+            streams[i % streams.size()].push_back(i);
+        }
+
+        std::vector<std::unique_ptr<SpscQueue<Record>>> queues;
+        decoderStats.assign(streams.size(), PipelineStageStats());
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < streams.size(); i++) {
+            queues.emplace_back(new SpscQueue<Record>(queueCapacity));
+            SpscQueue<Record> *queue = queues.back().get();
+            PipelineStageStats *stats = &decoderStats[i];
+            const std::vector<size_t> *decoderStreams = &streams[i];
+            threads.emplace_back([=, &trace, &projection, &decode]() {
+                runDecoder(trace, begin, end, projection, *decoderStreams, decode, *queue, *stats);
+            });
+        }
+        runAnalysis(queues, handle);
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        return std::none_of(decoderStats.begin(), decoderStats.end(), [](const PipelineStageStats &stats) {
+            return stats.failed;
+        });
+    }
+
+    const std::vector<PipelineStageStats> &getDecoderStats() const
+    {
+        return decoderStats;
+    }
+
+    const PipelineStageStats &getAnalysisStats() const
+    {
+        return analysisStats;
+    }
+
+    /*!
+     * \brief Print the throughput of each stage of the last run.
+     */
+    void printStats(std::ostream &out, int worker) const
+    {
+        for (size_t i = 0; i < decoderStats.size(); i++) {
+            const PipelineStageStats &stats = decoderStats[i];
+            out << "Worker " << worker << " decoder " << i << " decoded " << stats.events << " events into "
+                << stats.records << " records in " << stats.seconds << " s ("
+                << rate(stats.events, stats.seconds) << " events/s, " << stats.stalledSeconds
+                << " s waiting on the analysis)" << std::endl;
+        }
+        out << "Worker " << worker << " analysis handled " << analysisStats.records << " records in "
+            << analysisStats.seconds << " s (" << rate(analysisStats.records, analysisStats.seconds)
+            << " records/s, " << analysisStats.stalledSeconds << " s waiting on the decoders)" << std::endl;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static double seconds(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    static double rate(uint64_t count, double seconds)
+    {
+        return seconds > 0 ? count / seconds : 0;
+    }
+
+    template <typename Decode>
+    static void runDecoder(const CtfTrace &trace, const uint64_t *begin, const uint64_t *end,
+                           const CtfProjection &projection, const std::vector<size_t> &streams,
+                           Decode &decode, SpscQueue<Record> &queue, PipelineStageStats &stats)
+    {
+        Clock::time_point start = Clock::now();
+        Record record;
+        CtfTrace::Iterator iter = trace.between(begin, end, projection, streams);
+        CtfTrace::Iterator endIter = trace.end();
+        for ((void)iter; iter != endIter; ++iter) {
+            stats.events++;
+            if (!decode(*iter, record)) {
+                continue;
+            }
+            if (!queue.tryPush(record)) {
+                Clock::time_point stall = Clock::now();
+                while (!queue.tryPush(record)) {
+                    std::this_thread::yield();
+                }
+                stats.stalledSeconds += seconds(stall);
+            }
+            stats.records++;
+        }
+        queue.close();
+        stats.failed = iter.hasFailed();
+        stats.seconds = seconds(start);
+    }
+
+    template <typename Handle>
+    void runAnalysis(std::vector<std::unique_ptr<SpscQueue<Record>>> &queues, Handle &handle)
+    {
+        analysisStats = PipelineStageStats();
+        Clock::time_point start = Clock::now();
+        std::vector<SpscQueue<Record> *> open;
+        for (auto &queue : queues) {
+            open.push_back(queue.get());
+        }
+
+        RecordBatch<Record> batch;
+        while (!open.empty()) {
+            // The earliest record can only be known once every open queue
+            // has one
+            SpscQueue<Record> *earliest = nullptr;
+            const Record *first = nullptr;
+            for (size_t i = 0; i < open.size(); i++) {
+                const Record *head = waitFront(*open[i], batch, handle);
+                if (!head) {
+                    open.erase(open.begin() + i--);
+                } else if (!first || head->timestamp < first->timestamp) {
+                    earliest = open[i];
+                    first = head;
+                }
+            }
+            if (!first) {
+                break;
+            }
+            batch.add() = *first;
+            earliest->pop();
+            if (batch.isFull()) {
+                flush(batch, handle);
+            }
+        }
+        flush(batch, handle);
+        analysisStats.seconds = seconds(start);
+    }
+
+    /*
+     * Wait for a queue to have a record, or to be done. What is batched
+     * is handled before waiting, so the decoders aren't kept waiting on
+     * a partial batch.
+     */
+    template <typename Handle>
+    const Record *waitFront(SpscQueue<Record> &queue, RecordBatch<Record> &batch, Handle &handle)
+    {
+        const Record *head = queue.front();
+        if (head) {
+            return head;
+        }
+        flush(batch, handle);
+        Clock::time_point stall = Clock::now();
+        while (!(head = queue.front()) && !queue.isDone()) {
+            std::this_thread::yield();
+        }
+        analysisStats.stalledSeconds += seconds(stall);
+        return head;
+    }
+
+    template <typename Handle>
+    void flush(RecordBatch<Record> &batch, Handle &handle)
+    {
+        if (batch.size() > 0) {
+            handle(batch.data(), batch.size());
+            analysisStats.records += batch.size();
+            batch.clear();
+        }
+    }
+
+    unsigned int decoders;
+    size_t queueCapacity;
+    std::vector<PipelineStageStats> decoderStats;
+    PipelineStageStats analysisStats;
+};
+
+#endif // PIPELINE_H
@@ -0,0 +1,51 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "readahead.h"
+
+#include "common/streamfilepool.h"
+
+#include <fcntl.h>
+
+StreamReadahead::StreamReadahead(const std::string &streamPath) : path(streamPath)
+{
+    // The whole file will be read front to back, also after the pool
+    // closes and reopens it
+    StreamFilePool::instance().setSequential(path);
+}
+
+void StreamReadahead::willNeed(const ChunkExtent &extent) const
+{
+    advise(extent, POSIX_FADV_WILLNEED);
+}
+
+void StreamReadahead::dontNeed(const ChunkExtent &extent) const
+{
+    advise(extent, POSIX_FADV_DONTNEED);
+}
+
+void StreamReadahead::advise(const ChunkExtent &extent, int advice) const
+{
+    if (extent.length <= 0) {
+        return;
+    }
+    std::shared_ptr<StreamFile> file = StreamFilePool::instance().acquire(path);
+    if (file) {
+        posix_fadvise(file->getFd(), extent.offset, extent.length, advice);
+    }
+}
@@ -0,0 +1,62 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include <string>
+
+#include <sys/types.h>
+
+/*
+ * Byte range of a chunk inside its stream file.
+ */
+struct ChunkExtent {
+    off_t offset = 0;
+    off_t length = 0;
+};
+
+/*!
+ * \brief The StreamReadahead class gives page cache hints for a
+ * stream file, so that chunks are read ahead of the workers and
+ * dropped from the cache once they have been consumed.
+ *
+ * The file is borrowed from the StreamFilePool for each hint, so that
+ * streams waiting for their turn don't hold a file descriptor.
+ */
+class StreamReadahead {
+public:
+    StreamReadahead(const std::string &streamPath);
+
+    /*!
+     * \brief Ask the kernel to start reading the extent in the background.
+     */
+    void willNeed(const ChunkExtent &extent) const;
+
+    /*!
+     * \brief Tell the kernel the extent will not be read again.
+     */
+    void dontNeed(const ChunkExtent &extent) const;
+
+private:
+    void advise(const ChunkExtent &extent, int advice) const;
+
+    std::string path;
+};
+
+#endif // READAHEAD_H
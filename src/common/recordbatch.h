@@ -0,0 +1,82 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RECORDBATCH_H
+#define RECORDBATCH_H
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+/*!
+ * \brief The RecordBatch class accumulates the decoded fields of events
+ * of one type as plain records, so that they are handed to the analysis
+ * handlers as an array instead of one event at a time.
+ *
+ * Decoding a batch and then running the handlers over it keeps each loop
+ * small: the decoder doesn't evict the state of the analysis from the
+ * caches, and the handlers run without branching on the event type.
+ */
+template <typename Record>
+class RecordBatch
+{
+    static_assert(std::is_pod<Record>::value, "Batched records must be plain old data");
+
+public:
+    // Enough records to amortize the handler calls, small enough to stay in L2
+    static const size_t DEFAULT_CAPACITY = 4096;
+
+    RecordBatch(size_t capacity = DEFAULT_CAPACITY) : records(capacity), count(0)
+    {
+    }
+
+    /*!
+     * \brief Get the next record to fill. Only valid if the batch isn't
+     * full.
+     */
+    Record &add()
+    {
+        return records[count++];
+    }
+
+    bool isFull() const
+    {
+        return count == records.size();
+    }
+
+    const Record *data() const
+    {
+        return records.data();
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    void clear()
+    {
+        count = 0;
+    }
+
+private:
+    std::vector<Record> records;
+    size_t count;
+};
+
+#endif // RECORDBATCH_H
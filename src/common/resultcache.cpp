@@ -0,0 +1,65 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resultcache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+
+ResultCache::ResultCache(const QString &cachePath, const QString &analysisName, int analysisVersion) :
+    cacheDir(QDir(cachePath).absoluteFilePath(analysisName)), analysisName(analysisName),
+    analysisVersion(analysisVersion), hits(0), misses(0)
+{
+    QDir().mkpath(cacheDir);
+}
+
+QByteArray ResultCache::makeKey(const QStringList &chunk) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(analysisName.toUtf8());
+    hash.addData(QString::number(analysisVersion).toUtf8());
+    for (const QString &line : chunk) {
+        hash.addData("\n", 1);
+        hash.addData(line.toUtf8());
+    }
+    return hash.result().toHex();
+}
+
+QString ResultCache::getFileIdentity(const QString &path)
+{
+    QFileInfo fileInfo(path);
+    return QString("%1 %2 %3").arg(fileInfo.fileName()).arg(fileInfo.size())
+            .arg(fileInfo.lastModified().toMSecsSinceEpoch());
+}
+
+int ResultCache::getHits() const
+{
+    return hits;
+}
+
+int ResultCache::getMisses() const
+{
+    return misses;
+}
+
+QString ResultCache::getFilePath(const QByteArray &key) const
+{
+    return QDir(cacheDir).absoluteFilePath(QString::fromLatin1(key) + ".result");
+}
@@ -0,0 +1,121 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+
+/*!
+ * \brief The ResultCache class keeps the map results of an analysis on
+ * disk, so that re-running it on an unchanged trace only maps the chunks
+ * that are not cached yet.
+ *
+ * A chunk is identified by a key built from the analysis name and
+ * version and a description of the chunk: the identity (name, size and
+ * modification time) of the files it reads, or the packets it covers.
+ * Results are read and written with QDataStream, so a result type only
+ * needs the QDataStream operators.
+ */
+class ResultCache
+{
+public:
+    ResultCache(const QString &cachePath, const QString &analysisName, int analysisVersion);
+
+    /*!
+     * \brief Build the key of a chunk from the lines describing it.
+     */
+    QByteArray makeKey(const QStringList &chunk) const;
+
+    /*!
+     * \brief Load a cached result.
+     * \return false if the result is missing or unreadable.
+     */
+    template <typename T>
+    bool load(const QByteArray &key, T &value) const
+    {
+        QFile file(getFilePath(key));
+        if (!file.open(QIODevice::ReadOnly)) {
+            misses++;
+            return false;
+        }
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_5_2);
+        quint32 magic;
+        qint32 version;
+        in >> magic >> version;
+        if (magic != MAGIC || version != analysisVersion) {
+            misses++;
+            return false;
+        }
+        T result;
+        in >> result;
+        if (in.status() != QDataStream::Ok) {
+            misses++;
+            return false;
+        }
+        value = std::move(result);
+        hits++;
+        return true;
+    }
+
+    /*!
+     * \brief Save a result. The file is replaced atomically, so that
+     * concurrent or interrupted runs never leave a partial result.
+     */
+    template <typename T>
+    void store(const QByteArray &key, const T &value) const
+    {
+        QSaveFile file(getFilePath(key));
+        if (!file.open(QIODevice::WriteOnly)) {
+            return;
+        }
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_5_2);
+        out << MAGIC << (qint32) analysisVersion << value;
+        file.commit();
+    }
+
+    /*!
+     * \brief Get the identity of a file: its name, size and modification time.
+     */
+    static QString getFileIdentity(const QString &path);
+
+    int getHits() const;
+    int getMisses() const;
+
+private:
+    static const quint32 MAGIC = 0x4c504152; // "LPAR"
+
+    QString getFilePath(const QByteArray &key) const;
+
+    QString cacheDir;
+    QString analysisName;
+    int analysisVersion;
+    mutable std::atomic<int> hits;
+    mutable std::atomic<int> misses;
+};
+
+#endif // RESULTCACHE_H
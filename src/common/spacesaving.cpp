@@ -0,0 +1,237 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spacesaving.h"
+
+#include <algorithm>
+
+size_t SpaceSaving::getCapacity() const
+{
+    return capacity;
+}
+
+void SpaceSaving::setCapacity(size_t value)
+{
+    capacity = value;
+}
+
+bool SpaceSaving::isEnabled() const
+{
+    return capacity != 0;
+}
+
+void SpaceSaving::add(int key, uint64_t weight, name_id_t name)
+{
+    total += weight;
+    size_t *position = positions.find(key);
+    if (position) {
+        Counter &counter = heap[*position];
+        counter.weight += weight;
+        if (name != NameTable::EMPTY) {
+            counter.name = name;
+        }
+        siftDown(*position);
+        return;
+    }
+
+    Counter counter;
+    counter.key = key;
+    counter.weight = weight;
+    counter.name = name;
+    if (heap.size() < capacity) {
+        heap.push_back(counter);
+        positions[key] = heap.size() - 1;
+        siftUp(heap.size() - 1);
+        return;
+    }
+
+    // Replace the lightest key, whose weight bounds the one of the new key
+    // before now
+    Counter &lightest = heap[0];
+    positions.erase(lightest.key);
+    counter.error = lightest.weight;
+    counter.weight += lightest.weight;
+    lightest = counter;
+    positions[key] = 0;
+    siftDown(0);
+}
+
+void SpaceSaving::merge(const SpaceSaving &other)
+{
+    if (!capacity) {
+        capacity = other.capacity;
+    }
+    if (other.heap.empty()) {
+        return;
+    }
+
+    // A key missing from a full sketch may have had up to its smallest
+    // weight there
+    uint64_t thisMin = getMinWeight();
+    uint64_t otherMin = other.getMinWeight();
+    std::vector<Counter> counters;
+    counters.reserve(heap.size() + other.heap.size());
+    for (const Counter &counter : heap) {
+        counters.push_back(counter);
+        const size_t *otherPosition = other.positions.find(counter.key);
+        if (otherPosition) {
+            const Counter &otherCounter = other.heap[*otherPosition];
+            counters.back().weight += otherCounter.weight;
+            counters.back().error += otherCounter.error;
+            if (otherCounter.name != NameTable::EMPTY) {
+                counters.back().name = otherCounter.name;
+            }
+        } else {
+            counters.back().weight += otherMin;
+            counters.back().error += otherMin;
+        }
+    }
+    for (const Counter &otherCounter : other.heap) {
+        if (!positions.contains(otherCounter.key)) {
+            counters.push_back(otherCounter);
+            counters.back().weight += thisMin;
+            counters.back().error += thisMin;
+        }
+    }
+
+    // Keep the heaviest keys
+    if (counters.size() > capacity) {
+        std::nth_element(counters.begin(), counters.begin() + capacity, counters.end(),
+                         [](const Counter &a, const Counter &b) {
+            return a.weight > b.weight;
+        });
+        counters.resize(capacity);
+    }
+    heap.swap(counters);
+    total += other.total;
+    rebuild();
+}
+
+std::vector<SpaceSaving::Counter> SpaceSaving::getTop(size_t count) const
+{
+    std::vector<Counter> top = heap;
+    count = std::min(count, top.size());
+    std::partial_sort(top.begin(), top.begin() + count, top.end(), [](const Counter &a, const Counter &b) {
+        return a.weight - a.error > b.weight - b.error;
+    });
+    top.resize(count);
+    return top;
+}
+
+uint64_t SpaceSaving::getTotal() const
+{
+    return total;
+}
+
+name_id_t SpaceSaving::getName(int key) const
+{
+    const size_t *position = positions.find(key);
+    return position ? heap[*position].name : NameTable::EMPTY;
+}
+
+uint64_t SpaceSaving::getMaxError() const
+{
+    return capacity ? total / capacity : 0;
+}
+
+uint64_t SpaceSaving::getMinWeight() const
+{
+    return heap.size() < capacity || heap.empty() ? 0 : heap[0].weight;
+}
+
+void SpaceSaving::siftUp(size_t index)
+{
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (heap[parent].weight <= heap[index].weight) {
+            return;
+        }
+        std::swap(heap[index], heap[parent]);
+        positions[heap[index].key] = index;
+        positions[heap[parent].key] = parent;
+        index = parent;
+    }
+}
+
+void SpaceSaving::siftDown(size_t index)
+{
+    size_t size = heap.size();
+    while (true) {
+        size_t smallest = index;
+        size_t left = 2 * index + 1;
+        size_t right = left + 1;
+        if (left < size && heap[left].weight < heap[smallest].weight) {
+            smallest = left;
+        }
+        if (right < size && heap[right].weight < heap[smallest].weight) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            return;
+        }
+        std::swap(heap[index], heap[smallest]);
+        positions[heap[index].key] = index;
+        positions[heap[smallest].key] = smallest;
+        index = smallest;
+    }
+}
+
+void SpaceSaving::rebuild()
+{
+    std::make_heap(heap.begin(), heap.end(), [](const Counter &a, const Counter &b) {
+        return a.weight > b.weight;
+    });
+    positions.clear();
+    for (size_t i = 0; i < heap.size(); i++) {
+        positions[heap[i].key] = i;
+    }
+}
+
+QDataStream &operator<<(QDataStream &out, const SpaceSaving &sketch)
+{
+    out << (quint64) sketch.capacity << (quint64) sketch.total << (quint32) sketch.heap.size();
+    for (const SpaceSaving::Counter &counter : sketch.heap) {
+        out << (qint32) counter.key << (quint64) counter.weight << (quint64) counter.error
+            << QString::fromStdString(NameTable::instance().resolve(counter.name));
+    }
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, SpaceSaving &sketch)
+{
+    quint64 capacity, total;
+    quint32 size;
+    in >> capacity >> total >> size;
+    sketch.capacity = capacity;
+    sketch.total = total;
+    sketch.heap.clear();
+    for (quint32 i = 0; i < size && in.status() == QDataStream::Ok; i++) {
+        qint32 key;
+        quint64 weight, error;
+        QString name;
+        in >> key >> weight >> error >> name;
+        SpaceSaving::Counter counter;
+        counter.key = key;
+        counter.weight = weight;
+        counter.error = error;
+        counter.name = NameTable::instance().intern(name.toStdString());
+        sketch.heap.push_back(counter);
+    }
+    sketch.rebuild();
+    return in;
+}
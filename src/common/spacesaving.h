@@ -0,0 +1,104 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPACESAVING_H
+#define SPACESAVING_H
+
+#include "common/flatmap.h"
+#include "common/nametable.h"
+
+#include <QDataStream>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*!
+ * \brief The SpaceSaving class finds the keys with the largest total
+ * weight, such as the TIDs with the most CPU time, in a fixed number of
+ * counters whatever the number of keys.
+ *
+ * When all the counters are taken, a new key replaces the one with the
+ * smallest weight and inherits its weight as error (weighted Space-Saving,
+ * Metwally et al.). The weight of a key is never underestimated, and is
+ * overestimated by at most the total weight divided by the capacity, so
+ * every key heavier than that is kept. Two sketches merge in O(capacity),
+ * keeping the same bound over the sum of their weights (Cafaro et al.).
+ */
+class SpaceSaving
+{
+public:
+    struct Counter {
+        int key = 0;
+        uint64_t weight = 0;	/* upper bound of the real weight */
+        uint64_t error = 0;	/* weight - error is a lower bound */
+        name_id_t name = NameTable::EMPTY;
+    };
+
+    size_t getCapacity() const;
+    void setCapacity(size_t value);
+
+    /*!
+     * \brief Whether a capacity was set, the sketch is empty otherwise.
+     */
+    bool isEnabled() const;
+
+    /*!
+     * \brief Add weight to a key. The name is kept with the key, unless it
+     * is NameTable::EMPTY.
+     */
+    void add(int key, uint64_t weight, name_id_t name = NameTable::EMPTY);
+    void merge(const SpaceSaving &other);
+
+    /*!
+     * \brief Get the counters with the largest guaranteed weights
+     * (weight - error), largest first. Ranking on the guaranteed weight
+     * keeps light keys that inherited a large error out of the top.
+     */
+    std::vector<Counter> getTop(size_t count) const;
+
+    /*!
+     * \brief Get the name kept with a key, or NameTable::EMPTY if the key
+     * has no counter.
+     */
+    name_id_t getName(int key) const;
+
+    uint64_t getTotal() const;
+
+    /*!
+     * \brief Get the bound on the overestimation of each weight.
+     */
+    uint64_t getMaxError() const;
+
+    // Serialization of the map results, for the result cache
+    friend QDataStream &operator<<(QDataStream &out, const SpaceSaving &sketch);
+    friend QDataStream &operator>>(QDataStream &in, SpaceSaving &sketch);
+
+private:
+    uint64_t getMinWeight() const;
+    void siftUp(size_t index);
+    void siftDown(size_t index);
+    void rebuild();
+
+    size_t capacity = 0;
+    uint64_t total = 0;
+    std::vector<Counter> heap;		/* min-heap on the weight */
+    FlatMap<size_t> positions;		/* position in the heap of each key */
+};
+
+#endif // SPACESAVING_H
@@ -0,0 +1,137 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/*!
+ * \brief The SpscQueue class is a bounded lock-free ring buffer between
+ * one producer thread and one consumer thread.
+ *
+ * Each side only writes its own index, and keeps a copy of the index of
+ * the other side that it refreshes when the queue looks full or empty,
+ * so the indices only bounce between caches once per lap in steady state.
+ */
+template <typename T>
+class SpscQueue
+{
+public:
+    /*!
+     * \param capacity Number of slots, rounded up to a power of two.
+     */
+    SpscQueue(size_t capacity) : head(0), cachedTail(0), tail(0), cachedHead(0), closed(false)
+    {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        buffer.resize(size);
+        mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue &other) = delete;
+    SpscQueue &operator=(const SpscQueue &other) = delete;
+
+    /*!
+     * \brief Add a value, from the producer thread.
+     * \return false if the queue is full.
+     */
+    bool tryPush(const T &value)
+    {
+        size_t current = tail.load(std::memory_order_relaxed);
+        if (current - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (current - cachedHead > mask) {
+                return false;
+            }
+        }
+        buffer[current & mask] = value;
+        tail.store(current + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+     * \brief Tell the consumer no more values will be pushed, from the
+     * producer thread.
+     */
+    void close()
+    {
+        closed.store(true, std::memory_order_release);
+    }
+
+    /*!
+     * \brief Get the oldest value, from the consumer thread, without
+     * removing it.
+     * \return The value, or nullptr if the queue is empty.
+     */
+    const T *front()
+    {
+        size_t current = head.load(std::memory_order_relaxed);
+        if (current == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (current == cachedTail) {
+                return nullptr;
+            }
+        }
+        return &buffer[current & mask];
+    }
+
+    /*!
+     * \brief Remove the value returned by front().
+     */
+    void pop()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /*!
+     * \brief Whether the queue is empty and will stay empty, from the
+     * consumer thread.
+     */
+    bool isDone()
+    {
+        // Values pushed before close() must be seen before it
+        return closed.load(std::memory_order_acquire) && !front();
+    }
+
+private:
+    // The indices of each side are padded to their own cache line
+    static const size_t CACHE_LINE = 64;
+
+    std::vector<T> buffer;
+    size_t mask;
+    char padding0[CACHE_LINE];
+
+    // Written by the consumer
+    std::atomic<size_t> head;
+    size_t cachedTail;
+    char padding1[CACHE_LINE];
+
+    // Written by the producer
+    std::atomic<size_t> tail;
+    size_t cachedHead;
+    char padding2[CACHE_LINE];
+
+    std::atomic<bool> closed;
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,210 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "streamfilepool.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+StreamFile::StreamFile(const std::string &path) : size(0), data(nullptr)
+{
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+        size = st.st_size;
+    }
+}
+
+StreamFile::~StreamFile()
+{
+    if (data) {
+        munmap(data, size);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool StreamFile::isOpen() const
+{
+    return fd >= 0;
+}
+
+int StreamFile::getFd() const
+{
+    return fd;
+}
+
+size_t StreamFile::getSize() const
+{
+    return size;
+}
+
+const char *StreamFile::getData()
+{
+    std::call_once(mapped, [this]() {
+        if (fd < 0 || size == 0) {
+            return;
+        }
+        void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            std::cerr << "Error: could not map stream file" << std::endl;
+            return;
+        }
+        data = static_cast<char *>(addr);
+        madvise(data, size, MADV_SEQUENTIAL);
+    });
+    return data;
+}
+
+StreamFilePool &StreamFilePool::instance()
+{
+    static StreamFilePool pool;
+    return pool;
+}
+
+StreamFilePool::StreamFilePool() : overflowReported(false)
+{
+    // Leave most descriptors to babeltrace, which opens its own files
+    size_t openFileLimit = raiseOpenFileLimit();
+    capacity = std::max<size_t>(16, openFileLimit / 4);
+    limit = std::max<size_t>(capacity, openFileLimit / 2);
+}
+
+std::shared_ptr<StreamFile> StreamFilePool::acquire(const std::string &path)
+{
+    std::lock_guard<std::mutex> guard(mutex); (void) guard;
+
+    auto iter = files.find(path);
+    if (iter != files.end()) {
+        // Move to the front of the LRU list
+        lru.splice(lru.begin(), lru, iter->second.lruPos);
+        return iter->second.file;
+    }
+
+    // Also shrinks the pool back once borrowed files were given back
+    while (files.size() >= capacity && evict()) {
+    }
+    if (files.size() >= capacity) {
+        // Every file is borrowed
+        if (files.size() >= limit) {
+            std::cerr << "Error: could not open stream file " << path << ", all "
+                      << files.size() << " pooled stream files are in use" << std::endl;
+            return nullptr;
+        }
+        if (!overflowReported) {
+            std::cerr << "Warning: all " << files.size() << " pooled stream files are in use, "
+                      << "opening more than the pool capacity of " << capacity << std::endl;
+            overflowReported = true;
+        }
+    }
+
+    std::shared_ptr<StreamFile> file = std::make_shared<StreamFile>(path);
+    if (!file->isOpen()) {
+        std::cerr << "Error: could not open stream file " << path << std::endl;
+        return nullptr;
+    }
+    if (sequential.count(path) > 0) {
+        posix_fadvise(file->getFd(), 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    lru.push_front(path);
+    Entry entry;
+    entry.file = file;
+    entry.lruPos = lru.begin();
+    files.emplace(path, std::move(entry));
+    return file;
+}
+
+void StreamFilePool::invalidate(const std::string &path)
+{
+    std::lock_guard<std::mutex> guard(mutex); (void) guard;
+    std::string dirPrefix = path + "/";
+    for (auto iter = files.begin(); iter != files.end();) {
+        const std::string &filePath = iter->first;
+        if (filePath == path || filePath.compare(0, dirPrefix.size(), dirPrefix) == 0) {
+            lru.erase(iter->second.lruPos);
+            iter = files.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+void StreamFilePool::setSequential(const std::string &path)
+{
+    std::lock_guard<std::mutex> guard(mutex); (void) guard;
+    sequential.insert(path);
+    auto iter = files.find(path);
+    if (iter != files.end()) {
+        posix_fadvise(iter->second.file->getFd(), 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+}
+
+size_t StreamFilePool::getCapacity() const
+{
+    return capacity;
+}
+
+void StreamFilePool::setCapacity(size_t value)
+{
+    std::lock_guard<std::mutex> guard(mutex); (void) guard;
+    capacity = std::max<size_t>(1, value);
+    limit = std::max(limit, capacity);
+    while (files.size() > capacity && evict()) {
+    }
+}
+
+bool StreamFilePool::evict()
+{
+    // Close the least recently used file nobody is borrowing
+    for (auto iter = lru.rbegin(); iter != lru.rend(); ++iter) {
+        auto fileIter = files.find(*iter);
+        if (fileIter->second.file.use_count() == 1) {
+            lru.erase(fileIter->second.lruPos);
+            files.erase(fileIter);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t raiseOpenFileLimit()
+{
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) < 0) {
+        return 1024;
+    }
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (limit.rlim_cur == RLIM_INFINITY) {
+        return 1 << 20;
+    }
+    return limit.rlim_cur;
+}
@@ -0,0 +1,126 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STREAMFILEPOOL_H
+#define STREAMFILEPOOL_H
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+/*!
+ * \brief The StreamFile class is an open stream file shared through
+ * the StreamFilePool. The file is mapped on first use, and the mapping
+ * lives as long as the file stays in the pool.
+ */
+class StreamFile
+{
+public:
+    StreamFile(const std::string &path);
+
+    // Copying isn't allowed
+    StreamFile(const StreamFile &other) = delete;
+    StreamFile &operator=(const StreamFile &other) = delete;
+
+    ~StreamFile();
+
+    bool isOpen() const;
+    int getFd() const;
+    size_t getSize() const;
+
+    /*!
+     * \brief Map the whole file if it isn't mapped yet.
+     * \return The mapping, or nullptr if the file could not be mapped.
+     */
+    const char *getData();
+
+private:
+    int fd;
+    size_t size;
+    char *data;
+    std::once_flag mapped;
+};
+
+/*!
+ * \brief The StreamFilePool class keeps a bounded number of stream files
+ * open and mapped, so workers borrow them instead of opening them for
+ * every chunk.
+ *
+ * Files that are not borrowed are closed in least recently used order
+ * once the pool is full. Borrowed files are never closed: when they are
+ * all in use, since a single chunk may read more streams than the
+ * capacity, the pool reports it and grows up to its limit, past which
+ * acquire() fails.
+ */
+class StreamFilePool
+{
+public:
+    static StreamFilePool &instance();
+
+    /*!
+     * \brief Borrow a stream file. It is given back to the pool when
+     * the last reference to it is released.
+     * \return The file, or nullptr if it could not be opened.
+     */
+    std::shared_ptr<StreamFile> acquire(const std::string &path);
+
+    /*!
+     * \brief Forget a file, or all the files under a directory, so that
+     * the next acquire() opens them again. Borrowers keep their files.
+     */
+    void invalidate(const std::string &path);
+
+    /*!
+     * \brief Advise the kernel that a file is read front to back. The
+     * advice is given again each time the pool reopens the file, since
+     * it is lost when the file is closed.
+     */
+    void setSequential(const std::string &path);
+
+    size_t getCapacity() const;
+    void setCapacity(size_t value);
+
+private:
+    StreamFilePool();
+    bool evict();
+
+    struct Entry {
+        std::shared_ptr<StreamFile> file;
+        std::list<std::string>::iterator lruPos;
+    };
+
+    std::mutex mutex;
+    size_t capacity;
+    size_t limit; // Files open at once, borrowed or not
+    bool overflowReported;
+    std::list<std::string> lru; // Most recently used first
+    std::unordered_map<std::string, Entry> files;
+    std::unordered_set<std::string> sequential;
+};
+
+/*!
+ * \brief Raise the soft limit on open files up to the hard limit.
+ * \return The new soft limit.
+ */
+size_t raiseOpenFileLimit();
+
+#endif // STREAMFILEPOOL_H
@@ -0,0 +1,172 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIMESERIES_H
+#define TIMESERIES_H
+
+#include <QDataStream>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/*!
+ * \brief The TimeSeries class accumulates values into fixed-width time
+ * buckets.
+ *
+ * Buckets are aligned on multiples of the width since the epoch rather
+ * than on the bounds of a chunk, so the series of two chunks line up
+ * and merging them only adds the bucket they share at their boundary.
+ * Only the buckets between the first and last ones touched are stored.
+ * The Bucket type must be default constructible and support +=.
+ */
+template <typename Bucket>
+class TimeSeries
+{
+public:
+    uint64_t getWidth() const
+    {
+        return width;
+    }
+    void setWidth(uint64_t value)
+    {
+        width = value;
+    }
+
+    /*!
+     * \brief Whether a width was set, the series is empty otherwise.
+     */
+    bool isEnabled() const
+    {
+        return width != 0;
+    }
+
+    /*!
+     * \brief Get the bucket holding a timestamp, adding it if needed.
+     */
+    Bucket &at(uint64_t timestamp)
+    {
+        uint64_t index = timestamp / width;
+        if (buckets.empty()) {
+            first = index;
+        } else if (index < first) {
+            buckets.insert(buckets.begin(), first - index, Bucket());
+            first = index;
+        }
+        if (index - first >= buckets.size()) {
+            buckets.resize(index - first + 1);
+        }
+        return buckets[index - first];
+    }
+
+    /*!
+     * \brief Add the part of the [begin, end] interval falling in each
+     * bucket, in nanoseconds.
+     */
+    void addDuration(uint64_t begin, uint64_t end)
+    {
+        while (begin < end) {
+            uint64_t bucketEnd = (begin / width + 1) * width;
+            uint64_t stop = std::min(end, bucketEnd);
+            at(begin) += stop - begin;
+            begin = stop;
+        }
+    }
+
+    void merge(const TimeSeries &other)
+    {
+        if (!width) {
+            width = other.width;
+        }
+        if (other.buckets.empty()) {
+            return;
+        }
+        at(other.getBegin());
+        at(other.getEnd() - 1);
+        Bucket *dst = &buckets[other.first - first];
+        for (size_t i = 0; i < other.buckets.size(); i++) {
+            dst[i] += other.buckets[i];
+        }
+    }
+
+    /*!
+     * \brief Get the bounds of the stored buckets, end excluded.
+     */
+    uint64_t getBegin() const
+    {
+        return first * width;
+    }
+    uint64_t getEnd() const
+    {
+        return (first + buckets.size()) * width;
+    }
+
+    /*!
+     * \brief Get the bucket holding a timestamp, or an empty bucket if
+     * nothing was added to it.
+     */
+    Bucket get(uint64_t timestamp) const
+    {
+        if (buckets.empty()) {
+            return Bucket();
+        }
+        uint64_t index = timestamp / width;
+        if (index < first || index - first >= buckets.size()) {
+            return Bucket();
+        }
+        return buckets[index - first];
+    }
+
+    template <typename T>
+    friend QDataStream &operator<<(QDataStream &out, const TimeSeries<T> &series);
+    template <typename T>
+    friend QDataStream &operator>>(QDataStream &in, TimeSeries<T> &series);
+
+private:
+    uint64_t width = 0;		/* in nanoseconds */
+    uint64_t first = 0;		/* index of the first bucket since the epoch */
+    std::vector<Bucket> buckets;
+};
+
+template <typename Bucket>
+QDataStream &operator<<(QDataStream &out, const TimeSeries<Bucket> &series)
+{
+    out << (quint64) series.width << (quint64) series.first << (quint32) series.buckets.size();
+    for (const Bucket &bucket : series.buckets) {
+        out << bucket;
+    }
+    return out;
+}
+
+template <typename Bucket>
+QDataStream &operator>>(QDataStream &in, TimeSeries<Bucket> &series)
+{
+    quint64 width, first;
+    quint32 size;
+    in >> width >> first >> size;
+    series.width = width;
+    series.first = first;
+    series.buckets.clear();
+    for (quint32 i = 0; i < size && in.status() == QDataStream::Ok; i++) {
+        series.buckets.emplace_back();
+        in >> series.buckets.back();
+    }
+    return in;
+}
+
+#endif // TIMESERIES_H
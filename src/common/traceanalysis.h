@@ -26,12 +26,26 @@
 #include <QTime>
 #include <QtConcurrent>
 
+#include <algorithm>
+#include <fstream>
 #include <functional>
+#include <limits>
+#include <memory>
 #include <utility>
 #include <mutex>
 
+#include "columns/columnstore.h"
+#include "common/decompress.h"
+#include "common/eventdispatch.h"
 #include "common/packetindex.h"
+#include "common/packetreader.h"
+#include "common/readahead.h"
+#include "common/resultcache.h"
+#include "common/streamfilepool.h"
+#include "common/tracemetadata.h"
 #include "common/traceanalysis.h"
+#include "common/tracesetcache.h"
+#include "ctf/ctftrace.h"
 
 using namespace tibee;
 using namespace tibee::trace;
@@ -99,6 +113,136 @@ public:
         balanced = value;
     }
 
+    bool getColdCache() const
+    {
+        return coldCache;
+    }
+    void setColdCache(bool value)
+    {
+        coldCache = value;
+    }
+
+    IoEngine getIoEngine() const
+    {
+        return ioEngine;
+    }
+    void setIoEngine(IoEngine value)
+    {
+        ioEngine = value;
+    }
+
+    unsigned int getQueueDepth() const
+    {
+        return queueDepth;
+    }
+    void setQueueDepth(unsigned int value)
+    {
+        queueDepth = value;
+    }
+
+    Decoder getDecoder() const
+    {
+        return decoder;
+    }
+    void setDecoder(Decoder value)
+    {
+        decoder = value;
+    }
+
+    QString getColumnsPath() const
+    {
+        return columnsPath;
+    }
+    void setColumnsPath(const QString &value)
+    {
+        columnsPath = value;
+    }
+
+    timestamp_t getWindowBegin() const
+    {
+        return windowBegin;
+    }
+    void setWindowBegin(timestamp_t value)
+    {
+        windowBegin = value;
+    }
+
+    timestamp_t getWindowEnd() const
+    {
+        return windowEnd;
+    }
+    void setWindowEnd(timestamp_t value)
+    {
+        windowEnd = value;
+    }
+
+    /*!
+     * \brief Bounds of the time window, as given to TraceSet::between(),
+     * or nullptr when the window is open on that side.
+     */
+    const timestamp_t *getWindowBeginPos() const
+    {
+        return windowBegin > 0 ? &windowBegin : nullptr;
+    }
+    const timestamp_t *getWindowEndPos() const
+    {
+        return windowEnd < std::numeric_limits<timestamp_t>::max() ? &windowEnd : nullptr;
+    }
+
+    QString getOutputPath() const
+    {
+        return outputPath;
+    }
+    void setOutputPath(const QString &value)
+    {
+        outputPath = value;
+    }
+
+    unsigned int getPipelineDecoders() const
+    {
+        return pipelineDecoders;
+    }
+    void setPipelineDecoders(unsigned int value)
+    {
+        pipelineDecoders = value;
+    }
+
+    bool getBreakdown() const
+    {
+        return breakdown;
+    }
+    void setBreakdown(bool value)
+    {
+        breakdown = value;
+    }
+
+    uint64_t getSeriesWidth() const
+    {
+        return seriesWidth;
+    }
+    void setSeriesWidth(uint64_t value)
+    {
+        seriesWidth = value;
+    }
+
+    size_t getSketchCapacity() const
+    {
+        return sketchCapacity;
+    }
+    void setSketchCapacity(size_t value)
+    {
+        sketchCapacity = value;
+    }
+
+    QString getCachePath() const
+    {
+        return cachePath;
+    }
+    void setCachePath(const QString &value)
+    {
+        cachePath = value;
+    }
+
 signals:
     void finished();
 
@@ -109,11 +253,45 @@ public slots:
         if (doBenchmark) {
             timer.start();
         }
-        if (isParallel) {
+
+        // Compressed traces are decompressed to a temporary directory first,
+        // but are still identified by the files given by the user
+        QString originalTracePath = tracePath;
+        identityPath = tracePath;
+        QDir decompressedDir(QDir::tempPath());
+        bool isCompressed = hasCompressedFiles(tracePath);
+        if (isCompressed) {
+            QString decompressedDirPath = QFileInfo(tracePath).fileName() + "_decompressed-" + QUuid::createUuid().toString();
+            decompressedDir.mkdir(decompressedDirPath);
+            decompressedDir.cd(decompressedDirPath);
+            QThreadPool::globalInstance()->setMaxThreadCount(this->threads);
+            if (!decompressTrace(tracePath, decompressedDir.absolutePath())) {
+                std::cerr << "Error: could not decompress the trace" << std::endl;
+                decompressedDir.removeRecursively();
+                emit finished();
+                return;
+            }
+            tracePath = decompressedDir.absolutePath();
+            if (verbose) {
+                std::cout << "Decompressed trace into " << qPrintable(tracePath) << std::endl;
+            }
+        }
+
+        if (!columnsPath.isEmpty() && supportsColumns()) {
+            doExecuteColumns();
+        } else if (decoder == Decoder::NATIVE && supportsNativeDecoder()) {
+            doExecuteNative();
+        } else if (isParallel) {
             doExecuteParallel();
         } else {
             doExecuteSerial();
         }
+
+        if (isCompressed) {
+            tracePath = originalTracePath;
+            decompressedDir.removeRecursively();
+        }
+
         if (doBenchmark) {
             int milliseconds = timer.elapsed();
             std::cout << "Analysis time (ms) : " << milliseconds << std::endl;
@@ -126,13 +304,149 @@ protected:
     virtual void doExecuteSerial() = 0;
     virtual bool isOrderedReduce() = 0;
 
+    /*!
+     * \brief Whether the analysis can run from a column store.
+     */
+    virtual bool supportsColumns()
+    {
+        return false;
+    }
+    virtual void doExecuteColumns()
+    {
+    }
+
+    /*!
+     * \brief Whether the analysis can read the trace with the native
+     * CTF decoder instead of babeltrace.
+     */
+    virtual bool supportsNativeDecoder()
+    {
+        return false;
+    }
+    virtual void doExecuteNative()
+    {
+    }
+
+    /*!
+     * \brief Name and version of the map results in the result cache. An
+     * empty name means the results can't be cached. Bump the version
+     * whenever the map results change.
+     */
+    virtual QString getCacheName()
+    {
+        return QString();
+    }
+    virtual int getCacheVersion()
+    {
+        return 1;
+    }
+
+    /*!
+     * \brief Create the result cache, or return nullptr if caching is
+     * disabled or not supported by the analysis.
+     */
+    std::shared_ptr<const ResultCache> createResultCache()
+    {
+        if (cachePath.isEmpty() || getCacheName().isEmpty()) {
+            return nullptr;
+        }
+        // The decoders index events differently, so their chunks can't be
+        // mixed, and chunks with a time series can't be reused with another
+        // width
+        QString cacheName = getCacheName();
+        Decoder cacheDecoder = decoder == Decoder::NATIVE && supportsNativeDecoder() ? Decoder::NATIVE : Decoder::TIGERBEETLE;
+        cacheName += "-" + QString::fromStdString(decoderName(cacheDecoder));
+        if (seriesWidth) {
+            cacheName += QString("-window-%1").arg(seriesWidth);
+        }
+        if (sketchCapacity) {
+            cacheName += QString("-sketch-%1").arg(sketchCapacity);
+        }
+        return std::make_shared<const ResultCache>(cachePath, cacheName, getCacheVersion());
+    }
+
+    /*!
+     * \brief Get the identity of the files of the trace, for the result
+     * cache. The files given by the user are used, a decompressed copy of
+     * a trace is rewritten on every run.
+     */
+    QStringList getTraceIdentity() const
+    {
+        QStringList identity;
+        for (const QFileInfo &fileInfo : QDir(identityPath).entryInfoList(QStringList(), QDir::Files)) {
+            identity << ResultCache::getFileIdentity(fileInfo.absoluteFilePath());
+        }
+        return identity;
+    }
+
+    /*!
+     * \brief Get the identity of a file of the trace, compressed or not.
+     */
+    QString getTraceFileIdentity(const QString &fileName) const
+    {
+        QDir traceDir(identityPath);
+        for (const QFileInfo &fileInfo : traceDir.entryInfoList(QStringList(), QDir::Files)) {
+            if (stripCompressionSuffix(fileInfo.fileName()) == fileName) {
+                return ResultCache::getFileIdentity(fileInfo.absoluteFilePath());
+            }
+        }
+        return ResultCache::getFileIdentity(traceDir.absoluteFilePath(fileName));
+    }
+
+    /*!
+     * \brief Get the stream the time series is written to: the output
+     * file if one was given, the standard output otherwise.
+     */
+    std::ostream &openSeriesOutput(std::ofstream &file)
+    {
+        if (outputPath.isEmpty()) {
+            return std::cout;
+        }
+        file.open(outputPath.toStdString());
+        if (!file) {
+            std::cerr << "Error: could not open " << qPrintable(outputPath) << ", writing the time series to the standard output" << std::endl;
+            return std::cout;
+        }
+        return file;
+    }
+
+    void printCacheStats(const std::shared_ptr<const ResultCache> &cache)
+    {
+        if (cache && verbose) {
+            std::cout << "Result cache: " << cache->getHits() << " hits, "
+                      << cache->getMisses() << " misses" << std::endl;
+        }
+    }
+
+    void printTraceSetStats(const TraceSetCache &traceSetCache, size_t numChunks)
+    {
+        if (verbose) {
+            std::cout << "Trace sets: " << traceSetCache.getOpened() << " opened for "
+                      << numChunks << " chunks" << std::endl;
+        }
+    }
+
 protected:
     int threads;
     bool isParallel;
     QString tracePath;
+    QString identityPath;	/* the trace given by the user, tracePath may be a decompressed copy */
     bool doBenchmark;
     bool verbose;
     bool balanced;
+    bool coldCache = false;
+    IoEngine ioEngine = IoEngine::MMAP;
+    unsigned int queueDepth = 32;
+    Decoder decoder = Decoder::TIGERBEETLE;
+    QString columnsPath;
+    QString cachePath;
+    timestamp_t windowBegin = 0;
+    timestamp_t windowEnd = std::numeric_limits<timestamp_t>::max();
+    QString outputPath;
+    bool breakdown = false;
+    unsigned int pipelineDecoders = 0;
+    uint64_t seriesWidth = 0;
+    size_t sketchCapacity = 0;
 };
 
 template <typename WorkerType, typename ReduceResultType>
@@ -144,8 +458,21 @@ public:
     {
     }
 protected:
+    typedef EventDispatch<typename WorkerType::MapResult> Dispatch;
+
     virtual void doEnd(ReduceResultType &data) = 0;
     virtual void printResults(ReduceResultType &data) = 0;
+
+    /*!
+     * \brief Build the table of event handlers shared by the workers, once
+     * per analysis.
+     * \return nullptr if the workers dispatch the events themselves.
+     */
+    virtual std::shared_ptr<const Dispatch> createDispatch(const TraceMetadata &metadata)
+    {
+        (void) metadata;
+        return nullptr;
+    }
     virtual void doExecuteParallel()
     {
         QThreadPool::globalInstance()->setMaxThreadCount(this->threads);
@@ -158,7 +485,13 @@ protected:
 
     virtual void doExecuteParallelBalanced()
     {
-        std::unordered_map<std::string, TraceSet> traceSets; // Traces will be emplaced in here
+        // The sets of the workers are left empty, chunks read their stream
+        // through the sets of the TraceSetCache
+        std::unordered_map<std::string, TraceSet> traceSets;
+
+        // The sets of the cache keep their stream files open, which adds
+        // up to thousands of descriptors on large machines
+        raiseOpenFileLimit();
 
         // Create temp dir for split streams
         QDir tmpDir(QDir::tempPath()); // /tmp
@@ -197,14 +530,10 @@ protected:
                 thisTmpDir.cdUp(); // /tmp/kernel_per_stream-{...}/channel0_*.d
 
                 // Add traceset
-                TraceSet *set = nullptr;
                 {
                     std::lock_guard<std::mutex> guard(mapMutex); (void) guard;
-                    auto ret = traceSets.emplace(fileInfo.fileName().toStdString(), TraceSet());
-                    // emplace returns a pair with first = iterator to the inserted pair
-                    set = &ret.first->second;
+                    traceSets.emplace(fileInfo.fileName().toStdString(), TraceSet());
                 }
-                if (set) set->addTrace(thisTmpDir.absolutePath().toStdString());
 
                 // Go back up
                 thisTmpDir.cdUp(); // /tmp/kernel_per_stream-{...}
@@ -213,6 +542,31 @@ protected:
         });
         f.waitForFinished();
 
+        // All the streams share the same metadata, read through one of them
+        if (traceSets.empty()) {
+            std::cerr << "Error: no stream files found" << std::endl;
+            tmpDir.removeRecursively();
+            return;
+        }
+        TraceSet metadataSet;
+        if (!metadataSet.addTrace(tmpDir.absoluteFilePath(QString::fromStdString(traceSets.begin()->first) + ".d").toStdString())) {
+            std::cerr << "Error: could not open trace " << qPrintable(tracePath) << std::endl;
+            tmpDir.removeRecursively();
+            return;
+        }
+        std::shared_ptr<const TraceMetadata> metadata = std::make_shared<const TraceMetadata>(metadataSet);
+        std::shared_ptr<const Dispatch> dispatch = createDispatch(*metadata);
+
+        // Chunks are cached by the packets they cover, and their boundaries
+        // don't move when packets are appended, so that only invalidates
+        // the last chunk of the stream
+        std::shared_ptr<const ResultCache> cache = createResultCache();
+        QString metadataIdentity = getTraceFileIdentity("metadata");
+
+        // Chunks reuse the sets opened for the earlier chunks of their
+        // stream, a single file per set
+        std::shared_ptr<TraceSetCache> traceSetCache = std::make_shared<TraceSetCache>(1);
+
         // Parse packet indices
         std::vector<WorkerType> workers;
         std::unordered_map<std::string, std::vector<timestamp_t>> positionsPerTrace;
@@ -223,20 +577,30 @@ protected:
             std::string name = fileInfo.baseName().toStdString();
             TraceSet &trace = traceSets.at(name);
             std::vector<timestamp_t> &positions = positionsPerTrace[name];
-            PacketIndex index(fileInfo.absoluteFilePath().toStdString(), trace);
+            PacketIndex index(fileInfo.absoluteFilePath().toStdString(), metadata->getClock());
             const std::vector<PacketHeader> &indices = index.getPacketIndex();
 
-            // Get total size for all the packets
-            uint64_t size = 0;
-            for (const PacketHeader &header : indices) {
-                size += header.contentSize;
+            // Only the packets overlapping the time window are planned
+            unsigned int first = 0;
+            while (first < indices.size() && indices[first].tsReal.timestampEnd < windowBegin) {
+                first++;
+            }
+            unsigned int last = first;
+            while (last + 1 < indices.size() && indices[last + 1].tsReal.timestampBegin <= windowEnd) {
+                last++;
+            }
+            if (first >= indices.size() || indices[first].tsReal.timestampBegin > windowEnd) {
+                continue;
             }
 
-            // Try to split packets "evenly"
-            uint64_t maxPacketSize = size/indices.size();
+            // Cut a chunk each time a sub-buffer worth of content has been
+            // accumulated. The size doesn't depend on the number of packets,
+            // so appending packets leaves the boundaries of earlier chunks
+            // where they were
+            uint64_t maxPacketSize = indices[first].packetSize;
             if (this->verbose) {
                 std::cout << "Num packets for stream " << index.getStreamId()
-                          << " : " << indices.size() << std::endl;
+                          << " : " << last - first + 1 << std::endl;
             }
 
             // Accumulator for packet size
@@ -245,7 +609,11 @@ protected:
             // Iterate through packets, accumulating until we have a big enough chunk
             // NOTE: disregard last packet, since the BT_SEEK_LAST will take care of it
             int numChunks = 0;
-            for (unsigned int i = 0; i < indices.size() - 1; i++) {
+            std::vector<ChunkExtent> extents;
+            std::vector<unsigned int> lastPackets;
+            ChunkExtent extent;
+            extent.offset = indices[first].offset;
+            for (unsigned int i = first; i < last; i++) {
                 PacketHeader header = indices[i];
                 acc += header.contentSize;
                 if (acc >= maxPacketSize) {
@@ -253,24 +621,72 @@ protected:
                     numChunks++;
                     acc = 0;
                     positions.push_back(header.tsReal.timestampEnd);
+                    lastPackets.push_back(i);
+                    extent.length = header.offset + header.packetSize / 8 - extent.offset;
+                    extents.push_back(extent);
+                    extent.offset = indices[i + 1].offset;
                 }
             }
+            const PacketHeader &lastHeader = indices[last];
+            extent.length = lastHeader.offset + lastHeader.packetSize / 8 - extent.offset;
+            extents.push_back(extent);
+            lastPackets.push_back(last);
+
+            // The first and last chunks are clipped to the time window
+            timestamp_t beforeWindow = windowBegin - 1;
+            timestamp_t windowEndPos = windowEnd;
+
+            std::string streamTracePath = tmpDir.absoluteFilePath(QString::fromStdString(name) + ".d").toStdString();
+
+            // The stream is read front to back, so hints are given per stream file
+            std::shared_ptr<StreamReadahead> readahead;
+            if (coldCache) {
+                readahead = std::make_shared<StreamReadahead>(
+                            QDir(tracePath).absoluteFilePath(fileInfo.baseName()).toStdString());
+            }
 
             // Build the params list
             for (unsigned int i = 0; i <= positions.size(); i++)
             {
                 timestamp_t *begin, *end;
                 if (i == 0) {
-                    begin = nullptr;
+                    begin = getWindowBeginPos() ? &beforeWindow : nullptr;
                 } else {
                     begin = &positions[i - 1];
                 }
                 if (i == positions.size()) {
-                    end = nullptr;
+                    end = getWindowEndPos() ? &windowEndPos : nullptr;
                 } else {
                     end = &positions[i];
                 }
                 workers.emplace_back(i, trace, begin, end, verbose);
+                workers.back().setMetadata(metadata);
+                workers.back().setDispatch(dispatch);
+                workers.back().setTraceSetCache(traceSetCache, streamTracePath);
+                workers.back().setBreakdown(breakdown);
+                workers.back().setSeriesWidth(seriesWidth);
+                workers.back().setSketchCapacity(sketchCapacity);
+                if (cache) {
+                    QStringList chunk;
+                    chunk << metadataIdentity << QString::fromStdString(name)
+                          << QString("begin %1").arg(begin ? QString::number(*begin) : QString("START"))
+                          << QString("end %1").arg(end ? QString::number(*end) : QString("END"));
+                    unsigned int firstPacket = i == 0 ? first : lastPackets[i - 1] + 1;
+                    for (unsigned int packet = firstPacket; packet <= lastPackets[i]; packet++) {
+                        const PacketHeader &header = indices[packet];
+                        chunk << QString("packet %1 %2 %3 %4 %5").arg(header.offset).arg(header.contentSize)
+                                 .arg(header.tsCycles.timestampBegin).arg(header.tsCycles.timestampEnd)
+                                 .arg(header.eventsDiscarded);
+                    }
+                    workers.back().setResultCache(cache, cache->makeKey(chunk));
+                }
+                if (readahead) {
+                    ChunkExtent next;
+                    if (i + 1 < extents.size()) {
+                        next = extents[i + 1];
+                    }
+                    workers.back().setReadahead(readahead, extents[i], next);
+                }
             }
 
             if (this->verbose) {
@@ -281,28 +697,205 @@ protected:
         }
         traceDir.cdUp();
 
-        // Sort by begin time
-        std::sort(workers.begin(), workers.end(), [](const WorkerType &a, const WorkerType &b) {
-            if (b.getBeginPos() == NULL) return false;
-            if (a.getBeginPos() == NULL) return true;
-            return *a.getBeginPos() < *b.getBeginPos();
-        });
+        if (workers.empty()) {
+            std::cerr << "Error: the time window does not overlap the trace" << std::endl;
+            tmpDir.removeRecursively();
+            return;
+        }
+
+        // Sort by begin time, unless we are optimizing for a cold cache, in
+        // which case the workers stay grouped per stream so that each stream
+        // file is read sequentially
+        if (!coldCache) {
+            std::sort(workers.begin(), workers.end(), [](const WorkerType &a, const WorkerType &b) {
+                if (b.getBeginPos() == NULL) return false;
+                if (a.getBeginPos() == NULL) return true;
+                return *a.getBeginPos() < *b.getBeginPos();
+            });
+        }
 
         // Launch map reduce
         QtConcurrent::ReduceOptions options;
         if (isOrderedReduce()) options = QtConcurrent::OrderedReduce;
         else options = QtConcurrent::UnorderedReduce;
         auto future = QtConcurrent::mappedReduced(workers.begin(), workers.end(),
-                                                     &WorkerType::doMap, &WorkerType::doReduce, options);
+                                                     &WorkerType::map, &WorkerType::doReduce, options);
+
+        auto data = future.result();
+
+        printCacheStats(cache);
+        printTraceSetStats(*traceSetCache, workers.size());
+
+        // Remove the temporary directory
+        tmpDir.removeRecursively();
+
+        if (!checkWorkers(workers)) {
+            return;
+        }
+
+        doEnd(data);
+
+        printResults(data);
+    }
+
+    virtual void doExecuteColumns()
+    {
+        // Convert the trace on the first run, then reuse the columns
+        ColumnStore store(columnsPath);
+        if (!store.open(identityPath)) {
+            if (verbose) {
+                std::cout << "Converting the trace to columns in " << qPrintable(columnsPath) << std::endl;
+            }
+            QThreadPool::globalInstance()->setMaxThreadCount(this->threads);
+            int numSegments = isParallel ? this->threads * 4 : 1;
+            if (!store.convert(tracePath, identityPath, numSegments, verbose) || !store.open(identityPath)) {
+                std::cerr << "Error: could not create the column store" << std::endl;
+                return;
+            }
+        }
+
+        // One worker per segment in the time window, the trace itself is
+        // never opened
+        TraceSet set;
+        const std::vector<ColumnSegment> &segments = store.getSegments();
+        std::vector<WorkerType> workers;
+        for (unsigned int i = 0; i < segments.size(); i++) {
+            timestamp_t segmentBegin = std::max<timestamp_t>(segments[i].getBegin(), windowBegin);
+            timestamp_t segmentEnd = std::min<timestamp_t>(segments[i].getEnd(), windowEnd);
+            if (segmentBegin > segmentEnd) {
+                continue;
+            }
+
+            // The worker skips the first timestamp of its range
+            timestamp_t beforeBegin = segmentBegin - 1;
+            timestamp_t *begin = nullptr;
+            timestamp_t *end = nullptr;
+            if (i != 0 || windowBegin > segments[i].getBegin()) {
+                begin = &beforeBegin;
+            }
+            if (i != segments.size() - 1 || windowEnd < segments[i].getEnd()) {
+                end = &segmentEnd;
+            }
+            workers.emplace_back(i, set, begin, end, verbose);
+            workers.back().setColumnSegment(&segments[i]);
+            workers.back().setSeriesWidth(seriesWidth);
+            workers.back().setSketchCapacity(sketchCapacity);
+        }
+        if (workers.empty()) {
+            std::cerr << "Error: the time window does not overlap the trace" << std::endl;
+            return;
+        }
+
+        QThreadPool::globalInstance()->setMaxThreadCount(isParallel ? this->threads : 1);
+        QtConcurrent::ReduceOptions options;
+        if (isOrderedReduce()) options = QtConcurrent::OrderedReduce;
+        else options = QtConcurrent::UnorderedReduce;
+        auto future = QtConcurrent::mappedReduced(workers.begin(), workers.end(),
+                                                     &WorkerType::map, &WorkerType::doReduce, options);
 
         auto data = future.result();
 
         doEnd(data);
 
         printResults(data);
+    }
 
-        // Remove the temporary directory
-        tmpDir.removeRecursively();
+    virtual void doExecuteNative()
+    {
+        std::shared_ptr<CtfTrace> trace = std::make_shared<CtfTrace>();
+        if (!trace->open(tracePath)) {
+            std::cerr << "Error: could not open the trace with the native decoder" << std::endl;
+            return;
+        }
+
+        // Get the bounds of the trace from its packet index, clipped to
+        // the time window
+        timestamp_t begin = std::max<timestamp_t>(trace->getBegin(), windowBegin);
+        timestamp_t end = std::min<timestamp_t>(trace->getEnd(), windowEnd);
+        if (begin > end) {
+            std::cerr << "Error: the time window does not overlap the trace" << std::endl;
+            return;
+        }
+
+        // Chunk boundaries, each worker reads from one boundary (excluded)
+        // to the next (included)
+        int numChunks = isParallel ? this->threads : 1;
+        std::vector<timestamp_t> positions;
+        positions.push_back(begin - 1);
+        if (balanced) {
+            // Cut where the packets in the window add up to equal sizes
+            std::vector<std::pair<timestamp_t, uint64_t>> packets;
+            uint64_t total = 0;
+            for (const StreamIndex &stream : trace->getIndex().getStreams()) {
+                for (const PacketHeader &header : stream.index->getPacketIndex()) {
+                    if (header.tsReal.timestampEnd >= begin && header.tsReal.timestampBegin <= end) {
+                        packets.emplace_back(header.tsReal.timestampBegin, header.contentSize);
+                        total += header.contentSize;
+                    }
+                }
+            }
+            std::sort(packets.begin(), packets.end());
+            uint64_t acc = 0;
+            for (const auto &packet : packets) {
+                acc += packet.second;
+                if (acc >= total / numChunks * positions.size() && (int) positions.size() < numChunks &&
+                        packet.first > positions.back() && packet.first < end) {
+                    positions.push_back(packet.first);
+                }
+            }
+        } else {
+            timestamp_t step = (end - begin) / numChunks;
+            for (int i = 1; i < numChunks; i++) {
+                if (begin + i * step > positions.back()) {
+                    positions.push_back(begin + i * step);
+                }
+            }
+        }
+        positions.push_back(end);
+
+        std::shared_ptr<const ResultCache> cache = createResultCache();
+        QStringList traceIdentity;
+        if (cache) {
+            traceIdentity = getTraceIdentity();
+        }
+
+        // The workers never touch their TraceSet
+        TraceSet set;
+        std::vector<WorkerType> workers;
+        for (unsigned int i = 0; i + 1 < positions.size(); i++) {
+            workers.emplace_back(i, set, &positions[i], &positions[i + 1], verbose);
+            workers.back().setCtfTrace(trace);
+            workers.back().setPipelineDecoders(pipelineDecoders);
+            workers.back().setBreakdown(breakdown);
+            workers.back().setSeriesWidth(seriesWidth);
+            workers.back().setSketchCapacity(sketchCapacity);
+            if (cache) {
+                QStringList chunk = traceIdentity;
+                chunk << QString("begin %1").arg(QString::number(positions[i]))
+                      << QString("end %1").arg(QString::number(positions[i + 1]));
+                workers.back().setResultCache(cache, cache->makeKey(chunk));
+            }
+        }
+
+        QThreadPool::globalInstance()->setMaxThreadCount(numChunks);
+        QtConcurrent::ReduceOptions options;
+        if (isOrderedReduce()) options = QtConcurrent::OrderedReduce;
+        else options = QtConcurrent::UnorderedReduce;
+        auto future = QtConcurrent::mappedReduced(workers.begin(), workers.end(),
+                                                     &WorkerType::map, &WorkerType::doReduce, options);
+
+        auto data = future.result();
+
+        printCacheStats(cache);
+
+        // Results missing some streams would look complete
+        if (!checkWorkers(workers)) {
+            return;
+        }
+
+        doEnd(data);
+
+        printResults(data);
     }
 
     virtual void doExecuteParallelUnbalanced()
@@ -314,12 +907,35 @@ protected:
         // Open a trace to get the begin/end timestamps
         TraceSet set;
         set.addTrace(this->tracePath.toStdString());
+        std::shared_ptr<const TraceMetadata> metadata = std::make_shared<const TraceMetadata>(set);
+        std::shared_ptr<const Dispatch> dispatch = createDispatch(*metadata);
+
+        // Chunks reuse the sets opened for the earlier chunks, with all
+        // the stream files of the trace
+        QStringList streamFiles = QDir(tracePath).entryList(QStringList(), QDir::Files);
+        streamFiles.removeAll("metadata");
+        std::shared_ptr<TraceSetCache> traceSetCache = std::make_shared<TraceSetCache>(streamFiles.size());
+
+        // Chunks span all the streams, so they are cached by the identity
+        // of every file of the trace
+        std::shared_ptr<const ResultCache> cache = createResultCache();
+        QStringList traceIdentity;
+        if (cache) {
+            traceIdentity = getTraceIdentity();
+        }
 
-        // Get begin timestamp
-        begin = set.getBegin();
+        // Get begin timestamp, clipped to the time window
+        begin = std::max(set.getBegin(), windowBegin);
 
-        // Get end timestamp
-        end = set.getEnd();
+        // Get end timestamp, clipped to the time window
+        end = std::min(set.getEnd(), windowEnd);
+
+        if (begin > end) {
+            std::cerr << "Error: the time window does not overlap the trace" << std::endl;
+            return;
+        }
+        bool clipBegin = begin > set.getBegin();
+        bool clipEnd = end < set.getEnd();
 
         // Calculate begin/end timestamp pairs for each chunk
         timestamp_t step = (end - begin)/threads;
@@ -328,22 +944,36 @@ protected:
         {
             positions[i] = begin + (i*step);
         }
+        timestamp_t beforeBegin = begin - 1;
+        timestamp_t lastEnd = end;
 
         // Build the params list
         for (int i = 0; i < threads; i++)
         {
             timestamp_t *begin, *end;
             if (i == 0) {
-                begin = nullptr;
+                begin = clipBegin ? &beforeBegin : nullptr;
             } else {
                 begin = &positions[i];
             }
             if (i == threads - 1) {
-                end = nullptr;
+                end = clipEnd ? &lastEnd : nullptr;
             } else {
                 end = &positions[i+1];
             }
             workers.emplace_back(i, set, begin, end, verbose);
+            workers.back().setMetadata(metadata);
+            workers.back().setDispatch(dispatch);
+            workers.back().setTraceSetCache(traceSetCache, this->tracePath.toStdString());
+            workers.back().setBreakdown(breakdown);
+            workers.back().setSeriesWidth(seriesWidth);
+            workers.back().setSketchCapacity(sketchCapacity);
+            if (cache) {
+                QStringList chunk = traceIdentity;
+                chunk << QString("begin %1").arg(begin ? QString::number(*begin) : QString("START"))
+                      << QString("end %1").arg(end ? QString::number(*end) : QString("END"));
+                workers.back().setResultCache(cache, cache->makeKey(chunk));
+            }
         }
 
         // Launch map reduce
@@ -351,14 +981,36 @@ protected:
         if (isOrderedReduce()) options = QtConcurrent::OrderedReduce;
         else options = QtConcurrent::UnorderedReduce;
         auto future = QtConcurrent::mappedReduced(workers.begin(), workers.end(),
-                                                     &WorkerType::doMap, &WorkerType::doReduce, options);
+                                                     &WorkerType::map, &WorkerType::doReduce, options);
 
         auto data = future.result();
 
+        printCacheStats(cache);
+        printTraceSetStats(*traceSetCache, workers.size());
+
+        if (!checkWorkers(workers)) {
+            return;
+        }
+
         doEnd(data);
 
         printResults(data);
     }
+
+    /*!
+     * \brief Check that all the chunks were read in full, printing an
+     * error otherwise.
+     */
+    bool checkWorkers(const std::vector<WorkerType> &workers) const
+    {
+        for (const WorkerType &worker : workers) {
+            if (worker.hasFailed()) {
+                std::cerr << "Error: the trace could not be read in full, no results are printed" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
 };
 
 template <typename MapResultType>
@@ -392,7 +1044,13 @@ public:
 
     // Moving is fine (C++11)
     TraceWorker(TraceWorker &&other) : id(std::move(other.id)), traceSet(other.traceSet),
-        beginPos(std::move(other.beginPos)), endPos(std::move(other.endPos)), verbose(std::move(other.verbose))
+        beginPos(std::move(other.beginPos)), endPos(std::move(other.endPos)), verbose(std::move(other.verbose)),
+        readahead(std::move(other.readahead)), extent(other.extent), nextExtent(other.nextExtent),
+        traceSetCache(std::move(other.traceSetCache)), tracePath(std::move(other.tracePath)),
+        metadata(std::move(other.metadata)), dispatch(std::move(other.dispatch)), columnSegment(other.columnSegment),
+        ctfTrace(std::move(other.ctfTrace)), pipelineDecoders(other.pipelineDecoders), breakdown(other.breakdown),
+        seriesWidth(other.seriesWidth), sketchCapacity(other.sketchCapacity),
+        resultCache(std::move(other.resultCache)), cacheKey(std::move(other.cacheKey)), failed(other.failed)
     {
         if (other.beginPos != NULL) {
             beginPosVal = *other.beginPos;
@@ -416,6 +1074,22 @@ public:
             id = std::move(other.id);
             traceSet = std::move(other.traceSet);
             verbose = std::move(other.verbose);
+            readahead = std::move(other.readahead);
+            extent = other.extent;
+            nextExtent = other.nextExtent;
+            traceSetCache = std::move(other.traceSetCache);
+            tracePath = std::move(other.tracePath);
+            metadata = std::move(other.metadata);
+            dispatch = std::move(other.dispatch);
+            columnSegment = other.columnSegment;
+            ctfTrace = std::move(other.ctfTrace);
+            pipelineDecoders = other.pipelineDecoders;
+            breakdown = other.breakdown;
+            seriesWidth = other.seriesWidth;
+            sketchCapacity = other.sketchCapacity;
+            resultCache = std::move(other.resultCache);
+            cacheKey = std::move(other.cacheKey);
+            failed = other.failed;
             if (other.beginPos != NULL) {
                 beginPosVal = *other.beginPos;
                 beginPos = &beginPosVal;
@@ -437,12 +1111,122 @@ public:
     // Accessors
     TraceSet &getTraceSet()
     {
-        return traceSet;
+        return cachedSet ? *cachedSet : traceSet.get();
     }
 
+    /*!
+     * \brief The trace set to iterate over. With a TraceSetCache, this is
+     * the set taken from the cache for the chunk being mapped, which no
+     * other thread uses until the chunk is done.
+     */
     const TraceSet &getTraceSet() const
     {
-        return traceSet;
+        return cachedSet ? *cachedSet : traceSet.get();
+    }
+    void setTraceSetCache(std::shared_ptr<TraceSetCache> cache, const std::string &path)
+    {
+        traceSetCache = cache;
+        tracePath = path;
+    }
+
+    const TraceMetadata &getMetadata() const
+    {
+        return *metadata;
+    }
+    void setMetadata(std::shared_ptr<const TraceMetadata> value)
+    {
+        metadata = value;
+    }
+
+    /*!
+     * \brief The event handlers resolved by the analysis, or nullptr if
+     * the analysis has none.
+     */
+    const EventDispatch<MapResultType> *getDispatch() const
+    {
+        return dispatch.get();
+    }
+    void setDispatch(std::shared_ptr<const EventDispatch<MapResultType>> value)
+    {
+        dispatch = value;
+    }
+
+    /*!
+     * \brief The column segment to replay instead of the trace, or
+     * nullptr when reading the trace.
+     */
+    const ColumnSegment *getColumnSegment() const
+    {
+        return columnSegment;
+    }
+    void setColumnSegment(const ColumnSegment *value)
+    {
+        columnSegment = value;
+    }
+
+    /*!
+     * \brief The trace to read with the native decoder, or nullptr when
+     * reading the TraceSet.
+     */
+    const CtfTrace *getCtfTrace() const
+    {
+        return ctfTrace.get();
+    }
+    void setCtfTrace(std::shared_ptr<const CtfTrace> value)
+    {
+        ctfTrace = value;
+    }
+
+    /*!
+     * \brief Number of threads decoding the native trace for this worker,
+     * which then only runs the analysis, or 0 to do both on one thread.
+     */
+    unsigned int getPipelineDecoders() const
+    {
+        return pipelineDecoders;
+    }
+    void setPipelineDecoders(unsigned int value)
+    {
+        pipelineDecoders = value;
+    }
+
+    /*!
+     * \brief Whether the analysis also breaks its results down, for the
+     * analyses where that costs extra work per event.
+     */
+    bool getBreakdown() const
+    {
+        return breakdown;
+    }
+    void setBreakdown(bool value)
+    {
+        breakdown = value;
+    }
+
+    /*!
+     * \brief Width of the time buckets of the time series, in nanoseconds,
+     * or 0 to only compute the totals.
+     */
+    uint64_t getSeriesWidth() const
+    {
+        return seriesWidth;
+    }
+    void setSeriesWidth(uint64_t value)
+    {
+        seriesWidth = value;
+    }
+
+    /*!
+     * \brief Number of counters of the sketches ranking the processes, or
+     * 0 to keep exact per process totals.
+     */
+    size_t getSketchCapacity() const
+    {
+        return sketchCapacity;
+    }
+    void setSketchCapacity(size_t value)
+    {
+        sketchCapacity = value;
     }
 
     const timestamp_t *getBeginPos() const
@@ -481,9 +1265,86 @@ public:
         id = value;
     }
 
+    /*!
+     * \brief Give page cache hints for the stream file while mapping.
+     * \param stream The stream file this worker reads.
+     * \param chunk The extent read by this worker.
+     * \param next The extent read by the following chunk of the stream.
+     */
+    void setReadahead(std::shared_ptr<StreamReadahead> stream, const ChunkExtent &chunk, const ChunkExtent &next)
+    {
+        readahead = stream;
+        extent = chunk;
+        nextExtent = next;
+    }
+
+    /*!
+     * \brief Load and save the result of this chunk in a result cache.
+     * \param cache The result cache of the analysis.
+     * \param key The key of this chunk in the cache.
+     */
+    void setResultCache(std::shared_ptr<const ResultCache> cache, const QByteArray &key)
+    {
+        resultCache = cache;
+        cacheKey = key;
+    }
+
+    /*!
+     * \brief Map this chunk. This is the entry point used by the
+     * map reduce, which wraps doMap().
+     */
+    MapResultType map() const
+    {
+        MapResultType result;
+        if (resultCache && resultCache->load(cacheKey, result)) {
+            if (verbose) {
+                std::cout << "Worker " << id << " loaded its result from the cache" << std::endl;
+            }
+            return result;
+        }
+        if (traceSetCache) {
+            cachedSet = traceSetCache->acquire(tracePath);
+            if (!cachedSet) {
+                // The chunk is not mapped, and the analysis prints no results
+                setFailed();
+                return result;
+            }
+        }
+        if (readahead) {
+            readahead->willNeed(extent);
+            readahead->willNeed(nextExtent);
+        }
+        result = doMap();
+        if (readahead) {
+            readahead->dontNeed(extent);
+        }
+        if (cachedSet) {
+            traceSetCache->release(cachedSet);
+            cachedSet = nullptr;
+        }
+        if (resultCache && !failed) {
+            resultCache->store(cacheKey, result);
+        }
+        return result;
+    }
+
     virtual MapResultType doMap() const = 0;
 
+    /*!
+     * \brief Whether the chunk could not be read in full, in which case
+     * its result is incomplete and the analysis prints no results.
+     */
+    bool hasFailed() const
+    {
+        return failed;
+    }
+
 protected:
+    void setFailed() const
+    {
+        failed = true;
+    }
+
     int id;
     std::reference_wrapper<TraceSet> traceSet;
     timestamp_t beginPosVal;
@@ -491,6 +1352,23 @@ protected:
     const timestamp_t *beginPos;
     const timestamp_t *endPos;
     bool verbose;
+    std::shared_ptr<StreamReadahead> readahead;
+    ChunkExtent extent;
+    ChunkExtent nextExtent;
+    std::shared_ptr<TraceSetCache> traceSetCache;
+    std::string tracePath;
+    mutable TraceSet *cachedSet = nullptr;	/* only set while map() runs */
+    std::shared_ptr<const TraceMetadata> metadata;
+    std::shared_ptr<const EventDispatch<MapResultType>> dispatch;
+    const ColumnSegment *columnSegment = nullptr;
+    std::shared_ptr<const CtfTrace> ctfTrace;
+    unsigned int pipelineDecoders = 0;
+    bool breakdown = false;
+    uint64_t seriesWidth = 0;
+    size_t sketchCapacity = 0;
+    std::shared_ptr<const ResultCache> resultCache;
+    QByteArray cacheKey;
+    mutable bool failed = false;	/* set by doMap() on the thread mapping the chunk */
 };
 
 #endif // TRACEANALYSIS_H
@@ -0,0 +1,106 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "traceindex.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <limits>
+
+bool TraceIndex::open(const QString &tracePath)
+{
+    TraceClock traceClock;
+    if (!readTraceClock(QDir(tracePath).absoluteFilePath("metadata").toStdString(), traceClock)) {
+        std::cerr << "Error: could not read the clock of the trace" << std::endl;
+        return false;
+    }
+    return open(tracePath, traceClock);
+}
+
+bool TraceIndex::open(const QString &tracePath, const TraceClock &traceClock)
+{
+    clock = traceClock;
+    QDir traceDir(tracePath);
+    QDir indexDir(traceDir.absoluteFilePath("index"));
+    QFileInfoList fileList = indexDir.entryInfoList(QStringList(), QDir::Files);
+    streams.clear();
+    streams.resize(fileList.size());
+    for (int i = 0; i < fileList.size(); i++) {
+        streams[i].name = fileList.at(i).baseName().toStdString();
+    }
+
+    std::atomic<int> errors(0);
+    auto f = QtConcurrent::map(streams, [&](StreamIndex &stream) {
+        std::string path = indexDir.absoluteFilePath(QString::fromStdString(stream.name) + ".idx").toStdString();
+        stream.index = std::make_shared<const PacketIndex>(path, clock);
+        if (!stream.index->isValid()) {
+            errors++;
+        }
+    });
+    f.waitForFinished();
+
+    if (errors > 0) {
+        std::cerr << "Error: could not read " << errors << " index files" << std::endl;
+        return false;
+    }
+
+    // Streams of idle CPUs may have no packets
+    streams.erase(std::remove_if(streams.begin(), streams.end(), [](const StreamIndex &stream) {
+        return stream.index->getPacketIndex().empty();
+    }), streams.end());
+    return true;
+}
+
+const TraceClock &TraceIndex::getClock() const
+{
+    return clock;
+}
+
+const std::vector<StreamIndex> &TraceIndex::getStreams() const
+{
+    return streams;
+}
+
+uint64_t TraceIndex::getBegin() const
+{
+    uint64_t begin = std::numeric_limits<uint64_t>::max();
+    for (const StreamIndex &stream : streams) {
+        const Indices &packets = stream.index->getPacketIndex();
+        if (!packets.empty()) {
+            begin = std::min(begin, packets.front().tsReal.timestampBegin);
+        }
+    }
+    return begin;
+}
+
+uint64_t TraceIndex::getEnd() const
+{
+    uint64_t end = 0;
+    for (const StreamIndex &stream : streams) {
+        const Indices &packets = stream.index->getPacketIndex();
+        if (!packets.empty()) {
+            end = std::max(end, packets.back().tsReal.timestampEnd);
+        }
+    }
+    return end;
+}
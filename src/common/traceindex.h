@@ -0,0 +1,79 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACEINDEX_H
+#define TRACEINDEX_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QString>
+
+#include "common/packetindex.h"
+#include "common/tracemetadata.h"
+
+/*
+ * The packet index of a stream file.
+ */
+struct StreamIndex {
+    std::string name;	/* name of the stream file */
+    std::shared_ptr<const PacketIndex> index;
+};
+
+/*!
+ * \brief The TraceIndex class gives access to the packet indices of all
+ * the streams of a trace, without opening it with babeltrace.
+ *
+ * Only the clock is read from the metadata, so loading the index of a
+ * trace takes milliseconds even when decoding it takes minutes.
+ */
+class TraceIndex
+{
+public:
+    /*!
+     * \brief Load the clock and the packet indices of a trace. The index
+     * files are read in parallel, and the streams without packets are
+     * left out.
+     * \return false if the clock or an index file can't be read.
+     */
+    bool open(const QString &tracePath);
+
+    /*!
+     * \brief Load the packet indices of a trace whose metadata was
+     * already parsed, with its clock, instead of reading it again.
+     * \return false if an index file can't be read.
+     */
+    bool open(const QString &tracePath, const TraceClock &traceClock);
+
+    const TraceClock &getClock() const;
+    const std::vector<StreamIndex> &getStreams() const;
+
+    /*!
+     * \brief Get the bounds of the trace, from the first packet beginning
+     * to the last packet end, as real timestamps.
+     */
+    uint64_t getBegin() const;
+    uint64_t getEnd() const;
+
+private:
+    TraceClock clock;
+    std::vector<StreamIndex> streams;
+};
+
+#endif // TRACEINDEX_H
@@ -0,0 +1,243 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tracemetadata.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <endian.h>
+
+#define TSDL_MAGIC 0x75d11d57
+
+/*
+ * Header of a metadata packet.
+ */
+struct MetadataPacketHeader {
+    uint32_t magic;
+    uint8_t uuid[16];
+    uint32_t checksum;
+    uint32_t contentSize;	/* in bits, header included */
+    uint32_t packetSize;	/* in bits, header included */
+    uint8_t compressionScheme;
+    uint8_t encryptionScheme;
+    uint8_t checksumScheme;
+    uint8_t major;
+    uint8_t minor;
+} __attribute__((__packed__));
+
+using namespace tibee::trace;
+
+uint64_t TraceClock::cyclesToNs(uint64_t cycles) const
+{
+    if (freq == 1000000000ULL) {
+        /* 1GHZ freq, no need to scale cycles value */
+        return cycles;
+    } else {
+        return (double) cycles * 1000000000.0
+                / (double) freq;
+    }
+}
+
+uint64_t TraceClock::offsetNs() const
+{
+    return offsetSeconds * 1000000000ULL
+            + cyclesToNs(offset);
+}
+
+uint64_t TraceClock::toRealTimestamp(uint64_t cycles) const
+{
+    return cyclesToNs(cycles) + offsetNs();
+}
+
+TraceMetadata::TraceMetadata(const TraceSet &set)
+{
+    const auto &tracesInfos = set.getTracesInfos();
+    if (!tracesInfos.empty()) {
+        const ClockInfos &clockInfos = (*tracesInfos.begin())->getClockInfos();
+        clock.freq = clockInfos.freq;
+        clock.offsetSeconds = clockInfos.offset_s;
+        clock.offset = clockInfos.offset;
+    }
+
+    for (const auto &traceInfos : tracesInfos) {
+        if (traceInfos->getTraceType() == "lttng-kernel") {
+            for (const auto &eventNameIdPair : *traceInfos->getEventMap()) {
+                event_id_t id = eventNameIdPair.second->getId();
+                eventIds.emplace(eventNameIdPair.first, id);
+                if (id >= 0) {
+                    if ((size_t) id >= eventNames.size()) {
+                        eventNames.resize(id + 1);
+                    }
+                    eventNames[id] = eventNameIdPair.first;
+                }
+            }
+        }
+    }
+}
+
+event_id_t TraceMetadata::getEventId(const std::string &eventName) const
+{
+    auto iter = eventIds.find(eventName);
+    if (iter == eventIds.end()) {
+        return -1;
+    }
+    return iter->second;
+}
+
+const std::string &TraceMetadata::getEventName(event_id_t id) const
+{
+    static const std::string unknown;
+    if (id < 0 || (size_t) id >= eventNames.size()) {
+        return unknown;
+    }
+    return eventNames[id];
+}
+
+size_t TraceMetadata::getNumEventIds() const
+{
+    return eventNames.size();
+}
+
+const TraceClock &TraceMetadata::getClock() const
+{
+    return clock;
+}
+
+bool readMetadataText(const std::string &metadataPath, std::string &text)
+{
+    FILE *fp = fopen(metadataPath.c_str(), "r");
+    if (!fp) {
+        std::cerr << "Error: could not open metadata file " << metadataPath << std::endl;
+        return false;
+    }
+
+    text.clear();
+    MetadataPacketHeader header;
+    bool packetized = fread(&header, sizeof(header), 1, fp) == 1 &&
+            (header.magic == TSDL_MAGIC || be32toh(header.magic) == TSDL_MAGIC);
+    if (!packetized) {
+        // Plain text metadata
+        rewind(fp);
+        char buf[4096];
+        size_t len;
+        while ((len = fread(buf, 1, sizeof(buf), fp)) > 0) {
+            text.append(buf, len);
+        }
+        fclose(fp);
+        return true;
+    }
+
+    // Concatenate the content of the packets, in the byte order of the header
+    bool bigEndian = header.magic != TSDL_MAGIC;
+    do {
+        uint32_t contentSize = bigEndian ? be32toh(header.contentSize) : le32toh(header.contentSize);
+        uint32_t packetSize = bigEndian ? be32toh(header.packetSize) : le32toh(header.packetSize);
+        if (contentSize / 8 < sizeof(header) || packetSize < contentSize) {
+            std::cerr << "Error: corrupted metadata packet in " << metadataPath << std::endl;
+            fclose(fp);
+            return false;
+        }
+        size_t contentLen = contentSize / 8 - sizeof(header);
+        size_t start = text.size();
+        text.resize(start + contentLen);
+        if (fread(&text[start], 1, contentLen, fp) != contentLen ||
+                fseek(fp, packetSize / 8 - contentSize / 8, SEEK_CUR) != 0) {
+            std::cerr << "Error: truncated metadata packet in " << metadataPath << std::endl;
+            fclose(fp);
+            return false;
+        }
+    } while (fread(&header, sizeof(header), 1, fp) == 1);
+
+    fclose(fp);
+    return true;
+}
+
+bool readTraceClock(const std::string &metadataPath, TraceClock &clock)
+{
+    std::string text;
+    if (!readMetadataText(metadataPath, text)) {
+        return false;
+    }
+
+    // Find the "clock { ... };" block
+    size_t pos = 0;
+    size_t blockBegin = std::string::npos;
+    while ((pos = text.find("clock", pos)) != std::string::npos) {
+        bool wordStart = pos == 0 || !(isalnum(text[pos - 1]) || text[pos - 1] == '_');
+        size_t brace = text.find_first_not_of(" \t\r\n", pos + 5);
+        pos += 5;
+        if (wordStart && brace != std::string::npos && text[brace] == '{') {
+            blockBegin = brace + 1;
+            break;
+        }
+    }
+    if (blockBegin == std::string::npos) {
+        return false;
+    }
+    size_t blockEnd = text.find('}', blockBegin);
+    if (blockEnd == std::string::npos) {
+        return false;
+    }
+
+    // Statements are "name = value;", once the comments are removed
+    std::string block;
+    for (size_t i = blockBegin; i < blockEnd; i++) {
+        if (text.compare(i, 2, "/*") == 0) {
+            size_t commentEnd = text.find("*/", i + 2);
+            i = commentEnd == std::string::npos ? blockEnd : commentEnd + 1;
+        } else if (text.compare(i, 2, "//") == 0) {
+            size_t lineEnd = text.find('\n', i);
+            i = lineEnd == std::string::npos ? blockEnd : lineEnd;
+        } else {
+            block.push_back(text[i]);
+        }
+    }
+    size_t statementBegin = 0;
+    while (statementBegin < block.size()) {
+        size_t statementEnd = block.find(';', statementBegin);
+        if (statementEnd == std::string::npos) {
+            statementEnd = block.size();
+        }
+        std::string statement = block.substr(statementBegin, statementEnd - statementBegin);
+        statementBegin = statementEnd + 1;
+
+        size_t equal = statement.find('=');
+        if (equal == std::string::npos) {
+            continue;
+        }
+        size_t nameBegin = statement.find_first_not_of(" \t\r\n");
+        size_t nameEnd = statement.find_last_not_of(" \t\r\n", equal - 1);
+        if (nameBegin == std::string::npos || nameEnd == std::string::npos || nameBegin > nameEnd) {
+            continue;
+        }
+        std::string name = statement.substr(nameBegin, nameEnd - nameBegin + 1);
+        const char *value = statement.c_str() + equal + 1;
+        if (name == "freq") {
+            clock.freq = strtoull(value, nullptr, 0);
+        } else if (name == "offset_s") {
+            clock.offsetSeconds = strtoll(value, nullptr, 0);
+        } else if (name == "offset") {
+            clock.offset = strtoll(value, nullptr, 0);
+        }
+    }
+    return clock.freq != 0;
+}
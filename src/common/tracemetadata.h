@@ -0,0 +1,95 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACEMETADATA_H
+#define TRACEMETADATA_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <trace/BasicTypes.hpp>
+#include <trace/TraceSet.hpp>
+
+/*
+ * Clock of a trace, used to convert cycles to real timestamps.
+ */
+struct TraceClock {
+    uint64_t freq = 1000000000ULL;	/* frequency, in Hz */
+    int64_t offsetSeconds = 0;	/* offset from epoch, in seconds */
+    int64_t offset = 0;		/* offset from offsetSeconds, in cycles */
+
+    uint64_t cyclesToNs(uint64_t cycles) const;
+    uint64_t offsetNs() const;
+    uint64_t toRealTimestamp(uint64_t cycles) const;
+};
+
+/*!
+ * \brief The TraceMetadata class holds the kernel event ids and names and
+ * the clock of a trace, for the analyses to look them up.
+ *
+ * It is built once per analysis and shared, read-only, by all its
+ * workers. It doesn't replace the metadata parsed by babeltrace: each
+ * TraceSet still parses the metadata file when a trace is added to it.
+ * The native decoder parses it once per analysis instead, see CtfTrace.
+ */
+class TraceMetadata
+{
+public:
+    TraceMetadata(const tibee::trace::TraceSet &set);
+
+    /*!
+     * \brief Get the id of a kernel event.
+     * \return The id, or -1 if the trace has no such event.
+     */
+    tibee::trace::event_id_t getEventId(const std::string &eventName) const;
+
+    /*!
+     * \brief Get the name of a kernel event.
+     * \return The name, or an empty string if there is no such event.
+     */
+    const std::string &getEventName(tibee::trace::event_id_t id) const;
+
+    /*!
+     * \brief Get the number of event ids, i.e. the highest id plus one.
+     */
+    size_t getNumEventIds() const;
+
+    const TraceClock &getClock() const;
+
+private:
+    std::unordered_map<std::string, tibee::trace::event_id_t> eventIds;
+    std::vector<std::string> eventNames;
+    TraceClock clock;
+};
+
+/*!
+ * \brief Read the TSDL text of a metadata file, packetized or not.
+ * \return false if the file can't be read.
+ */
+bool readMetadataText(const std::string &metadataPath, std::string &text);
+
+/*!
+ * \brief Get the clock of a trace from its metadata file, without parsing
+ * the rest of the metadata.
+ * \return false if the metadata has no clock.
+ */
+bool readTraceClock(const std::string &metadataPath, TraceClock &clock);
+
+#endif // TRACEMETADATA_H
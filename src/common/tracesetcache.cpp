@@ -0,0 +1,95 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tracesetcache.h"
+
+#include "streamfilepool.h"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace tibee::trace;
+
+TraceSetCache::TraceSetCache(size_t filesPerSet)
+{
+    // Leave the other half of the descriptors to the stream file pool
+    maxSets = std::max<size_t>(1, raiseOpenFileLimit() / 2 / std::max<size_t>(1, filesPerSet));
+}
+
+TraceSet *TraceSetCache::acquire(const std::string &tracePath)
+{
+    std::unique_ptr<TraceSet> set;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            auto iter = std::find_if(idle.begin(), idle.end(), [&](const Entry &entry) {
+                return entry.tracePath == tracePath;
+            });
+            if (iter != idle.end()) {
+                taken.splice(taken.end(), idle, iter);
+                return taken.back().set.get();
+            }
+            if (numOpen < maxSets) {
+                break;
+            }
+            if (!idle.empty()) {
+                // Close the set of another trace to make room
+                idle.pop_back();
+                numOpen--;
+                continue;
+            }
+            // Every set is taken, a thread holds at most one
+            released.wait(lock);
+        }
+        numOpen++;
+        numOpened++;
+    }
+
+    // The set is opened without holding the lock
+    set.reset(new TraceSet());
+    bool opened = set->addTrace(tracePath);
+
+    std::lock_guard<std::mutex> guard(mutex); (void) guard;
+    if (!opened) {
+        std::cerr << "Error: could not open trace " << tracePath << std::endl;
+        numOpen--;
+        released.notify_one();
+        return nullptr;
+    }
+    taken.push_back(Entry{tracePath, std::move(set)});
+    return taken.back().set.get();
+}
+
+void TraceSetCache::release(TraceSet *set)
+{
+    std::lock_guard<std::mutex> guard(mutex); (void) guard;
+    auto iter = std::find_if(taken.begin(), taken.end(), [&](const Entry &entry) {
+        return entry.set.get() == set;
+    });
+    if (iter == taken.end()) {
+        return;
+    }
+    idle.splice(idle.begin(), taken, iter);
+    released.notify_one();
+}
+
+size_t TraceSetCache::getOpened() const
+{
+    std::lock_guard<std::mutex> guard(mutex); (void) guard;
+    return numOpened;
+}
@@ -0,0 +1,85 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACESETCACHE_H
+#define TRACESETCACHE_H
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <trace/TraceSet.hpp>
+
+/*!
+ * \brief The TraceSetCache class keeps the opened TraceSets of an
+ * analysis, for its chunks to reuse them.
+ *
+ * Opening a trace parses its metadata and opens its stream files, so a
+ * chunk takes an idle set of its trace if there is one, and gives it back
+ * when it is done. A set is only used by one thread at a time, and a trace
+ * gets as many sets as it has chunks running at the same time.
+ *
+ * Each set keeps its stream files open, so no more sets than half the
+ * open file limit allows are open at once. Past it, the least recently
+ * used idle set is closed, or the chunk waits for a set to be given back.
+ */
+class TraceSetCache
+{
+public:
+    /*!
+     * \param filesPerSet Number of stream files a trace set opens.
+     */
+    explicit TraceSetCache(size_t filesPerSet = 1);
+
+    /*!
+     * \brief Take a set of a trace, opening it if no set of this trace
+     * is idle. Each call must be followed by a call to release().
+     * \return The set, or nullptr if it could not be opened.
+     */
+    tibee::trace::TraceSet *acquire(const std::string &tracePath);
+
+    /*!
+     * \brief Give back a set taken with acquire(), for the next chunks
+     * of its trace.
+     */
+    void release(tibee::trace::TraceSet *set);
+
+    /*!
+     * \brief Number of trace sets opened so far, including the closed ones.
+     */
+    size_t getOpened() const;
+
+private:
+    /* An idle set */
+    struct Entry {
+        std::string tracePath;
+        std::unique_ptr<tibee::trace::TraceSet> set;
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable released;
+    size_t maxSets;
+    size_t numOpen = 0;		/* idle and taken sets */
+    size_t numOpened = 0;
+    std::list<Entry> idle;	/* most recently used first */
+    std::list<Entry> taken;
+};
+
+#endif // TRACESETCACHE_H
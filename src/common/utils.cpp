@@ -19,23 +19,10 @@
 #include "utils.h"
 
 #include <cmath>
+#include <iomanip>
+#include <iostream>
 #include <sstream>
 
-tibee::trace::event_id_t getEventId(const tibee::trace::TraceSet &set, const std::string eventName)
-{
-    auto &tracesInfos = set.getTracesInfos();
-    for (const auto &traceInfos : tracesInfos) {
-        if (traceInfos->getTraceType() == "lttng-kernel") {
-            for (const auto &eventNameIdPair : *traceInfos->getEventMap()) {
-                if (eventNameIdPair.first == eventName) {
-                    return eventNameIdPair.second->getId();
-                }
-            }
-        }
-    }
-    return -1;
-}
-
 double logbase(double x, double base) {
     return log(x)/log(base);
 }
@@ -56,3 +43,27 @@ std::string convertSize(uint64_t size) {
         return "0 B";
     }
 }
+
+std::string formatLatency(uint64_t latency)
+{
+    std::stringstream ss;
+    ss << std::setprecision(3) << std::fixed << latency / 1000.0 << " us";
+    return ss.str();
+}
+
+void printLatencies(const std::string &name, const LatencyHistogram &latencies, int colWidth)
+{
+    std::cout << std::setw(colWidth) << std::left << name
+              << std::setw(12) << std::left << latencies.getCount()
+              << std::setw(16) << std::left << formatLatency(latencies.getPercentile(50))
+              << std::setw(16) << std::left << formatLatency(latencies.getPercentile(99))
+              << std::setw(16) << std::left << formatLatency(latencies.getPercentile(99.9))
+              << formatLatency(latencies.getMax()) << std::endl;
+}
+
+void printLatencyHeader(const std::string &name, int colWidth)
+{
+    std::cout << std::setw(colWidth) << std::left << name << std::setw(12) << std::left << "Count"
+              << std::setw(16) << std::left << "p50" << std::setw(16) << std::left << "p99"
+              << std::setw(16) << std::left << "p99.9" << "Max" << std::endl;
+}
@@ -19,10 +19,19 @@
 #ifndef UTILS_H
 #define UTILS_H
 
-#include <trace/BasicTypes.hpp>
-#include <trace/TraceSet.hpp>
+#include <cstdint>
+#include <string>
+
+#include "common/latencyhistogram.h"
 
-tibee::trace::event_id_t getEventId(const tibee::trace::TraceSet &set, const std::string eventName);
 std::string convertSize(uint64_t size);
 
+/*
+ * Latencies in nanoseconds, printed as microseconds. The header and the
+ * rows of a table of latency percentiles share the same columns.
+ */
+std::string formatLatency(uint64_t latency);
+void printLatencyHeader(const std::string &name, int colWidth);
+void printLatencies(const std::string &name, const LatencyHistogram &latencies, int colWidth);
+
 #endif // UTILS_H
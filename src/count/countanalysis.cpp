@@ -18,83 +18,87 @@
 
 #include "countanalysis.h"
 
-#include <QList>
-#include <QString>
-#include <QtConcurrent/QtConcurrent>
-
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <locale>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
-#include <trace/TraceSet.hpp>
-#include <base/BasicTypes.hpp>
-
-using namespace tibee;
-using namespace tibee::trace;
-
-CountWorker::CountWorker(int id, TraceSet &set, timestamp_t *begin, timestamp_t *end, bool verbose) :
-    TraceWorker(id, set, begin, end, verbose)
+/*
+ * Format a count with thousand separators.
+ */
+static std::string formatCount(uint64_t count)
 {
+    std::stringstream countss;
+    countss.imbue(std::locale(""));
+    countss << std::fixed << count;
+    return countss.str();
 }
 
-int CountWorker::doMap() const {
-    const TraceSet &traceSet = getTraceSet();
-    TraceSet::Iterator iter = traceSet.between(getBeginPos(), getEndPos());
-    TraceSet::Iterator endIter = traceSet.end();
-
-    int count = 0;
-    for ((void)iter; iter != endIter; ++iter) {
-        count++;
-    }
-
-    if (getVerbose()) {
-        const timestamp_t *begin = getBeginPos();
-        const timestamp_t *end = getEndPos();
-        std::string beginString = begin ? std::to_string(*begin) : "START";
-        std::string endString = end ? std::to_string(*end) : "END";
-        std::cout << "Worker " << getId() << " counted " << count << " events between timestamps "
-                  << beginString << " and " << endString << std::endl;
-    }
-
-    return count;
-}
-
-void CountWorker::doReduce(int &final, const int &intermediate)
+static uint64_t getTotal(const TypeCounts &counts)
 {
-    final += intermediate;
-}
-
-void CountAnalysis::doExecuteSerial() {
-    TraceSet set;
-    set.addTrace(this->tracePath.toStdString());
-
-    int count = 0;
-    for (const auto &event : set) {
-        (void) event;
-        count++;
+    uint64_t total = 0;
+    for (uint64_t count : counts) {
+        total += count;
     }
-
-    printResults(count);
+    return total;
 }
 
-bool CountAnalysis::isOrderedReduce()
+/*
+ * Print named counts, most events first.
+ */
+static void printSorted(std::vector<std::pair<std::string, uint64_t>> counts)
 {
-    return false;
+    std::sort(counts.begin(), counts.end(), [](const std::pair<std::string, uint64_t> &a,
+                                               const std::pair<std::string, uint64_t> &b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    for (const auto &count : counts) {
+        std::cout << std::setw(40) << std::left << count.first << formatCount(count.second) << std::endl;
+    }
 }
 
-void CountAnalysis::printResults(int &count)
+void CountAnalysis::printResults(TypeCountContext &data)
 {
     std::string line(80, '-');
 
-    // Format the count with thousand seperators
-    std::stringstream countss;
-    countss.imbue(std::locale(""));
-    countss << std::fixed << count;
-
     std::cout << line << std::endl;
     std::cout << "Result of count analysis" << std::endl << std::endl;
-    std::cout << std::setw(20) << std::left << "Number of events" << countss.str() << std::endl;
+    std::cout << std::setw(20) << std::left << "Number of events" << formatCount(data.getEvents()) << std::endl;
+
+    if (breakdown) {
+        // The native decoder counts per stream, babeltrace per CPU
+        std::vector<std::pair<std::string, uint64_t>> streams;
+        for (const auto &stream : data.getStreams()) {
+            streams.emplace_back(stream.first, getTotal(*stream.second));
+        }
+        if (!streams.empty()) {
+            std::cout << std::endl << "Per stream" << std::endl;
+            printSorted(streams);
+        } else {
+            std::vector<std::pair<std::string, uint64_t>> cpus;
+            for (const auto &cpu : data.getCpus()) {
+                cpus.emplace_back("CPU " + std::to_string(cpu.first), getTotal(*cpu.second));
+            }
+            if (!cpus.empty()) {
+                std::cout << std::endl << "Per CPU" << std::endl;
+                printSorted(cpus);
+            }
+        }
+
+        std::vector<std::pair<std::string, uint64_t>> eventTypes;
+        const TypeCounts &counts = data.getCounts();
+        for (size_t id = 0; id < counts.size(); id++) {
+            if (counts[id]) {
+                std::string name = data.getEventName(id);
+                eventTypes.emplace_back(name.empty() ? "id " + std::to_string(id) : name, counts[id]);
+            }
+        }
+        std::cout << std::endl << "Per event type" << std::endl;
+        printSorted(eventTypes);
+    }
     std::cout << line << std::endl;
 }
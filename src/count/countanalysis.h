@@ -19,37 +19,22 @@
 #ifndef COUNTANALYSIS_H
 #define COUNTANALYSIS_H
 
-#include "common/traceanalysis.h"
+#include "countbytype/countbytypeanalysis.h"
 
-class CountWorker : public TraceWorker<int> {
-public:
-    CountWorker(int id, TraceSet &set, timestamp_t *begin, timestamp_t *end, bool verbose = false);
-    CountWorker(CountWorker &other) = delete;
-    CountWorker &operator =(const CountWorker &other) = delete;
-
-    CountWorker(CountWorker &&other) : TraceWorker<int>(std::move(other)) {}
-    CountWorker &operator =(CountWorker &&other)
-    {
-        TraceWorker<int>::operator =(std::move(other));
-        return *this;
-    }
-
-    virtual int doMap() const;
-    static void doReduce(int &final, const int &intermediate);
-};
-
-class CountAnalysis : public TraceAnalysis<CountWorker, int>
+/*!
+ * \brief The CountAnalysis class counts the events of a trace. It maps
+ * chunks like the count-by-type analysis, which already counts events per
+ * type in dense arrays, and only prints the totals, with the per stream or
+ * per CPU and per event type counts when asked for a breakdown.
+ */
+class CountAnalysis : public CountByTypeAnalysis
 {
     Q_OBJECT
 public:
-    CountAnalysis(QObject *parent) : TraceAnalysis(parent) { }
+    CountAnalysis(QObject *parent) : CountByTypeAnalysis(parent) { }
 
 protected:
-    virtual void doEnd(int &data) {(void) data;}
-    virtual void printResults(int &data);
-    virtual void doExecuteSerial();
-    virtual bool isOrderedReduce();
-
+    virtual void printResults(TypeCountContext &data);
 };
 
 #endif // COUNTANALYSIS_H
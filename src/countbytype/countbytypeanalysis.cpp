@@ -0,0 +1,248 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "countbytypeanalysis.h"
+
+#include <QList>
+#include <QString>
+#include <QtConcurrent/QtConcurrent>
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <trace/TraceSet.hpp>
+#include <base/BasicTypes.hpp>
+
+using namespace tibee;
+using namespace tibee::trace;
+
+CountByTypeWorker::CountByTypeWorker(int id, TraceSet &set, timestamp_t *begin, timestamp_t *end, bool verbose) :
+    TraceWorker(id, set, begin, end, verbose)
+{
+}
+
+static std::shared_ptr<const std::vector<std::string>> getEventNames(const TraceMetadata &metadata)
+{
+    std::shared_ptr<std::vector<std::string>> names = std::make_shared<std::vector<std::string>>();
+    for (size_t id = 0; id < metadata.getNumEventIds(); id++) {
+        names->push_back(metadata.getEventName(id));
+    }
+    return names;
+}
+
+/*
+ * Get the distinct event names of a trace, and the position of the name
+ * of each event class, since an event enabled in several channels has an
+ * event class in each.
+ */
+static std::shared_ptr<const std::vector<std::string>> getEventNames(const CtfTrace &trace,
+                                                                     std::vector<size_t> &nameIds)
+{
+    std::shared_ptr<std::vector<std::string>> names = std::make_shared<std::vector<std::string>>();
+    std::unordered_map<std::string, size_t> ids;
+    nameIds.resize(trace.getNumEventClasses());
+    for (size_t index = 0; index < trace.getNumEventClasses(); index++) {
+        const std::string &name = trace.getEventName(index);
+        auto inserted = ids.emplace(name, names->size());
+        if (inserted.second) {
+            names->push_back(name);
+        }
+        nameIds[index] = inserted.first->second;
+    }
+    return names;
+}
+
+/*
+ * Count the events of a babeltrace iterator by event id, and by CPU if
+ * asked since reading the packet context of each event is not free.
+ */
+static void countEvents(TraceSet::Iterator &iter, const TraceSet::Iterator &endIter,
+                        const TraceMetadata &metadata, bool perCpu, TypeCountContext &context)
+{
+    context.setEventNames(getEventNames(metadata));
+    TypeCounts &counts = context.getCounts();
+    counts.resize(metadata.getNumEventIds());
+    for ((void)iter; iter != endIter; ++iter) {
+        const auto &event = *iter;
+        event_id_t id = event.getId();
+        if ((size_t) id >= counts.size()) {
+            counts.resize(id + 1);
+        }
+        counts[id]++;
+        if (perCpu) {
+            int cpu = event.getStreamPacketContext()->GetField("cpu_id")->AsUInteger();
+            TypeCounts &cpuCounts = context.getCpuCounts(cpu);
+            if ((size_t) id >= cpuCounts.size()) {
+                cpuCounts.resize(std::max<size_t>(id + 1, counts.size()));
+            }
+            cpuCounts[id]++;
+        }
+    }
+}
+
+TypeCountContext CountByTypeWorker::doMap() const {
+    if (getCtfTrace()) {
+        return doMapNative();
+    }
+
+    const TraceSet &traceSet = getTraceSet();
+    TraceSet::Iterator iter = traceSet.between(getBeginPos(), getEndPos());
+    TraceSet::Iterator endIter = traceSet.end();
+
+    TypeCountContext context;
+    countEvents(iter, endIter, getMetadata(), getBreakdown(), context);
+
+    if (getVerbose()) {
+        std::cout << "Worker " << getId() << " counted " << context.getEvents() << " events" << std::endl;
+    }
+
+    return context;
+}
+
+TypeCountContext CountByTypeWorker::doMapNative() const
+{
+    // Events are counted from their headers, each stream already has its
+    // own dense counts and belongs to a single CPU. The counts are indexed
+    // by the ids of the stream class, which other channels reuse, so they
+    // are moved to the position of their event name before merging.
+    const CtfTrace &trace = *getCtfTrace();
+    std::vector<CtfStreamCount> counts;
+    if (!trace.count(getBeginPos(), getEndPos(), counts)) {
+        std::cerr << "Error: could not count the events of worker " << getId() << std::endl;
+        setFailed();
+    }
+
+    TypeCountContext context;
+    std::vector<size_t> nameIds;
+    std::shared_ptr<const std::vector<std::string>> names = getEventNames(trace, nameIds);
+    context.setEventNames(names);
+    TypeCountContext stream;
+    for (CtfStreamCount &streamCount : counts) {
+        if (!streamCount.streamClass) {
+            continue;
+        }
+        const std::vector<CtfEventClass> &eventClasses = streamCount.streamClass->events;
+        TypeCounts &streamCounts = stream.getCounts();
+        streamCounts.resize(names->size());
+        for (size_t id = 0; id < streamCount.events.size() && id < eventClasses.size(); id++) {
+            streamCounts[nameIds[eventClasses[id].index]] += streamCount.events[id];
+        }
+        if (streamCount.cpu >= 0) {
+            stream.getCpuCounts(streamCount.cpu) = stream.getCounts();
+        }
+        stream.getStreamCounts(streamCount.stream) = stream.getCounts();
+        context.merge(stream);
+        stream = TypeCountContext();
+    }
+
+    if (getVerbose()) {
+        std::cout << "Worker " << getId() << " counted " << context.getEvents() << " events (native decoder)" << std::endl;
+    }
+
+    return context;
+}
+
+void CountByTypeWorker::doReduce(TypeCountContext &final, const TypeCountContext &intermediate)
+{
+    final.merge(intermediate);
+}
+
+void CountByTypeAnalysis::doExecuteSerial() {
+    TraceSet set;
+    set.addTrace(this->tracePath.toStdString());
+    TraceMetadata metadata(set);
+
+    TraceSet::Iterator iter = set.between(getWindowBeginPos(), getWindowEndPos());
+    TraceSet::Iterator endIter = set.end();
+
+    TypeCountContext data;
+    countEvents(iter, endIter, metadata, breakdown, data);
+
+    printResults(data);
+}
+
+bool CountByTypeAnalysis::isOrderedReduce()
+{
+    return false;
+}
+
+/*
+ * Format a count with thousand separators.
+ */
+static std::string formatCount(uint64_t count)
+{
+    std::stringstream countss;
+    countss.imbue(std::locale(""));
+    countss << std::fixed << count;
+    return countss.str();
+}
+
+/*
+ * Print the event types that have events, most events first.
+ */
+static void printCounts(const TypeCountContext &data, const TypeCounts &counts)
+{
+    std::vector<size_t> ids;
+    uint64_t total = 0;
+    for (size_t id = 0; id < counts.size(); id++) {
+        if (counts[id]) {
+            ids.push_back(id);
+            total += counts[id];
+        }
+    }
+    std::sort(ids.begin(), ids.end(), [&](size_t a, size_t b) {
+        return counts[a] != counts[b] ? counts[a] > counts[b] : data.getEventName(a) < data.getEventName(b);
+    });
+    for (size_t id : ids) {
+        std::string name = data.getEventName(id);
+        if (name.empty()) {
+            name = "id " + std::to_string(id);
+        }
+        std::cout << std::setw(40) << std::left << name << std::setw(20) << formatCount(counts[id])
+                  << std::fixed << std::setprecision(2) << 100.0 * counts[id] / total << " %" << std::endl;
+    }
+}
+
+void CountByTypeAnalysis::printResults(TypeCountContext &data)
+{
+    std::string line(80, '-');
+
+    std::cout << line << std::endl;
+    std::cout << "Result of count-by-type analysis" << std::endl << std::endl;
+    std::cout << std::setw(40) << std::left << "Number of events" << formatCount(data.getEvents()) << std::endl;
+    std::cout << std::endl;
+    printCounts(data, data.getCounts());
+
+    if (breakdown) {
+        for (const auto &cpu : data.getCpus()) {
+            std::cout << std::endl << "CPU " << cpu.first << std::endl;
+            printCounts(data, *cpu.second);
+        }
+        for (const auto &stream : data.getStreams()) {
+            std::cout << std::endl << "Stream " << stream.first << std::endl;
+            printCounts(data, *stream.second);
+        }
+    }
+    std::cout << line << std::endl;
+}
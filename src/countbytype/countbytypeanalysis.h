@@ -0,0 +1,71 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COUNTBYTYPEANALYSIS_H
+#define COUNTBYTYPEANALYSIS_H
+
+#include "common/traceanalysis.h"
+#include "typecountcontext.h"
+
+class CountByTypeWorker : public TraceWorker<TypeCountContext> {
+public:
+    CountByTypeWorker(int id, TraceSet &set, timestamp_t *begin, timestamp_t *end, bool verbose = false);
+    CountByTypeWorker(CountByTypeWorker &other) = delete;
+    CountByTypeWorker &operator =(const CountByTypeWorker &other) = delete;
+
+    CountByTypeWorker(CountByTypeWorker &&other) : TraceWorker<TypeCountContext>(std::move(other)) {}
+    CountByTypeWorker &operator =(CountByTypeWorker &&other)
+    {
+        TraceWorker<TypeCountContext>::operator =(std::move(other));
+        return *this;
+    }
+
+    virtual TypeCountContext doMap() const;
+    TypeCountContext doMapNative() const;
+    static void doReduce(TypeCountContext &final, const TypeCountContext &intermediate);
+};
+
+class CountByTypeAnalysis : public TraceAnalysis<CountByTypeWorker, TypeCountContext>
+{
+    Q_OBJECT
+public:
+    CountByTypeAnalysis(QObject *parent) : TraceAnalysis(parent) { }
+
+protected:
+    virtual void doEnd(TypeCountContext &data) {(void) data;}
+    virtual void printResults(TypeCountContext &data);
+    virtual void doExecuteSerial();
+    virtual bool isOrderedReduce();
+    virtual QString getCacheName()
+    {
+        // Chunks counted without the breakdown lack the per-CPU counts.
+        // The count analysis maps the same chunks, and shares the cache
+        return breakdown ? "count-by-type-breakdown" : "count-by-type";
+    }
+    virtual int getCacheVersion()
+    {
+        return 3;
+    }
+    virtual bool supportsNativeDecoder()
+    {
+        return true;
+    }
+
+};
+
+#endif // COUNTBYTYPEANALYSIS_H
@@ -0,0 +1,200 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "typecountcontext.h"
+
+#include <algorithm>
+
+/*
+ * Add the counts of another chunk, element by element. The loop has no
+ * aliasing nor dependency between iterations, so that the compiler
+ * vectorizes it.
+ */
+static void addCounts(TypeCounts &into, const TypeCounts &from)
+{
+    if (into.size() < from.size()) {
+        into.resize(from.size());
+    }
+    uint64_t *__restrict dst = into.data();
+    const uint64_t *__restrict src = from.data();
+    size_t size = from.size();
+    for (size_t i = 0; i < size; i++) {
+        dst[i] += src[i];
+    }
+}
+
+static void writeCounts(QDataStream &out, const TypeCounts &counts)
+{
+    out << (quint32) counts.size();
+    for (uint64_t count : counts) {
+        out << (quint64) count;
+    }
+}
+
+static void readCounts(QDataStream &in, TypeCounts &counts)
+{
+    quint32 size;
+    in >> size;
+    counts.clear();
+    for (quint32 i = 0; i < size && in.status() == QDataStream::Ok; i++) {
+        quint64 count;
+        in >> count;
+        counts.push_back(count);
+    }
+}
+
+void TypeCountContext::setEventNames(std::shared_ptr<const std::vector<std::string>> names)
+{
+    eventNames = names;
+}
+
+const std::string &TypeCountContext::getEventName(size_t id) const
+{
+    static const std::string unknown;
+    if (!eventNames || id >= eventNames->size()) {
+        return unknown;
+    }
+    return (*eventNames)[id];
+}
+
+TypeCounts &TypeCountContext::getCounts()
+{
+    return counts;
+}
+
+TypeCounts &TypeCountContext::getCpuCounts(int cpu)
+{
+    if ((size_t) cpu >= cpus.size()) {
+        cpus.resize(cpu + 1);
+    }
+    return cpus[cpu];
+}
+
+TypeCounts &TypeCountContext::getStreamCounts(const std::string &stream)
+{
+    return streams[NameTable::instance().intern(stream)];
+}
+
+void TypeCountContext::merge(const TypeCountContext &other)
+{
+    if (!eventNames || (other.eventNames && other.eventNames->size() > eventNames->size())) {
+        eventNames = other.eventNames;
+    }
+    addCounts(counts, other.counts);
+    if (cpus.size() < other.cpus.size()) {
+        cpus.resize(other.cpus.size());
+    }
+    for (size_t cpu = 0; cpu < other.cpus.size(); cpu++) {
+        addCounts(cpus[cpu], other.cpus[cpu]);
+    }
+    other.streams.forEach([&](int name, const TypeCounts &stream) {
+        addCounts(streams[name], stream);
+    });
+}
+
+uint64_t TypeCountContext::getEvents() const
+{
+    uint64_t events = 0;
+    for (uint64_t count : counts) {
+        events += count;
+    }
+    return events;
+}
+
+const TypeCounts &TypeCountContext::getCounts() const
+{
+    return counts;
+}
+
+std::vector<std::pair<int, const TypeCounts *>> TypeCountContext::getCpus() const
+{
+    std::vector<std::pair<int, const TypeCounts *>> result;
+    for (size_t cpu = 0; cpu < cpus.size(); cpu++) {
+        if (std::any_of(cpus[cpu].begin(), cpus[cpu].end(), [](uint64_t count) { return count != 0; })) {
+            result.emplace_back(cpu, &cpus[cpu]);
+        }
+    }
+    return result;
+}
+
+std::vector<std::pair<std::string, const TypeCounts *>> TypeCountContext::getStreams() const
+{
+    std::vector<std::pair<std::string, const TypeCounts *>> result;
+    streams.forEach([&](int name, const TypeCounts &stream) {
+        result.emplace_back(NameTable::instance().resolve(name), &stream);
+    });
+    std::sort(result.begin(), result.end(), [](const std::pair<std::string, const TypeCounts *> &a,
+                                               const std::pair<std::string, const TypeCounts *> &b) {
+        return a.first < b.first;
+    });
+    return result;
+}
+
+QDataStream &operator<<(QDataStream &out, const TypeCountContext &context)
+{
+    // The names are written with the counts, so that cached chunks can be
+    // printed without the trace
+    quint32 numNames = context.eventNames ? context.eventNames->size() : 0;
+    out << numNames;
+    for (quint32 id = 0; id < numNames; id++) {
+        out << QString::fromStdString((*context.eventNames)[id]);
+    }
+    writeCounts(out, context.counts);
+    out << (quint32) context.cpus.size();
+    for (const TypeCounts &cpu : context.cpus) {
+        writeCounts(out, cpu);
+    }
+    out << (quint32) context.streams.size();
+    context.streams.forEach([&](int name, const TypeCounts &stream) {
+        out << QString::fromStdString(NameTable::instance().resolve(name));
+        writeCounts(out, stream);
+    });
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, TypeCountContext &context)
+{
+    quint32 numNames;
+    in >> numNames;
+    std::shared_ptr<std::vector<std::string>> names = std::make_shared<std::vector<std::string>>();
+    for (quint32 id = 0; id < numNames && in.status() == QDataStream::Ok; id++) {
+        QString name;
+        in >> name;
+        names->push_back(name.toStdString());
+    }
+    context.eventNames = names;
+    readCounts(in, context.counts);
+
+    quint32 numCpus;
+    in >> numCpus;
+    context.cpus.clear();
+    for (quint32 cpu = 0; cpu < numCpus && in.status() == QDataStream::Ok; cpu++) {
+        context.cpus.emplace_back();
+        readCounts(in, context.cpus.back());
+    }
+
+    quint32 numStreams;
+    in >> numStreams;
+    context.streams.clear();
+    for (quint32 i = 0; i < numStreams && in.status() == QDataStream::Ok; i++) {
+        QString name;
+        in >> name;
+        readCounts(in, context.streams[NameTable::instance().intern(name.toStdString())]);
+    }
+    return in;
+}
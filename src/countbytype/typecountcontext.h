@@ -0,0 +1,82 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TYPECOUNTCONTEXT_H
+#define TYPECOUNTCONTEXT_H
+
+#include "common/flatmap.h"
+#include "common/nametable.h"
+
+#include <QDataStream>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Number of events of each type, indexed by event id.
+ */
+typedef std::vector<uint64_t> TypeCounts;
+
+/*!
+ * \brief The TypeCountContext class holds the number of events of each
+ * event type of a chunk, in total and optionally broken down by CPU and
+ * by stream file.
+ *
+ * The counts are dense arrays indexed by event id, the event names are
+ * only looked up when printing. The streams are only known to the native
+ * decoder, the breakdown by stream is empty with babeltrace.
+ */
+class TypeCountContext
+{
+public:
+    /*!
+     * \brief Set the names of the event ids, shared by all the chunks.
+     */
+    void setEventNames(std::shared_ptr<const std::vector<std::string>> names);
+    const std::string &getEventName(size_t id) const;
+
+    TypeCounts &getCounts();
+    TypeCounts &getCpuCounts(int cpu);
+    TypeCounts &getStreamCounts(const std::string &stream);
+
+    void merge(const TypeCountContext &other);
+
+    uint64_t getEvents() const;
+    const TypeCounts &getCounts() const;
+
+    /*!
+     * \brief Get the CPUs or streams which have events, with their counts.
+     */
+    std::vector<std::pair<int, const TypeCounts *>> getCpus() const;
+    std::vector<std::pair<std::string, const TypeCounts *>> getStreams() const;
+
+    // Serialization of the map results, for the result cache
+    friend QDataStream &operator<<(QDataStream &out, const TypeCountContext &context);
+    friend QDataStream &operator>>(QDataStream &in, TypeCountContext &context);
+
+private:
+    std::shared_ptr<const std::vector<std::string>> eventNames;
+    TypeCounts counts;
+    std::vector<TypeCounts> cpus;	/* indexed by cpu id */
+    FlatMap<TypeCounts> streams;	/* keyed by interned name */
+};
+
+#endif // TYPECOUNTCONTEXT_H
@@ -18,10 +18,15 @@
 
 #include "cpuanalysis.h"
 #include "cpucontext.h"
+#include "common/pipeline.h"
+#include "common/recordbatch.h"
 #include "common/utils.h"
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <limits>
 #include <sstream>
 
 #include <QVector>
@@ -42,6 +47,13 @@ CpuWorker::CpuWorker(int id, TraceSet &set, timestamp_t *begin, timestamp_t *end
 
 CpuContext CpuWorker::doMap() const
 {
+    if (getColumnSegment()) {
+        return doMapColumns();
+    }
+    if (getCtfTrace()) {
+        return doMapNative();
+    }
+
     const TraceSet &traceSet = getTraceSet();
     TraceSet::Iterator iter = traceSet.between(getBeginPos(), getEndPos());
     TraceSet::Iterator endIter = traceSet.end();
@@ -52,9 +64,11 @@ CpuContext CpuWorker::doMap() const
     CpuContext data;
     data.setStart(begin ? *begin : traceSet.getBegin());
     data.setEnd(end ? *end : traceSet.getEnd());
+    data.setSeriesWidth(getSeriesWidth());
+    data.setSketchCapacity(getSketchCapacity());
 
     // Get sched_switch event id
-    event_id_t schedSwitchId = getEventId(traceSet, "sched_switch");
+    event_id_t schedSwitchId = getMetadata().getEventId("sched_switch");
 
     if (schedSwitchId < 0) {
         std::cerr << "The trace is missing sched_switch events." << std::endl;
@@ -85,6 +99,143 @@ CpuContext CpuWorker::doMap() const
     return data;
 }
 
+CpuContext CpuWorker::doMapColumns() const
+{
+    const ColumnSegment &segment = *getColumnSegment();
+    const timestamp_t *begin = getBeginPos();
+    const timestamp_t *end = getEndPos();
+    CpuContext data;
+    data.setStart(begin ? *begin : segment.getBegin());
+    data.setEnd(end ? *end : segment.getEnd());
+    data.setSeriesWidth(getSeriesWidth());
+    data.setSketchCapacity(getSketchCapacity());
+
+    uint64_t schedSwitchCount = 0;
+    segment.forEachSchedSwitch(begin ? *begin : 0, end ? *end : UINT64_MAX,
+                               [&](uint64_t timestamp, int cpu, int prevTid, int nextTid, name_id_t prevComm) {
+        schedSwitchCount++;
+        data.handleSchedSwitch(timestamp, cpu, prevTid, nextTid, prevComm);
+    });
+
+    if (getVerbose()) {
+        std::string beginString = begin ? std::to_string(*begin) : "START";
+        std::string endString = end ? std::to_string(*end) : "END";
+        std::cout << "Worker " << getId() << " replayed " << schedSwitchCount
+                  << " sched_switch between timestamps " << beginString << " and " << endString << std::endl;
+    }
+
+    return data;
+}
+
+CpuContext CpuWorker::doMapNative() const
+{
+    const CtfTrace &trace = *getCtfTrace();
+    const timestamp_t *begin = getBeginPos();
+    const timestamp_t *end = getEndPos();
+    CpuContext data;
+    data.setStart(begin ? *begin : trace.getBegin());
+    data.setEnd(end ? *end : trace.getEnd());
+    data.setSeriesWidth(getSeriesWidth());
+    data.setSketchCapacity(getSketchCapacity());
+
+    // Resolve the fields once, instead of looking them up by name for every
+    // event. Each channel with sched_switch has its own event class.
+    struct SchedSwitchFields {
+        bool isSchedSwitch = false;
+        CtfFieldHandle prevTid;
+        CtfFieldHandle nextTid;
+        CtfFieldHandle prevComm;
+    };
+    std::vector<SchedSwitchFields> schedSwitches(trace.getNumEventClasses());
+    std::vector<const CtfEventClass *> schedSwitchClasses = trace.getEventClasses("sched_switch");
+    if (schedSwitchClasses.empty()) {
+        std::cerr << "The trace is missing sched_switch events." << std::endl;
+        return data;
+    }
+    for (const CtfEventClass *eventClass : schedSwitchClasses) {
+        SchedSwitchFields &fields = schedSwitches[eventClass->index];
+        fields.isSchedSwitch = true;
+        fields.prevTid = trace.getFieldHandle(*eventClass, CtfScope::FIELDS, "prev_tid");
+        fields.nextTid = trace.getFieldHandle(*eventClass, CtfScope::FIELDS, "next_tid");
+        fields.prevComm = trace.getFieldHandle(*eventClass, CtfScope::FIELDS, "prev_comm");
+    }
+
+    NameTable &names = NameTable::instance();
+    auto decode = [&](const CtfEvent &event, SchedSwitchRecord &record) -> bool {
+        const SchedSwitchFields &fields = schedSwitches[event.getEventClass().index];
+        if (!fields.isSchedSwitch) {
+            return false;
+        }
+        const char *comm;
+        size_t commLength;
+        event.getText(fields.prevComm, comm, commLength);
+        record.timestamp = event.getTimestamp();
+        record.cpu = event.getCpu();
+        record.prevTid = event.getInteger(fields.prevTid);
+        record.nextTid = event.getInteger(fields.nextTid);
+        record.prevComm = names.intern(comm, commLength);
+        return true;
+    };
+    auto handle = [&](const SchedSwitchRecord *records, size_t size) {
+        data.handleSchedSwitches(records, size);
+    };
+
+    uint64_t count = 0;
+    uint64_t schedSwitchCount = 0;
+    if (getPipelineDecoders() > 0) {
+        Pipeline<SchedSwitchRecord> pipeline(getPipelineDecoders());
+        if (!pipeline.run(trace, begin, end, getProjection(), decode, handle)) {
+            setFailed();
+        }
+        for (const PipelineStageStats &stats : pipeline.getDecoderStats()) {
+            count += stats.events;
+        }
+        schedSwitchCount = pipeline.getAnalysisStats().records;
+        if (getVerbose()) {
+            pipeline.printStats(std::cout, getId());
+        }
+    } else {
+        // Events are decoded into batches of records, then handed to the analysis
+        RecordBatch<SchedSwitchRecord> batch;
+        SchedSwitchRecord record;
+        CtfTrace::Iterator iter = trace.between(begin, end, getProjection());
+        CtfTrace::Iterator endIter = trace.end();
+        for ((void)iter; iter != endIter; ++iter) {
+            count++;
+            if (!decode(*iter, record)) {
+                continue;
+            }
+            schedSwitchCount++;
+            batch.add() = record;
+            if (batch.isFull()) {
+                handle(batch.data(), batch.size());
+                batch.clear();
+            }
+        }
+        handle(batch.data(), batch.size());
+        if (iter.hasFailed()) {
+            setFailed();
+        }
+    }
+
+    if (getVerbose()) {
+        std::string beginString = begin ? std::to_string(*begin) : "START";
+        std::string endString = end ? std::to_string(*end) : "END";
+        std::cout << "Worker " << getId() << " decoded " << count << " events ("
+                  << schedSwitchCount << " sched_switch) between timestamps "
+                  << beginString << " and " << endString << std::endl;
+    }
+
+    return data;
+}
+
+CtfProjection CpuWorker::getProjection()
+{
+    CtfProjection projection;
+    projection.addEvent("sched_switch", {"prev_tid", "next_tid", "prev_comm"});
+    return projection;
+}
+
 void CpuWorker::doReduce(CpuContext &final, const CpuContext &intermediate)
 {
     final.merge(intermediate);
@@ -95,18 +246,26 @@ bool CpuAnalysis::isOrderedReduce()
     return true;
 }
 
+bool CpuAnalysis::supportsColumns()
+{
+    return true;
+}
+
 void CpuAnalysis::doExecuteSerial()
 {
     TraceSet set;
     set.addTrace(this->tracePath.toStdString());
+    TraceMetadata metadata(set);
 
-    // Set begin and end timestamps
+    // Set begin and end timestamps, clipped to the time window
     CpuContext data;
-    data.setStart(set.getBegin());
-    data.setEnd(set.getEnd());
+    data.setStart(std::max(set.getBegin(), windowBegin));
+    data.setEnd(std::min(set.getEnd(), windowEnd));
+    data.setSeriesWidth(seriesWidth);
+    data.setSketchCapacity(sketchCapacity);
 
     // Get sched_switch event id
-    event_id_t schedSwitchId = getEventId(set, "sched_switch");
+    event_id_t schedSwitchId = metadata.getEventId("sched_switch");
 
     if (schedSwitchId < 0) {
         std::cerr << "The trace is missing sched_switch events." << std::endl;
@@ -116,8 +275,11 @@ void CpuAnalysis::doExecuteSerial()
     // Iterate through sched_switch events
     uint64_t count = 0;
     uint64_t schedSwitchCount = 0;
-    for (const auto &event : set) {
+    TraceSet::Iterator iter = set.between(getWindowBeginPos(), getWindowEndPos());
+    TraceSet::Iterator endIter = set.end();
+    for ((void)iter; iter != endIter; ++iter) {
         count++;
+        const auto &event = *iter;
         event_id_t id = event.getId();
         if (id == schedSwitchId) {
             schedSwitchCount++;
@@ -160,16 +322,55 @@ void CpuAnalysis::printResults(CpuContext &data)
     std::cout << std::setw(30) << std::left << "Process" << "Percentage time" << std::endl;
 
     // Print out top 10 processes
-    int max = 10;
-    int count = 0;
-    for (const Process &process : data.getTids()) {
-        if (++count > max) {
-            break;
-        }
+    for (const Process &process : data.getTopTids(10)) {
         std::stringstream ss;
-        ss << process.comm << " (" << process.tid << ")";
+        ss << NameTable::instance().resolve(process.comm) << " (" << process.tid << ")";
         double pc = ((double)(process.cpu_ns * 100))/((double)total);
         std::cout << std::setw(30) << std::left << ss.str()
                   << std::setprecision(2) << std::fixed << pc << std::endl;
     }
+    if (data.getTopTidsError()) {
+        double error = ((double)(data.getTopTidsError() * 100))/((double)total);
+        std::cout << "Approximate: each percentage is at most " << std::setprecision(2) << std::fixed
+                  << error << " below the real one" << std::endl;
+    }
+
+    if (data.getSeriesWidth()) {
+        printSeries(data);
+    }
+}
+
+void CpuAnalysis::printSeries(const CpuContext &data)
+{
+    std::vector<const Cpu *> cpus;
+    uint64_t begin = std::numeric_limits<uint64_t>::max();
+    uint64_t end = 0;
+    for (const Cpu &cpu : data.getCpus()) {
+        cpus.push_back(&cpu);
+        if (cpu.busy.getEnd() > cpu.busy.getBegin()) {
+            begin = std::min<uint64_t>(begin, cpu.busy.getBegin());
+            end = std::max<uint64_t>(end, cpu.busy.getEnd());
+        }
+    }
+    std::sort(cpus.begin(), cpus.end(), [](const Cpu *a, const Cpu *b) {
+        return a->id < b->id;
+    });
+
+    // One row per time bucket, with the percentage of it each CPU was busy
+    std::ofstream file;
+    std::ostream &out = openSeriesOutput(file);
+    uint64_t width = data.getSeriesWidth();
+    out << "timestamp";
+    for (const Cpu *cpu : cpus) {
+        out << ",cpu" << cpu->id;
+    }
+    out << std::endl;
+    for (uint64_t timestamp = begin; timestamp < end; timestamp += width) {
+        out << timestamp;
+        for (const Cpu *cpu : cpus) {
+            out << "," << std::setprecision(2) << std::fixed << cpu->busy.get(timestamp) * 100.0 / width;
+        }
+        out << "\n";
+    }
+    out.flush();
 }
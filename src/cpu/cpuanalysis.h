@@ -40,6 +40,9 @@ public:
     CpuContext &getData();
 
     virtual CpuContext doMap() const;
+    CpuContext doMapColumns() const;
+    CpuContext doMapNative() const;
+    static CtfProjection getProjection();
     static void doReduce(CpuContext &final, const CpuContext &intermediate);
 };
 
@@ -51,9 +54,25 @@ public:
 
 protected:
     virtual bool isOrderedReduce();
+    virtual QString getCacheName()
+    {
+        return "cpu";
+    }
+    virtual int getCacheVersion()
+    {
+        return 5;
+    }
+    virtual bool supportsColumns();
+    virtual bool supportsNativeDecoder()
+    {
+        return true;
+    }
     virtual void doExecuteSerial();
     virtual void printResults(CpuContext &data);
     virtual void doEnd(CpuContext &data);
+
+private:
+    void printSeries(const CpuContext &data);
 };
 
 #endif // CPUANALYSIS_H
@@ -28,47 +28,66 @@ void CpuContext::handleSchedSwitch(const tibee::trace::EventValue &event)
 {
     uint64_t timestamp = event.getTimestamp();
     int cpu = event.getStreamPacketContext()->GetField("cpu_id")->AsUInteger();
-    int prev_pid = event.getFields()->GetField("prev_tid")->AsInteger();
-    int next_pid = event.getFields()->GetField("next_tid")->AsInteger();
-    std::string prev_comm = event.getFields()->GetField("prev_comm")->AsString();
-
-    // Calculate CPU time
-    Cpu &c = getCpu(cpu);
-    if (c.currentTask) {
-        // We had a currently running task
-        c.cpu_ns += timestamp - c.currentTask->start;
-    } else if (prev_pid != 0) {
-        // We had an unknown running task
-        c.unknownTask = Task();
-        c.unknownTask->end = timestamp;
-        c.unknownTask->tid = prev_pid;
-    }
-
-    // Calculate PID time
-    // Create previous process if doesn't exist
-    if(!tids.contains(prev_pid)) {
-        Process p;
-        p.comm = prev_comm;
-        p.tid = prev_pid;
-        tids[prev_pid] = p;
-    } else {
-        Process &p = tids[prev_pid];
-        p.comm = prev_comm;
-    }
+    const auto *fields = event.getFields();
+    int prev_pid = fields->GetField("prev_tid")->AsInteger();
+    int next_pid = fields->GetField("next_tid")->AsInteger();
+    name_id_t prev_comm = NameTable::instance().intern(fields->GetField("prev_comm")->AsString());
 
-    // Update previous process
-    if (c.currentTask) {
-        Process &p = tids[prev_pid];
-        p.cpu_ns += (timestamp - c.currentTask->start);
-    }
+    handleSchedSwitch(timestamp, cpu, prev_pid, next_pid, prev_comm);
+}
 
-    // Update current task
-    if (next_pid != 0) {
-        c.currentTask = Task();
-        c.currentTask->start = timestamp;
-        c.currentTask->tid = next_pid;
-    } else {
-        c.currentTask = boost::none;
+void CpuContext::handleSchedSwitch(uint64_t timestamp, int cpu, int prev_pid, int next_pid, name_id_t prev_comm)
+{
+    SchedSwitchRecord record = {timestamp, cpu, prev_pid, next_pid, prev_comm};
+    handleSchedSwitches(&record, 1);
+}
+
+void CpuContext::handleSchedSwitches(const SchedSwitchRecord *records, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const SchedSwitchRecord &record = records[i];
+
+        // Calculate CPU time
+        Cpu &c = getCpu(record.cpu);
+        if (c.currentTask) {
+            // We had a currently running task
+            c.cpu_ns += record.timestamp - c.currentTask->start;
+            if (seriesWidth) {
+                c.busy.addDuration(c.currentTask->start, record.timestamp);
+            }
+        } else if (record.prevTid != 0) {
+            // We had an unknown running task
+            c.unknownTask = Task();
+            c.unknownTask->end = record.timestamp;
+            c.unknownTask->tid = record.prevTid;
+            c.unknownTask->comm = record.prevComm;
+        }
+
+        // With a sketch, only the heaviest processes are kept
+        if (sketch.isEnabled()) {
+            if (c.currentTask) {
+                sketch.add(record.prevTid, record.timestamp - c.currentTask->start, record.prevComm);
+            }
+        } else {
+            // Calculate PID time, creating the previous process if it doesn't exist
+            Process &p = tids[record.prevTid];
+            p.tid = record.prevTid;
+            p.comm = record.prevComm;
+
+            // Update previous process
+            if (c.currentTask) {
+                p.cpu_ns += (record.timestamp - c.currentTask->start);
+            }
+        }
+
+        // Update current task
+        if (record.nextTid != 0) {
+            c.currentTask = Task();
+            c.currentTask->start = record.timestamp;
+            c.currentTask->tid = record.nextTid;
+        } else {
+            c.currentTask = boost::none;
+        }
     }
 }
 
@@ -78,8 +97,18 @@ void CpuContext::handleEnd()
     for (Cpu &cpu : cpus) {
         if (cpu.currentTask) {
             cpu.cpu_ns += end - cpu.currentTask->start;
-            Process &p = tids[cpu.currentTask->tid];
-            p.cpu_ns += end - cpu.currentTask->start;
+            if (seriesWidth) {
+                cpu.busy.addDuration(cpu.currentTask->start, end);
+            }
+            // The task was not switched out, its name is the one seen last
+            if (sketch.isEnabled()) {
+                int tid = cpu.currentTask->tid;
+                sketch.add(tid, end - cpu.currentTask->start, sketch.getName(tid));
+            } else {
+                Process &p = tids[cpu.currentTask->tid];
+                p.tid = cpu.currentTask->tid;
+                p.cpu_ns += end - cpu.currentTask->start;
+            }
             cpu.currentTask = boost::none;
         }
     }
@@ -88,13 +117,9 @@ void CpuContext::handleEnd()
     std::sort(cpus.begin(), cpus.end(), [](const Cpu &a, const Cpu &b) -> bool {
         return a.cpu_ns > b.cpu_ns;
     });
-
-    // Sort TIDs
-    QList<Process> l = tids.values();
-    sortedTids = l.toStdList();
-    sortedTids.sort([](const Process &a, const Process &b) -> bool {
-        return a.cpu_ns > b.cpu_ns;
-    });
+    for (unsigned int i = 0; i < cpus.size(); i++) {
+        cpuIndices[cpus[i].id] = i;
+    }
 }
 
 void CpuContext::merge(const CpuContext &other)
@@ -106,27 +131,29 @@ void CpuContext::merge(const CpuContext &other)
     if (other.end > end) {
         end = other.end;
     }
+    if (!seriesWidth) {
+        seriesWidth = other.seriesWidth;
+    }
 
-    // Merge CPUs
+    // Merge CPUs, the busy time series of consecutive chunks share their
+    // boundary bucket
     for (const Cpu &otherCpu : other.cpus) {
         Cpu &thisCpu = getCpu(otherCpu.id);
         thisCpu.cpu_ns += otherCpu.cpu_ns;
+        thisCpu.busy.merge(otherCpu.busy);
     }
 
     // Merge TIDs
-    QHashIterator<int, Process> otherTidsIter(other.tids);
-    while (otherTidsIter.hasNext()) {
-        otherTidsIter.next();
-        const int &tid = otherTidsIter.key();
-        const Process &otherTid = otherTidsIter.value();
-        if (tids.contains(tid)) {
-            Process &thisTid = tids[tid];
-            thisTid.cpu_ns += otherTid.cpu_ns;
-            thisTid.comm = otherTid.comm;
+    sketch.merge(other.sketch);
+    other.tids.forEach([&](int tid, const Process &otherTid) {
+        Process *thisTid = tids.find(tid);
+        if (thisTid) {
+            thisTid->cpu_ns += otherTid.cpu_ns;
+            thisTid->comm = otherTid.comm;
         } else {
             tids[tid] = otherTid;
         }
-    }
+    });
 
     // Do fixing
     for (const Cpu &otherCpu : other.cpus) {
@@ -138,10 +165,21 @@ void CpuContext::merge(const CpuContext &other)
                 // Merge cpu time
                 uint64_t taskTime = otherCpu.unknownTask->end - thisCpu.currentTask->start;
                 thisCpu.cpu_ns += taskTime;
+                if (seriesWidth) {
+                    thisCpu.busy.addDuration(thisCpu.currentTask->start, otherCpu.unknownTask->end);
+                }
                 if (thisCpu.currentTask->tid == otherCpu.unknownTask->tid) {
                     // Merge process time and name
-                    Process &thisProcess = tids[thisCpu.currentTask->tid];
-                    thisProcess.cpu_ns += taskTime;
+                    if (sketch.isEnabled()) {
+                        sketch.add(thisCpu.currentTask->tid, taskTime, otherCpu.unknownTask->comm);
+                    } else {
+                        Process &thisProcess = tids[thisCpu.currentTask->tid];
+                        thisProcess.tid = thisCpu.currentTask->tid;
+                        thisProcess.cpu_ns += taskTime;
+                        if (otherCpu.unknownTask->comm != NameTable::EMPTY) {
+                            thisProcess.comm = otherCpu.unknownTask->comm;
+                        }
+                    }
                 } else {
                     std::cerr << "Mismatch: merging current tid=" << thisCpu.currentTask->tid
                               << " with unknown tid=" << otherCpu.unknownTask << std::endl;
@@ -191,25 +229,152 @@ void CpuContext::setEnd(const uint64_t &value)
 {
     end = value;
 }
+uint64_t CpuContext::getSeriesWidth() const
+{
+    return seriesWidth;
+}
+
+void CpuContext::setSeriesWidth(uint64_t value)
+{
+    seriesWidth = value;
+    for (Cpu &cpu : cpus) {
+        cpu.busy.setWidth(value);
+    }
+}
+
 const std::vector<Cpu> &CpuContext::getCpus() const
 {
     return cpus;
 }
-const std::list<Process> &CpuContext::getTids() const
+void CpuContext::setSketchCapacity(size_t value)
 {
-    return sortedTids;
+    sketch.setCapacity(value);
 }
 
-Cpu &CpuContext::getCpu(unsigned int cpu)
+std::vector<Process> CpuContext::getTopTids(size_t count) const
 {
-    std::vector<Cpu>::iterator iter;
-    for (iter = cpus.begin(); iter != cpus.end(); ++iter) {
-        if (iter->id == cpu) {
-            return *iter;
+    if (sketch.isEnabled()) {
+        std::vector<Process> top;
+        for (const SpaceSaving::Counter &counter : sketch.getTop(count)) {
+            Process p;
+            p.tid = counter.key;
+            p.comm = counter.name;
+            p.cpu_ns = counter.weight - counter.error;
+            top.push_back(p);
         }
+        return top;
     }
+    return tids.getTop(count, [](const Process &a, const Process &b) -> bool {
+        return a.cpu_ns > b.cpu_ns;
+    });
+}
+
+uint64_t CpuContext::getTopTidsError() const
+{
+    return sketch.getMaxError();
+}
+
+Cpu &CpuContext::getCpu(unsigned int cpu)
+{
+    if (cpu < cpuIndices.size() && cpuIndices[cpu] >= 0) {
+        return cpus[cpuIndices[cpu]];
+    }
+    if (cpu >= cpuIndices.size()) {
+        cpuIndices.resize(cpu + 1, -1);
+    }
+    cpuIndices[cpu] = cpus.size();
     cpus.emplace_back(cpu);
+    cpus.back().busy.setWidth(seriesWidth);
     return cpus.back();
 }
 
+static void writeTask(QDataStream &out, const boost::optional<Task> &task)
+{
+    out << (bool) task;
+    if (task) {
+        out << (quint64) task->start << (quint64) task->end << (qint32) task->tid
+            << QString::fromStdString(NameTable::instance().resolve(task->comm));
+    }
+}
 
+static void readTask(QDataStream &in, boost::optional<Task> &task)
+{
+    bool hasTask;
+    in >> hasTask;
+    if (hasTask) {
+        quint64 start, end;
+        qint32 tid;
+        QString comm;
+        in >> start >> end >> tid >> comm;
+        task = Task();
+        task->start = start;
+        task->end = end;
+        task->tid = tid;
+        task->comm = NameTable::instance().intern(comm.toStdString());
+    } else {
+        task = boost::none;
+    }
+}
+
+QDataStream &operator<<(QDataStream &out, const CpuContext &context)
+{
+    out << (quint64) context.start << (quint64) context.end << (quint64) context.seriesWidth;
+
+    out << (quint32) context.cpus.size();
+    for (const Cpu &cpu : context.cpus) {
+        out << (quint32) cpu.id << (quint64) cpu.cpu_ns;
+        writeTask(out, cpu.currentTask);
+        writeTask(out, cpu.unknownTask);
+        out << cpu.busy;
+    }
+
+    out << (quint32) context.tids.size();
+    context.tids.forEach([&](int, const Process &p) {
+        out << (qint32) p.pid << (qint32) p.tid << (quint64) p.cpu_ns
+            << QString::fromStdString(NameTable::instance().resolve(p.comm));
+    });
+    out << context.sketch;
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, CpuContext &context)
+{
+    quint64 start, end, seriesWidth;
+    in >> start >> end >> seriesWidth;
+    context.start = start;
+    context.end = end;
+    context.seriesWidth = seriesWidth;
+
+    quint32 numCpus;
+    in >> numCpus;
+    context.cpus.clear();
+    context.cpuIndices.clear();
+    for (quint32 i = 0; i < numCpus && in.status() == QDataStream::Ok; i++) {
+        quint32 id;
+        quint64 cpuNs;
+        in >> id >> cpuNs;
+        Cpu &cpu = context.getCpu(id);
+        cpu.cpu_ns = cpuNs;
+        readTask(in, cpu.currentTask);
+        readTask(in, cpu.unknownTask);
+        in >> cpu.busy;
+    }
+
+    quint32 numTids;
+    in >> numTids;
+    context.tids.clear();
+    for (quint32 i = 0; i < numTids && in.status() == QDataStream::Ok; i++) {
+        qint32 pid, tid;
+        quint64 cpuNs;
+        QString comm;
+        in >> pid >> tid >> cpuNs >> comm;
+        Process p;
+        p.pid = pid;
+        p.tid = tid;
+        p.cpu_ns = cpuNs;
+        p.comm = NameTable::instance().intern(comm.toStdString());
+        context.tids[tid] = p;
+    }
+    in >> context.sketch;
+    return in;
+}
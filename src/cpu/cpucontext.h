@@ -21,7 +21,13 @@
 
 #include <trace/value/EventValue.hpp>
 #include <boost/optional.hpp>
-#include <QHash>
+#include <QDataStream>
+#include <vector>
+
+#include "common/flatmap.h"
+#include "common/nametable.h"
+#include "common/spacesaving.h"
+#include "common/timeseries.h"
 
 static const int UNKNOWN_TID = -1;
 
@@ -29,6 +35,7 @@ struct Task {
     uint64_t start = 0;
     uint64_t end = 0;
     int tid = UNKNOWN_TID;
+    name_id_t comm = NameTable::EMPTY;	/* only known once switched out */
 };
 
 struct Process
@@ -36,7 +43,18 @@ struct Process
     int pid = UNKNOWN_TID;
     int tid = UNKNOWN_TID;
     uint64_t cpu_ns = 0;
-    std::string comm = "";
+    name_id_t comm = NameTable::EMPTY;
+};
+
+/*
+ * Fields of a sched_switch event, as handed to the batch handler.
+ */
+struct SchedSwitchRecord {
+    uint64_t timestamp;
+    int32_t cpu;
+    int32_t prevTid;
+    int32_t nextTid;
+    name_id_t prevComm;
 };
 
 struct Cpu
@@ -45,6 +63,7 @@ struct Cpu
     boost::optional<Task> currentTask;
     boost::optional<Task> unknownTask;
     uint64_t cpu_ns = 0;
+    TimeSeries<quint64> busy;	/* busy time of each time bucket, if enabled */
     Cpu(int id) : id(id) {}
 };
 
@@ -53,6 +72,8 @@ class CpuContext
 public:
     CpuContext();
     void handleSchedSwitch(const tibee::trace::EventValue &event);
+    void handleSchedSwitch(uint64_t timestamp, int cpu, int prev_pid, int next_pid, name_id_t prev_comm);
+    void handleSchedSwitches(const SchedSwitchRecord *records, size_t count);
     void handleEnd();
 
     void merge(const CpuContext &other);
@@ -63,19 +84,48 @@ public:
     uint64_t getEnd() const;
     void setEnd(const uint64_t &value);
 
+    /*!
+     * \brief Width of the time buckets of the per-CPU busy time, or 0 to
+     * only compute the totals.
+     */
+    uint64_t getSeriesWidth() const;
+    void setSeriesWidth(uint64_t value);
+
     const std::vector<Cpu> &getCpus() const;
 
-    const std::list<Process> &getTids() const;
+    /*!
+     * \brief Number of counters of the sketch ranking the processes by CPU
+     * time, or 0 to keep the exact time of every process.
+     */
+    void setSketchCapacity(size_t value);
+
+    /*!
+     * \brief Get the processes with the most CPU time, most first. With a
+     * sketch, the times are lower bounds.
+     */
+    std::vector<Process> getTopTids(size_t count) const;
+
+    /*!
+     * \brief Get the bound on how much the CPU time of a process returned
+     * by getTopTids() is below the real one, 0 if exact.
+     */
+    uint64_t getTopTidsError() const;
+
+    // Serialization of the map results, for the result cache
+    friend QDataStream &operator<<(QDataStream &out, const CpuContext &context);
+    friend QDataStream &operator>>(QDataStream &in, CpuContext &context);
 
 private:
     Cpu& getCpu(unsigned int cpu);
 
 private:
     std::vector<Cpu> cpus;
-    QHash<int, Process> tids;
-    std::list<Process> sortedTids;
+    std::vector<int> cpuIndices; // Position in cpus of each CPU id, or -1
+    FlatMap<Process> tids;
+    SpaceSaving sketch;		/* replaces tids when enabled */
     uint64_t start = 0;
     uint64_t end = 0;
+    uint64_t seriesWidth = 0;
 };
 
 #endif // CPUCONTEXT_H
@@ -0,0 +1,809 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ctfmetadata.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+enum class TokenKind { IDENT, NUMBER, STRING, PUNCT, END };
+
+struct Token {
+    TokenKind kind;
+    std::string text;
+    int line;
+};
+
+/*
+ * Split TSDL text in tokens, without the comments.
+ */
+std::vector<Token> tokenize(const std::string &text)
+{
+    std::vector<Token> tokens;
+    int line = 1;
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (c == '\n') {
+            line++;
+            i++;
+        } else if (isspace((unsigned char) c)) {
+            i++;
+        } else if (text.compare(i, 2, "/*") == 0) {
+            size_t end = text.find("*/", i + 2);
+            end = end == std::string::npos ? text.size() : end + 2;
+            for (size_t j = i; j < end; j++) {
+                line += text[j] == '\n';
+            }
+            i = end;
+        } else if (text.compare(i, 2, "//") == 0) {
+            size_t end = text.find('\n', i);
+            i = end == std::string::npos ? text.size() : end;
+        } else if (isalpha((unsigned char) c) || c == '_') {
+            size_t start = i;
+            while (i < text.size() && (isalnum((unsigned char) text[i]) || text[i] == '_')) {
+                i++;
+            }
+            tokens.push_back({TokenKind::IDENT, text.substr(start, i - start), line});
+        } else if (isdigit((unsigned char) c)) {
+            size_t start = i;
+            while (i < text.size() && isalnum((unsigned char) text[i])) {
+                i++;
+            }
+            tokens.push_back({TokenKind::NUMBER, text.substr(start, i - start), line});
+        } else if (c == '"') {
+            size_t start = ++i;
+            while (i < text.size() && text[i] != '"') {
+                i += text[i] == '\\' ? 2 : 1;
+            }
+            tokens.push_back({TokenKind::STRING, text.substr(start, i - start), line});
+            i++;
+        } else if (text.compare(i, 2, ":=") == 0) {
+            tokens.push_back({TokenKind::PUNCT, ":=", line});
+            i += 2;
+        } else if (text.compare(i, 3, "...") == 0) {
+            tokens.push_back({TokenKind::PUNCT, "...", line});
+            i += 3;
+        } else {
+            tokens.push_back({TokenKind::PUNCT, std::string(1, c), line});
+            i++;
+        }
+    }
+    tokens.push_back({TokenKind::END, "", line});
+    return tokens;
+}
+
+uint64_t alignUp(uint64_t pos, unsigned int align)
+{
+    if (align <= 1) {
+        return pos;
+    }
+    return (pos + align - 1) / align * align;
+}
+
+/*
+ * Size of a struct, or of an array of elements, when none of its
+ * members have a variable size.
+ */
+int64_t getFixedSize(const std::vector<CtfField> &fields)
+{
+    uint64_t size = 0;
+    for (const CtfField &field : fields) {
+        if (field.type->fixedSize < 0) {
+            return -1;
+        }
+        size = alignUp(size, field.type->align) + field.type->fixedSize;
+    }
+    return size;
+}
+
+bool isTypeKeyword(const std::string &word)
+{
+    return word == "integer" || word == "floating_point" || word == "string" ||
+            word == "struct" || word == "variant" || word == "enum";
+}
+
+/*
+ * Recursive descent parser of the TSDL subset written by LTTng.
+ */
+class TsdlParser
+{
+public:
+    TsdlParser(const std::string &text) : tokens(tokenize(text))
+    {
+    }
+
+    bool parse(bool &bigEndian, TraceClock &clock, std::shared_ptr<const CtfType> &packetHeader,
+               std::vector<CtfStreamClass> &streamClasses);
+
+private:
+    typedef std::shared_ptr<CtfType> TypePtr;
+
+    const Token &peek(int ahead = 0) const
+    {
+        size_t i = std::min(pos + ahead, tokens.size() - 1);
+        return tokens[i];
+    }
+    const Token &next()
+    {
+        const Token &token = peek();
+        if (pos < tokens.size() - 1) {
+            pos++;
+        }
+        return token;
+    }
+    bool isNext(const char *text, int ahead = 0) const
+    {
+        const Token &token = peek(ahead);
+        return token.kind != TokenKind::STRING && token.text == text;
+    }
+    bool accept(const char *text)
+    {
+        if (isNext(text)) {
+            next();
+            return true;
+        }
+        return false;
+    }
+    bool expect(const char *text)
+    {
+        if (!accept(text)) {
+            return fail(std::string("expected '") + text + "' but got '" + peek().text + "'");
+        }
+        return true;
+    }
+    bool fail(const std::string &message)
+    {
+        if (error.empty()) {
+            error = "line " + std::to_string(peek().line) + ": " + message;
+        }
+        return false;
+    }
+
+    bool parseNumber(int64_t &value);
+    bool parseValue(std::string &value);
+    std::string parseDottedName();
+    TypePtr parseTypeSpecifier();
+    TypePtr parseIntegerOrFloat(bool isFloat);
+    TypePtr parseString();
+    TypePtr parseStruct();
+    TypePtr parseVariant();
+    TypePtr parseEnum();
+    TypePtr lookupAlias(const std::string &name);
+    bool parseFields(std::vector<CtfField> &fields);
+    bool parseTypeAlias();
+    bool parseBlock(const std::string &kind, bool &bigEndian, TraceClock &clock,
+                    std::shared_ptr<const CtfType> &packetHeader, std::vector<CtfStreamClass> &streamClasses);
+
+    std::vector<Token> tokens;
+    size_t pos = 0;
+    std::string error;
+    std::unordered_map<std::string, TypePtr> aliases;
+    std::unordered_map<std::string, TypePtr> structs;
+    std::unordered_map<std::string, TypePtr> variants;
+    std::unordered_map<std::string, TypePtr> enums;
+};
+
+bool TsdlParser::parseNumber(int64_t &value)
+{
+    bool negative = accept("-");
+    const Token &token = next();
+    if (token.kind != TokenKind::NUMBER) {
+        return fail("expected a number but got '" + token.text + "'");
+    }
+    uint64_t magnitude = strtoull(token.text.c_str(), nullptr, 0);
+    value = negative ? -(int64_t) magnitude : (int64_t) magnitude;
+    return true;
+}
+
+/*
+ * Read the value of an attribute, up to the ';'.
+ */
+bool TsdlParser::parseValue(std::string &value)
+{
+    value.clear();
+    while (!isNext(";") && peek().kind != TokenKind::END) {
+        value += next().text;
+    }
+    return expect(";");
+}
+
+std::string TsdlParser::parseDottedName()
+{
+    std::string name = next().text;
+    while (isNext(".") && peek(1).kind == TokenKind::IDENT) {
+        next();
+        name += "." + next().text;
+    }
+    return name;
+}
+
+TsdlParser::TypePtr TsdlParser::lookupAlias(const std::string &name)
+{
+    auto iter = aliases.find(name);
+    if (iter == aliases.end()) {
+        fail("unknown type '" + name + "'");
+        return nullptr;
+    }
+    return iter->second;
+}
+
+TsdlParser::TypePtr TsdlParser::parseTypeSpecifier()
+{
+    const Token &token = peek();
+    if (token.text == "integer") {
+        next();
+        return parseIntegerOrFloat(false);
+    } else if (token.text == "floating_point") {
+        next();
+        return parseIntegerOrFloat(true);
+    } else if (token.text == "string") {
+        next();
+        return parseString();
+    } else if (token.text == "struct") {
+        next();
+        return parseStruct();
+    } else if (token.text == "variant") {
+        next();
+        return parseVariant();
+    } else if (token.text == "enum") {
+        next();
+        return parseEnum();
+    }
+    fail("expected a type but got '" + token.text + "'");
+    return nullptr;
+}
+
+TsdlParser::TypePtr TsdlParser::parseIntegerOrFloat(bool isFloat)
+{
+    TypePtr type = std::make_shared<CtfType>();
+    type->kind = isFloat ? CtfTypeKind::FLOAT : CtfTypeKind::INTEGER;
+    if (!expect("{")) {
+        return nullptr;
+    }
+    bool hasAlign = false;
+    unsigned int expDig = 0;
+    unsigned int mantDig = 0;
+    while (!accept("}")) {
+        std::string name = next().text;
+        std::string value;
+        if (!expect("=") || !parseValue(value)) {
+            return nullptr;
+        }
+        if (name == "size") {
+            type->size = strtoul(value.c_str(), nullptr, 0);
+        } else if (name == "align") {
+            type->align = strtoul(value.c_str(), nullptr, 0);
+            hasAlign = true;
+        } else if (name == "signed") {
+            type->isSigned = value == "true" || value == "TRUE" || value == "1";
+        } else if (name == "byte_order") {
+            if (value == "be" || value == "network") {
+                type->byteOrder = CtfByteOrder::BIG;
+            } else if (value == "le") {
+                type->byteOrder = CtfByteOrder::LITTLE;
+            }
+        } else if (name == "encoding") {
+            type->isText = value == "UTF8" || value == "ASCII" || value == "utf8" || value == "ascii";
+        } else if (name == "map") {
+            type->mapsClock = value.compare(0, 6, "clock.") == 0;
+        } else if (name == "exp_dig") {
+            expDig = strtoul(value.c_str(), nullptr, 0);
+        } else if (name == "mant_dig") {
+            mantDig = strtoul(value.c_str(), nullptr, 0);
+        }
+        if (peek().kind == TokenKind::END) {
+            fail("unterminated integer");
+            return nullptr;
+        }
+    }
+    if (isFloat) {
+        type->size = expDig + mantDig;
+    }
+    if (!hasAlign) {
+        type->align = type->size % 8 == 0 ? 8 : 1;
+    }
+    if (type->size == 0 || type->size > 64) {
+        fail("unsupported integer size " + std::to_string(type->size));
+        return nullptr;
+    }
+    type->fixedSize = type->size;
+    return type;
+}
+
+TsdlParser::TypePtr TsdlParser::parseString()
+{
+    TypePtr type = std::make_shared<CtfType>();
+    type->kind = CtfTypeKind::STRING;
+    type->align = 8;
+    if (accept("{")) {
+        while (!accept("}")) {
+            if (peek().kind == TokenKind::END) {
+                fail("unterminated string");
+                return nullptr;
+            }
+            next();
+        }
+    }
+    return type;
+}
+
+TsdlParser::TypePtr TsdlParser::parseStruct()
+{
+    std::string name;
+    if (peek().kind == TokenKind::IDENT && !isNext("align")) {
+        name = next().text;
+    }
+    TypePtr type;
+    if (accept("{")) {
+        type = std::make_shared<CtfType>();
+        type->kind = CtfTypeKind::STRUCT;
+        type->align = 1;
+        if (!parseFields(type->fields)) {
+            return nullptr;
+        }
+        for (const CtfField &field : type->fields) {
+            type->align = std::max(type->align, field.type->align);
+        }
+        type->fixedSize = getFixedSize(type->fields);
+        if (!name.empty()) {
+            structs[name] = type;
+        }
+    } else {
+        auto iter = structs.find(name);
+        if (iter == structs.end()) {
+            fail("unknown struct '" + name + "'");
+            return nullptr;
+        }
+        type = iter->second;
+    }
+    if (accept("align")) {
+        int64_t align;
+        if (!expect("(") || !parseNumber(align) || !expect(")")) {
+            return nullptr;
+        }
+        // The alignment of a struct is given in bits
+        if (type->align < align) {
+            TypePtr aligned = std::make_shared<CtfType>(*type);
+            aligned->align = align;
+            type = aligned;
+            if (!name.empty()) {
+                structs[name] = type;
+            }
+        }
+    }
+    return type;
+}
+
+TsdlParser::TypePtr TsdlParser::parseVariant()
+{
+    std::string name;
+    if (peek().kind == TokenKind::IDENT) {
+        name = next().text;
+    }
+    std::string tag;
+    if (accept("<")) {
+        tag = parseDottedName();
+        size_t dot = tag.rfind('.');
+        if (dot != std::string::npos) {
+            tag = tag.substr(dot + 1);
+        }
+        if (!expect(">")) {
+            return nullptr;
+        }
+    }
+    TypePtr type;
+    if (accept("{")) {
+        type = std::make_shared<CtfType>();
+        type->kind = CtfTypeKind::VARIANT;
+        type->align = 1;
+        if (!parseFields(type->fields)) {
+            return nullptr;
+        }
+        if (!name.empty()) {
+            variants[name] = type;
+        }
+    } else {
+        auto iter = variants.find(name);
+        if (iter == variants.end()) {
+            fail("unknown variant '" + name + "'");
+            return nullptr;
+        }
+        type = std::make_shared<CtfType>(*iter->second);
+    }
+    if (!tag.empty()) {
+        type->tagName = tag;
+    }
+    return type;
+}
+
+TsdlParser::TypePtr TsdlParser::parseEnum()
+{
+    std::string name;
+    if (peek().kind == TokenKind::IDENT && !isNext(":")) {
+        name = next().text;
+    }
+    TypePtr container;
+    if (accept(":")) {
+        if (isTypeKeyword(peek().text)) {
+            container = parseTypeSpecifier();
+        } else {
+            std::string aliasName;
+            while (peek().kind == TokenKind::IDENT) {
+                aliasName += (aliasName.empty() ? "" : " ") + next().text;
+            }
+            container = lookupAlias(aliasName);
+        }
+    } else if (!isNext("{")) {
+        auto iter = enums.find(name);
+        if (iter == enums.end()) {
+            fail("unknown enum '" + name + "'");
+            return nullptr;
+        }
+        return iter->second;
+    } else {
+        container = lookupAlias("int");
+    }
+    if (!container || !expect("{")) {
+        return nullptr;
+    }
+
+    TypePtr type = std::make_shared<CtfType>(*container);
+    type->kind = CtfTypeKind::ENUM;
+    int64_t nextValue = 0;
+    while (!accept("}")) {
+        CtfEnumMapping mapping;
+        const Token &label = next();
+        if (label.kind != TokenKind::IDENT && label.kind != TokenKind::STRING) {
+            fail("expected an enumerator but got '" + label.text + "'");
+            return nullptr;
+        }
+        mapping.label = label.text;
+        mapping.low = nextValue;
+        mapping.high = nextValue;
+        if (accept("=")) {
+            if (!parseNumber(mapping.low)) {
+                return nullptr;
+            }
+            mapping.high = mapping.low;
+            if (accept("...") && !parseNumber(mapping.high)) {
+                return nullptr;
+            }
+        }
+        nextValue = mapping.high + 1;
+        type->mappings.push_back(mapping);
+        if (!accept(",") && !isNext("}")) {
+            fail("expected ',' but got '" + peek().text + "'");
+            return nullptr;
+        }
+    }
+    if (!name.empty()) {
+        enums[name] = type;
+    }
+    return type;
+}
+
+/*
+ * Parse field declarations, up to the closing brace.
+ */
+bool TsdlParser::parseFields(std::vector<CtfField> &fields)
+{
+    while (!accept("}")) {
+        if (peek().kind == TokenKind::END) {
+            return fail("unterminated struct");
+        }
+        CtfField field;
+        TypePtr type;
+        if (isTypeKeyword(peek().text)) {
+            type = parseTypeSpecifier();
+            if (!type) {
+                return false;
+            }
+            field.name = next().text;
+        } else {
+            // Type names may have several words, the last one is the field
+            std::vector<std::string> words;
+            while (peek().kind == TokenKind::IDENT) {
+                words.push_back(next().text);
+            }
+            if (words.size() < 2) {
+                return fail("expected a field declaration");
+            }
+            field.name = words.back();
+            words.pop_back();
+            std::string aliasName;
+            for (const std::string &word : words) {
+                aliasName += (aliasName.empty() ? "" : " ") + word;
+            }
+            type = lookupAlias(aliasName);
+            if (!type) {
+                return false;
+            }
+        }
+
+        // Arrays and sequences
+        std::vector<TypePtr> dimensions;
+        while (accept("[")) {
+            TypePtr array = std::make_shared<CtfType>();
+            if (peek().kind == TokenKind::NUMBER) {
+                int64_t length;
+                if (!parseNumber(length)) {
+                    return false;
+                }
+                array->kind = CtfTypeKind::ARRAY;
+                array->length = length;
+            } else {
+                std::string lengthName = parseDottedName();
+                size_t dot = lengthName.rfind('.');
+                array->kind = CtfTypeKind::SEQUENCE;
+                array->lengthName = dot == std::string::npos ? lengthName : lengthName.substr(dot + 1);
+            }
+            if (!expect("]")) {
+                return false;
+            }
+            dimensions.push_back(array);
+        }
+        for (auto iter = dimensions.rbegin(); iter != dimensions.rend(); ++iter) {
+            (*iter)->element = type;
+            (*iter)->align = type->align;
+            if ((*iter)->kind == CtfTypeKind::ARRAY && type->fixedSize >= 0) {
+                uint64_t stride = alignUp(type->fixedSize, type->align);
+                (*iter)->fixedSize = (*iter)->length == 0 ? 0 : stride * ((*iter)->length - 1) + type->fixedSize;
+            }
+            type = *iter;
+        }
+
+        field.type = type;
+        fields.push_back(field);
+        if (!expect(";")) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TsdlParser::parseTypeAlias()
+{
+    TypePtr type;
+    if (isTypeKeyword(peek().text)) {
+        type = parseTypeSpecifier();
+    } else {
+        std::string aliasName;
+        while (peek().kind == TokenKind::IDENT) {
+            aliasName += (aliasName.empty() ? "" : " ") + next().text;
+        }
+        type = lookupAlias(aliasName);
+    }
+    if (!type || !expect(":=")) {
+        return false;
+    }
+    std::string name;
+    while (!isNext(";") && peek().kind != TokenKind::END) {
+        const Token &token = next();
+        if (token.kind == TokenKind::IDENT) {
+            name += (name.empty() ? "" : " ") + token.text;
+        }
+    }
+    aliases[name] = type;
+    return expect(";");
+}
+
+bool TsdlParser::parseBlock(const std::string &kind, bool &bigEndian, TraceClock &clock,
+                            std::shared_ptr<const CtfType> &packetHeader,
+                            std::vector<CtfStreamClass> &streamClasses)
+{
+    CtfStreamClass streamClass;
+    CtfEventClass eventClass;
+    int64_t streamId = 0;
+    if (!expect("{")) {
+        return false;
+    }
+    while (!accept("}")) {
+        if (peek().kind == TokenKind::END) {
+            return fail("unterminated " + kind + " block");
+        }
+        if (isNext("typealias")) {
+            next();
+            if (!parseTypeAlias()) {
+                return false;
+            }
+            continue;
+        }
+        std::string name = parseDottedName();
+        if (accept(":=")) {
+            TypePtr type = parseTypeSpecifier();
+            if (!type || !expect(";")) {
+                return false;
+            }
+            if (kind == "trace" && name == "packet.header") {
+                packetHeader = type;
+            } else if (kind == "stream" && name == "packet.context") {
+                streamClass.packetContext = type;
+            } else if (kind == "stream" && name == "event.header") {
+                streamClass.eventHeader = type;
+            } else if (kind == "stream" && name == "event.context") {
+                streamClass.eventContext = type;
+            } else if (kind == "event" && name == "context") {
+                eventClass.context = type;
+            } else if (kind == "event" && name == "fields") {
+                eventClass.fields = type;
+            }
+            continue;
+        }
+        std::string value;
+        if (!expect("=") || !parseValue(value)) {
+            return false;
+        }
+        if (kind == "trace" && name == "byte_order") {
+            bigEndian = value == "be" || value == "network";
+        } else if (kind == "clock" && name == "freq") {
+            clock.freq = strtoull(value.c_str(), nullptr, 0);
+        } else if (kind == "clock" && name == "offset_s") {
+            clock.offsetSeconds = strtoll(value.c_str(), nullptr, 0);
+        } else if (kind == "clock" && name == "offset") {
+            clock.offset = strtoll(value.c_str(), nullptr, 0);
+        } else if (kind == "stream" && name == "id") {
+            streamClass.id = strtoll(value.c_str(), nullptr, 0);
+        } else if (kind == "event" && name == "name") {
+            eventClass.name = value;
+        } else if (kind == "event" && name == "id") {
+            eventClass.id = strtoll(value.c_str(), nullptr, 0);
+        } else if (kind == "event" && name == "stream_id") {
+            streamId = strtoll(value.c_str(), nullptr, 0);
+        }
+    }
+    accept(";");
+
+    if (kind == "stream") {
+        if (streamClass.id < 0 || streamClass.id > 0xffff) {
+            return fail("unsupported stream id");
+        }
+        if ((size_t) streamClass.id >= streamClasses.size()) {
+            streamClasses.resize(streamClass.id + 1);
+        }
+        std::vector<CtfEventClass> events = std::move(streamClasses[streamClass.id].events);
+        streamClasses[streamClass.id] = streamClass;
+        streamClasses[streamClass.id].events = std::move(events);
+    } else if (kind == "event") {
+        if (eventClass.id < 0 || eventClass.id > 0xffffff || streamId < 0 || streamId > 0xffff) {
+            return fail("unsupported event id");
+        }
+        if ((size_t) streamId >= streamClasses.size()) {
+            streamClasses.resize(streamId + 1);
+        }
+        std::vector<CtfEventClass> &events = streamClasses[streamId].events;
+        if ((size_t) eventClass.id >= events.size()) {
+            events.resize(eventClass.id + 1);
+        }
+        events[eventClass.id] = eventClass;
+    }
+    return true;
+}
+
+bool TsdlParser::parse(bool &bigEndian, TraceClock &clock, std::shared_ptr<const CtfType> &packetHeader,
+                       std::vector<CtfStreamClass> &streamClasses)
+{
+    while (peek().kind != TokenKind::END) {
+        const Token &token = peek();
+        if (token.text == "typealias") {
+            next();
+            if (!parseTypeAlias()) {
+                break;
+            }
+        } else if (token.text == "trace" || token.text == "env" || token.text == "clock" ||
+                   token.text == "stream" || token.text == "event" || token.text == "callsite") {
+            std::string kind = next().text;
+            if (!parseBlock(kind, bigEndian, clock, packetHeader, streamClasses)) {
+                break;
+            }
+        } else if (isTypeKeyword(token.text)) {
+            if (!parseTypeSpecifier() || !expect(";")) {
+                break;
+            }
+        } else {
+            fail("unexpected '" + token.text + "'");
+            break;
+        }
+    }
+    if (!error.empty()) {
+        std::cerr << "Error: metadata " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int CtfType::getFieldIndex(const std::string &name) const
+{
+    for (unsigned int i = 0; i < fields.size(); i++) {
+        const std::string &fieldName = fields[i].name;
+        if (fieldName == name || (fieldName.size() == name.size() + 1 && fieldName[0] == '_' &&
+                                  fieldName.compare(1, std::string::npos, name) == 0)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const std::string *CtfType::getLabel(int64_t value) const
+{
+    for (const CtfEnumMapping &mapping : mappings) {
+        if (value >= mapping.low && value <= mapping.high) {
+            return &mapping.label;
+        }
+    }
+    return nullptr;
+}
+
+bool CtfMetadata::parse(const std::string &text)
+{
+    TsdlParser parser(text);
+    if (!parser.parse(bigEndian, clock, packetHeader, streamClasses)) {
+        return false;
+    }
+    numEventClasses = 0;
+    for (CtfStreamClass &streamClass : streamClasses) {
+        if (!streamClass.events.empty() && !streamClass.eventHeader) {
+            std::cerr << "Error: metadata stream " << streamClass.id << " has no event header" << std::endl;
+            return false;
+        }
+        // Event ids are reused by each stream class
+        for (CtfEventClass &eventClass : streamClass.events) {
+            eventClass.streamId = &streamClass - streamClasses.data();
+            eventClass.index = numEventClasses++;
+        }
+    }
+    return true;
+}
+
+bool CtfMetadata::isBigEndian() const
+{
+    return bigEndian;
+}
+
+const TraceClock &CtfMetadata::getClock() const
+{
+    return clock;
+}
+
+const std::shared_ptr<const CtfType> &CtfMetadata::getPacketHeader() const
+{
+    return packetHeader;
+}
+
+const CtfStreamClass *CtfMetadata::getStreamClass(int64_t id) const
+{
+    if (id < 0 || (size_t) id >= streamClasses.size()) {
+        return nullptr;
+    }
+    return &streamClasses[id];
+}
+
+const std::vector<CtfStreamClass> &CtfMetadata::getStreamClasses() const
+{
+    return streamClasses;
+}
+
+size_t CtfMetadata::getNumEventClasses() const
+{
+    return numEventClasses;
+}
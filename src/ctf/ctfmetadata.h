@@ -0,0 +1,144 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CTFMETADATA_H
+#define CTFMETADATA_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/tracemetadata.h"
+
+enum class CtfTypeKind { INTEGER, FLOAT, ENUM, STRING, STRUCT, VARIANT, ARRAY, SEQUENCE };
+enum class CtfByteOrder { NATIVE, LITTLE, BIG };
+
+struct CtfType;
+
+struct CtfField {
+    std::string name;
+    std::shared_ptr<const CtfType> type;
+};
+
+/*
+ * Label of an enumeration, for the values from low to high.
+ */
+struct CtfEnumMapping {
+    std::string label;
+    int64_t low;
+    int64_t high;
+};
+
+/*
+ * A type declared in the metadata. Integers, floats and enums are read
+ * in place; the other kinds are walked to find the position of their
+ * fields.
+ */
+struct CtfType {
+    CtfTypeKind kind = CtfTypeKind::INTEGER;
+    unsigned int size = 0;		/* in bits, integer, float and enum */
+    unsigned int align = 8;		/* in bits */
+    bool isSigned = false;
+    bool isText = false;		/* integer encoded as UTF8 or ASCII */
+    bool mapsClock = false;		/* integer mapped to the clock */
+    CtfByteOrder byteOrder = CtfByteOrder::NATIVE;
+    std::vector<CtfField> fields;	/* struct fields and variant options */
+    std::vector<CtfEnumMapping> mappings;
+    std::shared_ptr<const CtfType> element;	/* array and sequence element */
+    uint64_t length = 0;		/* array length */
+    std::string lengthName;		/* sequence length field */
+    std::string tagName;		/* variant tag field */
+    int64_t fixedSize = -1;		/* in bits, or -1 if the size depends on the data */
+
+    /*!
+     * \brief Find a struct field or variant option.
+     * \return Its position, or -1. A leading underscore, added to field
+     * names by LTTng, is ignored.
+     */
+    int getFieldIndex(const std::string &name) const;
+
+    /*!
+     * \brief Get the label of an enumeration value, or nullptr.
+     */
+    const std::string *getLabel(int64_t value) const;
+};
+
+struct CtfEventClass {
+    std::string name;
+    int64_t id = -1;		/* only unique within its stream class */
+    int64_t streamId = 0;
+    size_t index = 0;		/* unique among the event classes of all the streams */
+    std::shared_ptr<const CtfType> context;	/* may be null */
+    std::shared_ptr<const CtfType> fields;	/* may be null */
+};
+
+struct CtfStreamClass {
+    int64_t id = 0;
+    std::shared_ptr<const CtfType> packetContext;
+    std::shared_ptr<const CtfType> eventHeader;
+    std::shared_ptr<const CtfType> eventContext;
+    std::vector<CtfEventClass> events;	/* indexed by event id, unused ids have an empty name */
+};
+
+/*!
+ * \brief The CtfMetadata class is a parser for the subset of TSDL used by
+ * the LTTng tracers: type aliases, integers, floats, strings, enums,
+ * structs, variants, arrays and sequences, and the trace, clock, stream
+ * and event blocks.
+ */
+class CtfMetadata
+{
+public:
+    /*!
+     * \brief Parse the metadata of a trace.
+     * \return false, after printing the error, if the metadata can't be parsed.
+     */
+    bool parse(const std::string &text);
+
+    bool isBigEndian() const;
+    const TraceClock &getClock() const;
+    const std::shared_ptr<const CtfType> &getPacketHeader() const;
+
+    /*!
+     * \brief Get a stream class, or nullptr if there is no such stream.
+     */
+    const CtfStreamClass *getStreamClass(int64_t id) const;
+
+    /*!
+     * \brief Get the stream classes, indexed by stream id. Unused ids
+     * have no events.
+     */
+    const std::vector<CtfStreamClass> &getStreamClasses() const;
+
+    /*!
+     * \brief Get the number of event classes of all the streams, i.e. the
+     * highest CtfEventClass::index plus one.
+     */
+    size_t getNumEventClasses() const;
+
+private:
+    bool bigEndian = false;
+    TraceClock clock;
+    std::shared_ptr<const CtfType> packetHeader;
+    std::vector<CtfStreamClass> streamClasses;
+    size_t numEventClasses = 0;
+};
+
+#endif // CTFMETADATA_H
@@ -0,0 +1,1119 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ctftrace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <endian.h>
+
+#include <QDir>
+
+static uint64_t alignUp(uint64_t pos, unsigned int align)
+{
+    if (align <= 1) {
+        return pos;
+    }
+    return (pos + align - 1) / align * align;
+}
+
+/*
+ * Read an integer of up to 64 bits at any bit position.
+ */
+static uint64_t readBits(const uint8_t *data, uint64_t pos, unsigned int size, bool bigEndian)
+{
+    const uint8_t *bytes = data + pos / 8;
+    unsigned int shift = pos % 8;
+
+    // Byte aligned integers, which is most of them
+    if (shift == 0) {
+        switch (size) {
+        case 8:
+            return bytes[0];
+        case 16:
+        {
+            uint16_t value;
+            memcpy(&value, bytes, sizeof(value));
+            return bigEndian ? be16toh(value) : le16toh(value);
+        }
+        case 32:
+        {
+            uint32_t value;
+            memcpy(&value, bytes, sizeof(value));
+            return bigEndian ? be32toh(value) : le32toh(value);
+        }
+        case 64:
+        {
+            uint64_t value;
+            memcpy(&value, bytes, sizeof(value));
+            return bigEndian ? be64toh(value) : le64toh(value);
+        }
+        }
+    }
+
+    // Bit fields span at most 9 bytes
+    unsigned int numBytes = (shift + size + 7) / 8;
+    unsigned __int128 acc = 0;
+    if (bigEndian) {
+        for (unsigned int i = 0; i < numBytes; i++) {
+            acc = (acc << 8) | bytes[i];
+        }
+        acc >>= numBytes * 8 - shift - size;
+    } else {
+        for (unsigned int i = numBytes; i > 0; i--) {
+            acc = (acc << 8) | bytes[i - 1];
+        }
+        acc >>= shift;
+    }
+    uint64_t mask = size == 64 ? ~0ULL : (1ULL << size) - 1;
+    return (uint64_t) acc & mask;
+}
+
+static bool matchesName(const std::string &fieldName, const char *name)
+{
+    const char *field = fieldName.c_str();
+    if (field[0] == '_' && strcmp(field + 1, name) == 0) {
+        return true;
+    }
+    return strcmp(field, name) == 0;
+}
+
+static const CtfValue *findValue(const std::vector<CtfValue> &values, const char *name)
+{
+    for (auto iter = values.rbegin(); iter != values.rend(); ++iter) {
+        if (iter->name && matchesName(*iter->name, name)) {
+            return &*iter;
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * Whether a struct or variant has a field with this name, at any depth.
+ */
+static bool containsField(const CtfType &type, const std::string &name)
+{
+    if (type.getFieldIndex(name) >= 0) {
+        return true;
+    }
+    for (const CtfField &field : type.fields) {
+        if (containsField(*field.type, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Number of values a type is decoded to, or -1 if it depends on the data.
+ */
+static int countValues(const CtfType &type)
+{
+    switch (type.kind) {
+    case CtfTypeKind::STRUCT:
+    {
+        int count = 0;
+        for (const CtfField &field : type.fields) {
+            int fieldCount = countValues(*field.type);
+            if (fieldCount < 0) {
+                return -1;
+            }
+            count += fieldCount;
+        }
+        return count;
+    }
+    case CtfTypeKind::VARIANT:
+        return -1;
+    default:
+        return 1;
+    }
+}
+
+static const CtfType *findFieldType(const CtfType &type, const std::string &name)
+{
+    int index = type.getFieldIndex(name);
+    if (index >= 0) {
+        return type.fields[index].type.get();
+    }
+    for (const CtfField &field : type.fields) {
+        const CtfType *fieldType = findFieldType(*field.type, name);
+        if (fieldType) {
+            return fieldType;
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * Recognize the event headers written by LTTng, so that they are read
+ * without going through the generic decoder.
+ */
+static bool getHeaderLayout(const CtfType &header, CtfHeaderLayout &layout)
+{
+    if (header.kind != CtfTypeKind::STRUCT || header.fields.size() != 2) {
+        return false;
+    }
+    const CtfType &id = *header.fields[0].type;
+    const CtfType &variant = *header.fields[1].type;
+    if (id.kind != CtfTypeKind::ENUM || variant.kind != CtfTypeKind::VARIANT ||
+            variant.tagName != header.fields[0].name) {
+        return false;
+    }
+    int compact = variant.getFieldIndex("compact");
+    int extended = variant.getFieldIndex("extended");
+    if (compact < 0 || extended < 0) {
+        return false;
+    }
+    const CtfType &compactType = *variant.fields[compact].type;
+    const CtfType &extendedType = *variant.fields[extended].type;
+    if (compactType.kind != CtfTypeKind::STRUCT || compactType.fields.size() != 1 ||
+            extendedType.kind != CtfTypeKind::STRUCT || extendedType.fields.size() != 2 ||
+            extendedType.getFieldIndex("id") != 0 || extendedType.getFieldIndex("timestamp") != 1 ||
+            compactType.getFieldIndex("timestamp") != 0) {
+        return false;
+    }
+    const CtfType *types[] = {compactType.fields[0].type.get(), extendedType.fields[0].type.get(),
+                              extendedType.fields[1].type.get()};
+    for (const CtfType *type : types) {
+        if (type->kind != CtfTypeKind::INTEGER || type->size > 64) {
+            return false;
+        }
+    }
+
+    // The variant option is picked by label, find the value of "extended"
+    bool hasMarker = false;
+    for (const CtfEnumMapping &mapping : id.mappings) {
+        if (mapping.label == "extended" && mapping.low == mapping.high) {
+            layout.extendedMarker = mapping.low;
+            hasMarker = true;
+        } else if (mapping.label != "compact") {
+            return false;
+        }
+    }
+    if (!hasMarker) {
+        return false;
+    }
+
+    layout.header = &header;
+    layout.id = &id;
+    layout.variant = &variant;
+    layout.compact = &compactType;
+    layout.compactTimestamp = types[0];
+    layout.extended = &extendedType;
+    layout.extendedId = types[1];
+    layout.extendedTimestamp = types[2];
+    return true;
+}
+
+bool CtfCursor::decode(const CtfType &type, const std::string *name, std::vector<CtfValue> &values,
+                       std::vector<CtfValue> &scratch)
+{
+    pos = alignUp(pos, type.align);
+    CtfValue value;
+    value.name = name;
+    value.type = &type;
+    value.pos = pos;
+
+    switch (type.kind) {
+    case CtfTypeKind::INTEGER:
+    case CtfTypeKind::ENUM:
+    case CtfTypeKind::FLOAT:
+        if (!readInteger(type, value.raw)) {
+            return false;
+        }
+        values.push_back(value);
+        return true;
+    case CtfTypeKind::STRING:
+    {
+        uint64_t byte = pos / 8;
+        const void *nul = byte < contentEnd / 8 ? memchr(data + byte, 0, contentEnd / 8 - byte) : nullptr;
+        if (!nul) {
+            std::cerr << "Error: unterminated string in packet" << std::endl;
+            return false;
+        }
+        value.count = static_cast<const uint8_t *>(nul) - (data + byte);
+        pos += (value.count + 1) * 8;
+        values.push_back(value);
+        return true;
+    }
+    case CtfTypeKind::STRUCT:
+        for (const CtfField &field : type.fields) {
+            if (!decode(*field.type, &field.name, values, scratch)) {
+                return false;
+            }
+        }
+        return true;
+    case CtfTypeKind::VARIANT:
+    {
+        const CtfValue *tag = findValue(values, type.tagName.c_str());
+        const std::string *label = tag ? tag->type->getLabel(tag->raw) : nullptr;
+        int option = label ? type.getFieldIndex(*label) : -1;
+        if (option < 0) {
+            std::cerr << "Error: no variant option for tag " << type.tagName << std::endl;
+            return false;
+        }
+        const CtfField &field = type.fields[option];
+        return decode(*field.type, &field.name, values, scratch);
+    }
+    case CtfTypeKind::ARRAY:
+    case CtfTypeKind::SEQUENCE:
+    {
+        value.count = type.length;
+        if (type.kind == CtfTypeKind::SEQUENCE) {
+            const CtfValue *length = findValue(values, type.lengthName.c_str());
+            if (!length) {
+                length = findValue(scratch, type.lengthName.c_str());
+            }
+            if (!length) {
+                std::cerr << "Error: no length field " << type.lengthName << std::endl;
+                return false;
+            }
+            value.count = length->raw;
+        }
+
+        // Packed integers are skipped at once, anything else is walked
+        const CtfType &element = *type.element;
+        bool isPacked = (element.kind == CtfTypeKind::INTEGER || element.kind == CtfTypeKind::ENUM ||
+                         element.kind == CtfTypeKind::FLOAT) && element.size % element.align == 0;
+        if (isPacked) {
+            if (value.count > (contentEnd - pos) / element.size) {
+                std::cerr << "Error: array past the end of the packet" << std::endl;
+                return false;
+            }
+            pos += value.count * element.size;
+        } else {
+            for (uint64_t i = 0; i < value.count; i++) {
+                if (!decode(element, nullptr, scratch, scratch)) {
+                    return false;
+                }
+            }
+        }
+        values.push_back(value);
+        return true;
+    }
+    }
+    return false;
+}
+
+bool CtfCursor::skip(const CtfType &type, std::vector<CtfValue> &scratch)
+{
+    pos = alignUp(pos, type.align);
+    if (type.fixedSize < 0) {
+        return decode(type, nullptr, scratch, scratch);
+    }
+    if (pos + type.fixedSize > contentEnd) {
+        std::cerr << "Error: event past the end of the packet" << std::endl;
+        return false;
+    }
+    pos += type.fixedSize;
+    return true;
+}
+
+bool CtfCursor::readInteger(const CtfType &type, uint64_t &value)
+{
+    if (pos + type.size > contentEnd) {
+        std::cerr << "Error: integer past the end of the packet" << std::endl;
+        return false;
+    }
+    bool isBigEndian = type.byteOrder == CtfByteOrder::BIG ||
+            (type.byteOrder == CtfByteOrder::NATIVE && bigEndian);
+    value = readBits(data, pos, type.size, isBigEndian);
+    if (type.isSigned && type.size < 64 && (value >> (type.size - 1)) & 1) {
+        value |= ~((1ULL << type.size) - 1);
+    }
+    pos += type.size;
+    return true;
+}
+
+CtfProjection::CtfProjection()
+{
+}
+
+CtfProjection CtfProjection::headersOnly()
+{
+    CtfProjection projection;
+    projection.allFields = false;
+    return projection;
+}
+
+void CtfProjection::addEvent(const std::string &name, const std::vector<std::string> &fields)
+{
+    allEvents = false;
+    allFields = false;
+    std::vector<std::string> &eventFields = events[name];
+    eventFields.insert(eventFields.end(), fields.begin(), fields.end());
+}
+
+std::vector<std::vector<CtfEventPlan>> CtfProjection::resolve(const CtfMetadata &metadata) const
+{
+    // Indexed by stream id, unused ids have no events
+    const std::vector<CtfStreamClass> &streamClasses = metadata.getStreamClasses();
+    std::vector<std::vector<CtfEventPlan>> plans(streamClasses.size());
+    for (size_t streamId = 0; streamId < streamClasses.size(); streamId++) {
+        const CtfStreamClass &streamClass = streamClasses[streamId];
+        plans[streamId].resize(streamClass.events.size());
+        for (const CtfEventClass &eventClass : streamClass.events) {
+            if (eventClass.name.empty()) {
+                continue;
+            }
+            auto fields = events.find(eventClass.name);
+            if (!allEvents && fields == events.end()) {
+                continue;
+            }
+
+            CtfEventPlan &plan = plans[streamId][eventClass.id];
+            plan.wanted = true;
+            const CtfType *scopeTypes[5] = {nullptr, nullptr, streamClass.eventContext.get(),
+                                            eventClass.context.get(), eventClass.fields.get()};
+            for (int scope = 0; scope < 5; scope++) {
+                if (!scopeTypes[scope] || allFields) {
+                    plan.scopes[scope] = allFields;
+                    continue;
+                }
+                if (fields == events.end()) {
+                    continue;
+                }
+                for (const std::string &field : fields->second) {
+                    plan.scopes[scope] = plan.scopes[scope] || containsField(*scopeTypes[scope], field);
+                }
+            }
+        }
+    }
+    return plans;
+}
+
+bool CtfFieldHandle::isValid() const
+{
+    return type != nullptr;
+}
+
+int64_t CtfEvent::getId() const
+{
+    return eventClass->id;
+}
+
+const std::string &CtfEvent::getName() const
+{
+    return eventClass->name;
+}
+
+const CtfEventClass &CtfEvent::getEventClass() const
+{
+    return *eventClass;
+}
+
+uint64_t CtfEvent::getTimestamp() const
+{
+    return timestamp;
+}
+
+int CtfEvent::getCpu() const
+{
+    return cpu;
+}
+
+const std::vector<CtfValue> &CtfEvent::getValues(CtfScope scope) const
+{
+    int index = static_cast<int>(scope);
+    if (!scopeDecoded[index]) {
+        scopeDecoded[index] = true;
+        CtfCursor cursor = packet;
+        cursor.pos = scopeStarts[index];
+        if (!cursor.decode(*scopeTypes[index], nullptr, scopes[index], scratch)) {
+            scopes[index].clear();
+        }
+    }
+    return scopes[index];
+}
+
+const CtfValue *CtfEvent::getField(CtfScope scope, const char *name) const
+{
+    return findValue(getValues(scope), name);
+}
+
+int64_t CtfEvent::getInteger(CtfScope scope, const char *name, int64_t defaultValue) const
+{
+    const CtfValue *value = getField(scope, name);
+    return value ? static_cast<int64_t>(value->raw) : defaultValue;
+}
+
+uint64_t CtfEvent::getUnsigned(CtfScope scope, const char *name, uint64_t defaultValue) const
+{
+    const CtfValue *value = getField(scope, name);
+    return value ? value->raw : defaultValue;
+}
+
+bool CtfEvent::getText(const CtfValue &value, const char *&chars, size_t &length) const
+{
+    chars = reinterpret_cast<const char *>(packet.data + value.pos / 8);
+    if (value.type->kind == CtfTypeKind::STRING) {
+        length = value.count;
+        return true;
+    }
+    if ((value.type->kind == CtfTypeKind::ARRAY || value.type->kind == CtfTypeKind::SEQUENCE) &&
+            value.type->element->size == 8) {
+        length = strnlen(chars, value.count);
+        return true;
+    }
+    length = 0;
+    return false;
+}
+
+std::string CtfEvent::getString(const CtfValue &value) const
+{
+    const char *chars;
+    size_t length;
+    return getText(value, chars, length) ? std::string(chars, length) : std::string();
+}
+
+std::string CtfEvent::getString(CtfScope scope, const char *name) const
+{
+    const CtfValue *value = getField(scope, name);
+    return value ? getString(*value) : std::string();
+}
+
+bool CtfEvent::isInPlace(const CtfFieldHandle &handle) const
+{
+    return handle.offset >= 0 && scopeTypes[static_cast<int>(handle.scope)] == handle.scopeType;
+}
+
+const CtfValue *CtfEvent::findField(const CtfFieldHandle &handle) const
+{
+    int index = static_cast<int>(handle.scope);
+    if (!handle.type || !scopeTypes[index]) {
+        return nullptr;
+    }
+    const std::vector<CtfValue> &values = getValues(handle.scope);
+    if (scopeTypes[index] == handle.scopeType && handle.leaf >= 0 && (size_t) handle.leaf < values.size()) {
+        return &values[handle.leaf];
+    }
+    return findValue(values, handle.name.c_str());
+}
+
+bool CtfEvent::hasField(const CtfFieldHandle &handle) const
+{
+    return isInPlace(handle) || findField(handle) != nullptr;
+}
+
+int64_t CtfEvent::getInteger(const CtfFieldHandle &handle, int64_t defaultValue) const
+{
+    return getUnsigned(handle, defaultValue);
+}
+
+uint64_t CtfEvent::getUnsigned(const CtfFieldHandle &handle, uint64_t defaultValue) const
+{
+    if (isInPlace(handle)) {
+        CtfCursor cursor = packet;
+        cursor.pos = scopeStarts[static_cast<int>(handle.scope)] + handle.offset;
+        uint64_t value;
+        return cursor.readInteger(*handle.type, value) ? value : defaultValue;
+    }
+    const CtfValue *value = findField(handle);
+    return value ? value->raw : defaultValue;
+}
+
+bool CtfEvent::getText(const CtfFieldHandle &handle, const char *&chars, size_t &length) const
+{
+    if (isInPlace(handle)) {
+        CtfValue value;
+        value.type = handle.type;
+        value.pos = scopeStarts[static_cast<int>(handle.scope)] + handle.offset;
+        if (handle.type->kind == CtfTypeKind::STRING) {
+            const char *start = reinterpret_cast<const char *>(packet.data + value.pos / 8);
+            value.count = strnlen(start, packet.contentEnd / 8 - value.pos / 8);
+        } else {
+            value.count = handle.type->length;
+        }
+        return getText(value, chars, length);
+    }
+    const CtfValue *value = findField(handle);
+    if (!value) {
+        length = 0;
+        return false;
+    }
+    return getText(*value, chars, length);
+}
+
+std::string CtfEvent::getString(const CtfFieldHandle &handle) const
+{
+    const char *chars;
+    size_t length;
+    return getText(handle, chars, length) ? std::string(chars, length) : std::string();
+}
+
+CtfStreamReader::CtfStreamReader(const CtfMetadata &metadata, const TraceClock &clock,
+                                 std::shared_ptr<StreamFile> file, std::shared_ptr<const PacketIndex> index,
+                                 const std::vector<std::vector<CtfEventPlan>> &plans) :
+    metadata(metadata), clock(clock), file(file), index(index), plans(plans)
+{
+    cursor.bigEndian = metadata.isBigEndian();
+}
+
+bool CtfStreamReader::seek(uint64_t begin)
+{
+    // Packets are in time order, skip those that end before the range
+    const Indices &packets = index->getPacketIndex();
+    auto first = std::lower_bound(packets.begin(), packets.end(), begin,
+                                  [](const PacketHeader &header, uint64_t timestamp) {
+        return header.tsReal.timestampEnd < timestamp;
+    });
+    packet = first - packets.begin();
+    packetOpen = false;
+    while (next()) {
+        if (event.timestamp >= begin) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CtfStreamReader::next()
+{
+    const Indices &packets = index->getPacketIndex();
+    while (true) {
+        if (!packetOpen) {
+            if (packet >= packets.size() || !openPacket()) {
+                return false;
+            }
+        }
+
+        // The rest of the packet is padding
+        const CtfType &headerType = *streamClass->eventHeader;
+        if (alignUp(cursor.pos, headerType.align) >= cursor.contentEnd) {
+            packet++;
+            packetOpen = false;
+            continue;
+        }
+
+        scratch.clear();
+        event.scopes[static_cast<int>(CtfScope::EVENT_HEADER)].clear();
+        event.scopeTypes[static_cast<int>(CtfScope::EVENT_HEADER)] = &headerType;
+        int64_t id;
+        if (!readHeader(id)) {
+            return false;
+        }
+        const CtfEventClass &eventClass = streamClass->events[id];
+        const CtfEventPlan &plan = (*streamPlans)[id];
+
+        // Scopes that aren't needed are skipped, fixed size ones are
+        // decoded when first read
+        const CtfType *scopeTypes[] = {streamClass->eventContext.get(), eventClass.context.get(),
+                                       eventClass.fields.get()};
+        for (int i = 0; i < 3; i++) {
+            int scope = static_cast<int>(CtfScope::STREAM_EVENT_CONTEXT) + i;
+            const CtfType *type = scopeTypes[i];
+            event.scopes[scope].clear();
+            event.scopeTypes[scope] = type;
+            event.scopeDecoded[scope] = true;
+            if (!type) {
+                continue;
+            }
+            cursor.pos = alignUp(cursor.pos, type->align);
+            event.scopeStarts[scope] = cursor.pos;
+            if (!plan.scopes[scope] || type->fixedSize >= 0) {
+                event.scopeDecoded[scope] = !plan.scopes[scope];
+                if (!cursor.skip(*type, scratch)) {
+                    return false;
+                }
+            } else if (!cursor.decode(*type, nullptr, event.scopes[scope], scratch)) {
+                return false;
+            }
+        }
+
+        if (plan.wanted) {
+            event.eventClass = &eventClass;
+            event.timestamp = clock.toRealTimestamp(cycles);
+            return true;
+        }
+    }
+}
+
+const CtfEvent &CtfStreamReader::getEvent() const
+{
+    return event;
+}
+
+bool CtfStreamReader::count(uint64_t begin, uint64_t end, std::vector<uint64_t> &counts)
+{
+    const Indices &packets = index->getPacketIndex();
+    auto first = std::lower_bound(packets.begin(), packets.end(), begin,
+                                  [](const PacketHeader &header, uint64_t timestamp) {
+        return header.tsReal.timestampEnd < timestamp;
+    });
+    for (packet = first - packets.begin(); packet < packets.size(); packet++) {
+        const PacketHeader &header = packets[packet];
+        if (header.tsReal.timestampBegin > end) {
+            break;
+        }
+        if (!openPacket()) {
+            return false;
+        }
+        if (counts.size() < streamClass->events.size()) {
+            counts.resize(streamClass->events.size());
+        }
+
+        // Timestamps are only converted in the packets at the edges
+        bool isInside = header.tsReal.timestampBegin >= begin && header.tsReal.timestampEnd <= end;
+        const CtfType &headerType = *streamClass->eventHeader;
+        while (alignUp(cursor.pos, headerType.align) < cursor.contentEnd) {
+            int64_t id;
+            if (!readHeader(id) || !skipPayload(id)) {
+                return false;
+            }
+            if (!isInside) {
+                uint64_t timestamp = clock.toRealTimestamp(cycles);
+                if (timestamp < begin) {
+                    continue;
+                } else if (timestamp > end) {
+                    packetOpen = false;
+                    return true;
+                }
+            }
+            counts[id]++;
+        }
+    }
+    packetOpen = false;
+    return true;
+}
+
+const CtfStreamClass *CtfStreamReader::getStreamClass() const
+{
+    return streamClass;
+}
+
+bool CtfStreamReader::readHeader(int64_t &id)
+{
+    const CtfType &headerType = *streamClass->eventHeader;
+    cursor.pos = alignUp(cursor.pos, headerType.align);
+    event.scopeStarts[static_cast<int>(CtfScope::EVENT_HEADER)] = cursor.pos;
+
+    const CtfType *timestampType = nullptr;
+    uint64_t timestamp = 0;
+    if (hasHeaderLayout) {
+        // The header values are only decoded if they are asked for
+        const CtfHeaderLayout &layout = headerLayout;
+        event.scopeDecoded[static_cast<int>(CtfScope::EVENT_HEADER)] = false;
+        uint64_t value;
+        cursor.pos = alignUp(cursor.pos, layout.id->align);
+        if (!cursor.readInteger(*layout.id, value)) {
+            return false;
+        }
+        cursor.pos = alignUp(cursor.pos, layout.variant->align);
+        if (value == layout.extendedMarker) {
+            cursor.pos = alignUp(alignUp(cursor.pos, layout.extended->align), layout.extendedId->align);
+            if (!cursor.readInteger(*layout.extendedId, value)) {
+                return false;
+            }
+            timestampType = layout.extendedTimestamp;
+        } else {
+            cursor.pos = alignUp(cursor.pos, layout.compact->align);
+            timestampType = layout.compactTimestamp;
+        }
+        id = value;
+        cursor.pos = alignUp(cursor.pos, timestampType->align);
+        if (!cursor.readInteger(*timestampType, timestamp)) {
+            return false;
+        }
+    } else {
+        std::vector<CtfValue> &header = event.scopes[static_cast<int>(CtfScope::EVENT_HEADER)];
+        event.scopeDecoded[static_cast<int>(CtfScope::EVENT_HEADER)] = true;
+        if (!cursor.decode(headerType, nullptr, header, scratch)) {
+            return false;
+        }
+
+        // The extended header repeats the id and timestamp, the last ones win
+        id = -1;
+        for (const CtfValue &value : header) {
+            if (!value.name) {
+                continue;
+            } else if (*value.name == "id") {
+                id = value.raw;
+            } else if (value.type->mapsClock || *value.name == "timestamp") {
+                timestampType = value.type;
+                timestamp = value.raw;
+            }
+        }
+    }
+
+    if (timestampType) {
+        unsigned int size = timestampType->size;
+        if (size >= 64) {
+            cycles = timestamp;
+        } else {
+            // Compact timestamps only hold the low bits of the clock
+            uint64_t mask = (1ULL << size) - 1;
+            if (timestamp < (cycles & mask)) {
+                cycles += mask + 1;
+            }
+            cycles = (cycles & ~mask) | timestamp;
+        }
+    }
+
+    if (id < 0 || (size_t) id >= streamClass->events.size() || streamClass->events[id].name.empty()) {
+        std::cerr << "Error: unknown event id " << id << " in packet " << packet << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CtfStreamReader::skipPayload(int64_t id)
+{
+    const CtfEventClass &eventClass = streamClass->events[id];
+    const CtfType *scopeTypes[] = {streamClass->eventContext.get(), eventClass.context.get(),
+                                   eventClass.fields.get()};
+    for (const CtfType *type : scopeTypes) {
+        if (type && !cursor.skip(*type, scratch)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CtfStreamReader::openPacket()
+{
+    const PacketHeader &header = index->getPacketIndex()[packet];
+    const char *base = file->getData();
+    if (!base || (size_t) header.offset + header.packetSize / 8 > file->getSize()) {
+        std::cerr << "Error: packet " << packet << " is past the end of the stream file" << std::endl;
+        return false;
+    }
+    cursor.data = reinterpret_cast<const uint8_t *>(base + header.offset);
+    cursor.pos = 0;
+    cursor.contentEnd = header.contentSize;
+
+    // The packet header tells the stream class, the context the CPU and clock
+    int64_t streamId = 0;
+    scratch.clear();
+    if (metadata.getPacketHeader()) {
+        if (!cursor.decode(*metadata.getPacketHeader(), nullptr, scratch, scratch)) {
+            return false;
+        }
+        const CtfValue *value = findValue(scratch, "stream_id");
+        if (value) {
+            streamId = value->raw;
+        }
+    }
+    streamClass = metadata.getStreamClass(streamId);
+    if (!streamClass || !streamClass->eventHeader || (size_t) streamId >= plans.size()) {
+        std::cerr << "Error: unknown stream id " << streamId << " in packet " << packet << std::endl;
+        return false;
+    }
+    streamPlans = &plans[streamId];
+    if (streamClass != layoutClass) {
+        layoutClass = streamClass;
+        hasHeaderLayout = getHeaderLayout(*streamClass->eventHeader, headerLayout);
+    }
+
+    std::vector<CtfValue> &context = event.scopes[static_cast<int>(CtfScope::PACKET_CONTEXT)];
+    context.clear();
+    event.scopeDecoded[static_cast<int>(CtfScope::PACKET_CONTEXT)] = true;
+    event.scopeTypes[static_cast<int>(CtfScope::PACKET_CONTEXT)] = streamClass->packetContext.get();
+    if (streamClass->packetContext) {
+        cursor.pos = alignUp(cursor.pos, streamClass->packetContext->align);
+        event.scopeStarts[static_cast<int>(CtfScope::PACKET_CONTEXT)] = cursor.pos;
+        if (!cursor.decode(*streamClass->packetContext, nullptr, context, scratch)) {
+            return false;
+        }
+    }
+    const CtfValue *cpuId = findValue(context, "cpu_id");
+    event.cpu = cpuId ? cpuId->raw : -1;
+    const CtfValue *timestampBegin = findValue(context, "timestamp_begin");
+    cycles = timestampBegin ? timestampBegin->raw : header.tsCycles.timestampBegin;
+    event.packet = cursor;
+    packetOpen = true;
+    return true;
+}
+
+CtfTrace::Iterator::Iterator()
+{
+}
+
+CtfTrace::Iterator::Iterator(Iterator &&other) :
+    plans(std::move(other.plans)), readers(std::move(other.readers)), heap(std::move(other.heap)), end(other.end),
+    failed(other.failed)
+{
+}
+
+CtfTrace::Iterator &CtfTrace::Iterator::operator=(Iterator &&other)
+{
+    plans = std::move(other.plans);
+    readers = std::move(other.readers);
+    heap = std::move(other.heap);
+    end = other.end;
+    failed = other.failed;
+    return *this;
+}
+
+CtfTrace::Iterator::~Iterator()
+{
+}
+
+static bool isLater(const CtfStreamReader *a, const CtfStreamReader *b)
+{
+    return a->getEvent().getTimestamp() > b->getEvent().getTimestamp();
+}
+
+bool CtfTrace::Iterator::operator!=(const Iterator &other) const
+{
+    return !heap.empty() || !other.heap.empty();
+}
+
+CtfTrace::Iterator &CtfTrace::Iterator::operator++()
+{
+    CtfStreamReader *reader = heap.front();
+    pop();
+    if (reader->next() && reader->getEvent().getTimestamp() <= end) {
+        heap.push_back(reader);
+        std::push_heap(heap.begin(), heap.end(), isLater);
+    }
+    return *this;
+}
+
+bool CtfTrace::Iterator::hasFailed() const
+{
+    return failed;
+}
+
+const CtfEvent &CtfTrace::Iterator::operator*() const
+{
+    return heap.front()->getEvent();
+}
+
+void CtfTrace::Iterator::pop()
+{
+    std::pop_heap(heap.begin(), heap.end(), isLater);
+    heap.pop_back();
+}
+
+bool CtfTrace::open(const QString &tracePath)
+{
+    path = tracePath.toStdString();
+    std::string text;
+    if (!readMetadataText(QDir(tracePath).absoluteFilePath("metadata").toStdString(), text)) {
+        std::cerr << "Error: could not read the metadata of the trace" << std::endl;
+        return false;
+    }
+    if (!metadata.parse(text)) {
+        return false;
+    }
+
+    // The clock comes from the parsed metadata, which is not read again
+    return index.open(tracePath, metadata.getClock());
+}
+
+CtfTrace::Iterator CtfTrace::between(const uint64_t *begin, const uint64_t *end,
+                                     const CtfProjection &projection) const
+{
+    std::vector<size_t> streams(index.getStreams().size());
+    for (size_t i = 0; i < streams.size(); i++) {
+        streams[i] = i;
+    }
+    return between(begin, end, projection, streams);
+}
+
+CtfTrace::Iterator CtfTrace::between(const uint64_t *begin, const uint64_t *end, const CtfProjection &projection,
+                                     const std::vector<size_t> &streams) const
+{
+    Iterator iter;
+    iter.end = end ? *end : UINT64_MAX;
+    iter.plans = std::make_shared<const std::vector<std::vector<CtfEventPlan>>>(projection.resolve(metadata));
+    QDir traceDir(QString::fromStdString(path));
+    for (size_t i : streams) {
+        const StreamIndex &stream = index.getStreams()[i];
+        std::string streamPath = traceDir.absoluteFilePath(QString::fromStdString(stream.name)).toStdString();
+        std::shared_ptr<StreamFile> file = StreamFilePool::instance().acquire(streamPath);
+        if (!file) {
+            // Leaving the stream out would silently drop its events
+            std::cerr << "Error: could not open stream file " << streamPath << std::endl;
+            iter.heap.clear();
+            iter.readers.clear();
+            iter.failed = true;
+            return iter;
+        }
+        iter.readers.emplace_back(new CtfStreamReader(metadata, index.getClock(), file, stream.index, *iter.plans));
+        CtfStreamReader *reader = iter.readers.back().get();
+        if (reader->seek(begin ? *begin : 0) && reader->getEvent().getTimestamp() <= iter.end) {
+            iter.heap.push_back(reader);
+        }
+    }
+    std::make_heap(iter.heap.begin(), iter.heap.end(), isLater);
+    return iter;
+}
+
+CtfTrace::Iterator CtfTrace::end() const
+{
+    return Iterator();
+}
+
+bool CtfTrace::count(const uint64_t *begin, const uint64_t *end, std::vector<CtfStreamCount> &counts) const
+{
+    // The readers only look at headers, no event needs a plan
+    std::vector<std::vector<CtfEventPlan>> plans = CtfProjection::headersOnly().resolve(metadata);
+    QDir traceDir(QString::fromStdString(path));
+    counts.clear();
+    for (const StreamIndex &stream : index.getStreams()) {
+        std::string streamPath = traceDir.absoluteFilePath(QString::fromStdString(stream.name)).toStdString();
+        std::shared_ptr<StreamFile> file = StreamFilePool::instance().acquire(streamPath);
+        if (!file) {
+            std::cerr << "Error: could not open stream file " << streamPath << std::endl;
+            return false;
+        }
+        CtfStreamReader reader(metadata, index.getClock(), file, stream.index, plans);
+        counts.emplace_back();
+        CtfStreamCount &count = counts.back();
+        count.stream = stream.name;
+        if (!reader.count(begin ? *begin : 0, end ? *end : UINT64_MAX, count.events)) {
+            return false;
+        }
+        count.streamClass = reader.getStreamClass();
+        count.cpu = reader.getEvent().getCpu();
+    }
+    return true;
+}
+
+CtfFieldHandle CtfTrace::getFieldHandle(const CtfEventClass &eventClass, CtfScope scope,
+                                        const std::string &field) const
+{
+    CtfFieldHandle handle;
+    handle.scope = scope;
+    handle.name = field;
+    const CtfStreamClass *streamClass = metadata.getStreamClass(eventClass.streamId);
+    if (!streamClass) {
+        return handle;
+    }
+    const CtfType *scopeTypes[5] = {streamClass->packetContext.get(), streamClass->eventHeader.get(),
+                                    streamClass->eventContext.get(), eventClass.context.get(),
+                                    eventClass.fields.get()};
+    handle.scopeType = scopeTypes[static_cast<int>(scope)];
+    if (!handle.scopeType) {
+        return handle;
+    }
+
+    // Walk the scope as the decoder does, until the field
+    uint64_t offset = 0;
+    bool isFixed = true;
+    int leaf = 0;
+    for (const CtfField &scopeField : handle.scopeType->fields) {
+        const CtfType &type = *scopeField.type;
+        offset = alignUp(offset, type.align);
+        if (scopeField.name == field || (scopeField.name[0] == '_' && scopeField.name.compare(1, std::string::npos, field) == 0)) {
+            handle.type = &type;
+            bool isScalar = type.kind != CtfTypeKind::STRUCT && type.kind != CtfTypeKind::VARIANT;
+            if (isFixed && isScalar && type.kind != CtfTypeKind::SEQUENCE) {
+                handle.offset = offset;
+            }
+            if (leaf >= 0 && isScalar) {
+                handle.leaf = leaf;
+            }
+            return handle;
+        }
+        if (type.fixedSize >= 0) {
+            offset += type.fixedSize;
+        } else {
+            isFixed = false;
+        }
+        int count = countValues(type);
+        leaf = leaf < 0 || count < 0 ? -1 : leaf + count;
+    }
+
+    // Nested fields are found by name
+    handle.type = findFieldType(*handle.scopeType, field);
+    return handle;
+}
+
+CtfFieldHandle CtfTrace::getFieldHandle(const std::string &eventName, CtfScope scope,
+                                        const std::string &field) const
+{
+    std::vector<const CtfEventClass *> eventClasses = getEventClasses(eventName);
+    if (eventClasses.empty()) {
+        CtfFieldHandle handle;
+        handle.scope = scope;
+        handle.name = field;
+        return handle;
+    }
+    return getFieldHandle(*eventClasses.front(), scope, field);
+}
+
+std::vector<const CtfEventClass *> CtfTrace::getEventClasses(const std::string &name) const
+{
+    std::vector<const CtfEventClass *> eventClasses;
+    for (const CtfStreamClass &streamClass : metadata.getStreamClasses()) {
+        for (const CtfEventClass &eventClass : streamClass.events) {
+            if (eventClass.name == name) {
+                eventClasses.push_back(&eventClass);
+            }
+        }
+    }
+    return eventClasses;
+}
+
+const std::string &CtfTrace::getEventName(size_t index) const
+{
+    static const std::string unknown;
+    for (const CtfStreamClass &streamClass : metadata.getStreamClasses()) {
+        if (!streamClass.events.empty() && index <= streamClass.events.back().index) {
+            return streamClass.events[index - streamClass.events.front().index].name;
+        }
+    }
+    return unknown;
+}
+
+size_t CtfTrace::getNumEventClasses() const
+{
+    return metadata.getNumEventClasses();
+}
+
+uint64_t CtfTrace::getBegin() const
+{
+    return index.getBegin();
+}
+
+uint64_t CtfTrace::getEnd() const
+{
+    return index.getEnd();
+}
+
+const TraceIndex &CtfTrace::getIndex() const
+{
+    return index;
+}
+
+bool parseDecoder(const std::string &name, Decoder &decoder)
+{
+    if (name == "tigerbeetle") {
+        decoder = Decoder::TIGERBEETLE;
+    } else if (name == "native") {
+        decoder = Decoder::NATIVE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string decoderName(Decoder decoder)
+{
+    switch (decoder) {
+    case Decoder::TIGERBEETLE:
+        return "tigerbeetle";
+    case Decoder::NATIVE:
+        return "native";
+    }
+    return "unknown";
+}
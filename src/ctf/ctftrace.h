@@ -0,0 +1,449 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CTFTRACE_H
+#define CTFTRACE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+
+#include "common/streamfilepool.h"
+#include "common/traceindex.h"
+#include "ctf/ctfmetadata.h"
+
+enum class Decoder { TIGERBEETLE, NATIVE };
+
+/*
+ * Scopes of the fields of an event, in the order they are laid out.
+ */
+enum class CtfScope { PACKET_CONTEXT, EVENT_HEADER, STREAM_EVENT_CONTEXT, EVENT_CONTEXT, FIELDS };
+
+/*
+ * A field decoded in place. Integers and enums are read as the event is
+ * decoded; strings, arrays and sequences point into the packet.
+ */
+struct CtfValue {
+    const std::string *name = nullptr;
+    const CtfType *type = nullptr;
+    uint64_t pos = 0;		/* position in the packet, in bits */
+    uint64_t count = 0;		/* bytes of a string, elements of an array or sequence */
+    uint64_t raw = 0;		/* integer value, sign extended */
+};
+
+/*
+ * Decoding position inside a packet.
+ */
+struct CtfCursor {
+    const uint8_t *data = nullptr;
+    uint64_t pos = 0;		/* in bits, from the beginning of the packet */
+    uint64_t contentEnd = 0;	/* in bits */
+    bool bigEndian = false;
+
+    /*!
+     * \brief Decode a value, appending its integers, strings, arrays and
+     * sequences to values. Structs and variants are flattened, elements
+     * of arrays of structs go to scratch.
+     */
+    bool decode(const CtfType &type, const std::string *name, std::vector<CtfValue> &values,
+                std::vector<CtfValue> &scratch);
+
+    /*!
+     * \brief Move past a value without keeping it, at once when its size
+     * doesn't depend on the data.
+     */
+    bool skip(const CtfType &type, std::vector<CtfValue> &scratch);
+
+    bool readInteger(const CtfType &type, uint64_t &value);
+};
+
+/*
+ * What to decode for an event class, resolved from a CtfProjection.
+ */
+struct CtfEventPlan {
+    bool wanted = false;
+    bool scopes[5] = {};	/* indexed by CtfScope */
+};
+
+/*!
+ * \brief The CtfProjection class declares the events an analysis handles
+ * and the fields it reads from them.
+ *
+ * Events that are not declared are skipped without decoding their
+ * payload, using the size precomputed from the metadata when the layout
+ * is fixed. Scopes holding none of the declared fields are skipped the
+ * same way, and the other fixed size scopes are only decoded when one of
+ * their fields is read.
+ */
+class CtfProjection
+{
+public:
+    /*!
+     * \brief Decode all the events and all their fields.
+     */
+    CtfProjection();
+
+    /*!
+     * \brief Return all the events, without decoding any of their fields.
+     */
+    static CtfProjection headersOnly();
+
+    /*!
+     * \brief Return the events with this name, and decode the scopes
+     * holding these fields. Once an event is added, the other events are
+     * skipped.
+     */
+    void addEvent(const std::string &name, const std::vector<std::string> &fields);
+
+    /*!
+     * \brief Get the plans of the event classes of each stream class,
+     * indexed by stream id and event id.
+     */
+    std::vector<std::vector<CtfEventPlan>> resolve(const CtfMetadata &metadata) const;
+
+private:
+    bool allEvents = true;
+    bool allFields = true;
+    std::unordered_map<std::string, std::vector<std::string>> events;
+};
+
+/*!
+ * \brief The CtfFieldHandle class is a field of an event class, resolved
+ * once from its name so that reading it doesn't search for it.
+ *
+ * Fields laid out at a fixed offset from the start of their scope are
+ * read in place, without decoding the rest of the scope. Other fields are
+ * found by their position in the decoded scope, or by name when the scope
+ * has variants. A handle used on an event of another layout falls back
+ * to the name.
+ */
+class CtfFieldHandle
+{
+public:
+    bool isValid() const;
+
+private:
+    friend class CtfEvent;
+    friend class CtfTrace;
+
+    CtfScope scope = CtfScope::FIELDS;
+    std::string name;
+    const CtfType *scopeType = nullptr;
+    const CtfType *type = nullptr;
+    int64_t offset = -1;	/* from the start of the scope, in bits, or -1 */
+    int leaf = -1;		/* position in the decoded scope, or -1 */
+};
+
+/*!
+ * \brief The CtfEvent class is a view of the event under a CtfTrace
+ * iterator. It is only valid until the iterator moves.
+ */
+class CtfEvent
+{
+public:
+    /*!
+     * \brief Get the id of the event in its stream class. Events of other
+     * streams may have the same id, compare the event classes instead.
+     */
+    int64_t getId() const;
+    const std::string &getName() const;
+    const CtfEventClass &getEventClass() const;
+
+    /*!
+     * \brief Get the timestamp of the event, in nanoseconds since the epoch.
+     */
+    uint64_t getTimestamp() const;
+
+    /*!
+     * \brief Get the cpu_id of the packet context.
+     */
+    int getCpu() const;
+
+    /*!
+     * \brief Find a field of a scope.
+     * \return The field, or nullptr if the scope has no such field or
+     * the field was not declared in the projection. A leading underscore,
+     * added to field names by LTTng, is ignored.
+     */
+    const CtfValue *getField(CtfScope scope, const char *name) const;
+
+    int64_t getInteger(CtfScope scope, const char *name, int64_t defaultValue = 0) const;
+    uint64_t getUnsigned(CtfScope scope, const char *name, uint64_t defaultValue = 0) const;
+
+    /*!
+     * \brief Get a string, or an array or sequence of text characters,
+     * up to its first null character.
+     */
+    std::string getString(const CtfValue &value) const;
+    std::string getString(CtfScope scope, const char *name) const;
+
+    /*!
+     * \brief Read a field through a handle resolved by CtfTrace.
+     */
+    bool hasField(const CtfFieldHandle &handle) const;
+    int64_t getInteger(const CtfFieldHandle &handle, int64_t defaultValue = 0) const;
+    uint64_t getUnsigned(const CtfFieldHandle &handle, uint64_t defaultValue = 0) const;
+    std::string getString(const CtfFieldHandle &handle) const;
+
+    /*!
+     * \brief Get a text field without copying it. The characters point
+     * into the packet, and are only valid until the iterator moves.
+     * \return false if the event has no such text field.
+     */
+    bool getText(const CtfFieldHandle &handle, const char *&chars, size_t &length) const;
+
+private:
+    friend class CtfStreamReader;
+
+    const std::vector<CtfValue> &getValues(CtfScope scope) const;
+    bool getText(const CtfValue &value, const char *&chars, size_t &length) const;
+    const CtfValue *findField(const CtfFieldHandle &handle) const;
+    bool isInPlace(const CtfFieldHandle &handle) const;
+
+    const CtfEventClass *eventClass = nullptr;
+    uint64_t timestamp = 0;
+    int cpu = -1;
+    CtfCursor packet;
+
+    // Fixed size scopes are decoded on first access
+    const CtfType *scopeTypes[5] = {};
+    uint64_t scopeStarts[5] = {};
+    mutable bool scopeDecoded[5] = {};
+    mutable std::vector<CtfValue> scopes[5];
+    mutable std::vector<CtfValue> scratch;
+};
+
+/*
+ * Layout of the compact and large event headers of LTTng: an id enum,
+ * then a variant holding either a short timestamp or, when the id is the
+ * extended marker, the full id and timestamp.
+ */
+struct CtfHeaderLayout {
+    const CtfType *header = nullptr;
+    const CtfType *id = nullptr;
+    const CtfType *variant = nullptr;
+    const CtfType *compact = nullptr;
+    const CtfType *compactTimestamp = nullptr;
+    const CtfType *extended = nullptr;
+    const CtfType *extendedId = nullptr;
+    const CtfType *extendedTimestamp = nullptr;
+    uint64_t extendedMarker = 0;
+};
+
+/*!
+ * \brief The CtfStreamReader class decodes the events of a stream file,
+ * packet by packet, from the mapping of the StreamFilePool.
+ *
+ * The values of each scope are kept in vectors reused from one event to
+ * the next, so decoding doesn't allocate once the vectors are warm.
+ */
+class CtfStreamReader
+{
+public:
+    CtfStreamReader(const CtfMetadata &metadata, const TraceClock &clock, std::shared_ptr<StreamFile> file,
+                    std::shared_ptr<const PacketIndex> index, const std::vector<std::vector<CtfEventPlan>> &plans);
+
+    /*!
+     * \brief Move to the first event at or after begin.
+     * \return false if there is no such event.
+     */
+    bool seek(uint64_t begin);
+
+    /*!
+     * \brief Decode the next event of the projection.
+     * \return false at the end of the stream, or on a decoding error.
+     */
+    bool next();
+
+    const CtfEvent &getEvent() const;
+
+    /*!
+     * \brief Count the events between two timestamps, inclusively, by
+     * event id, reading only their headers and skipping their payloads.
+     * \param counts Incremented for each event, resized as needed.
+     * \return false on a decoding error.
+     */
+    bool count(uint64_t begin, uint64_t end, std::vector<uint64_t> &counts);
+
+    /*!
+     * \brief The stream class of the last packet read, or nullptr.
+     */
+    const CtfStreamClass *getStreamClass() const;
+
+private:
+    bool openPacket();
+    bool readHeader(int64_t &id);
+    bool skipPayload(int64_t id);
+
+    const CtfMetadata &metadata;
+    const TraceClock &clock;
+    std::shared_ptr<StreamFile> file;
+    std::shared_ptr<const PacketIndex> index;
+    const std::vector<std::vector<CtfEventPlan>> &plans;
+    const CtfStreamClass *streamClass = nullptr;
+    const std::vector<CtfEventPlan> *streamPlans = nullptr;
+    const CtfStreamClass *layoutClass = nullptr;
+    bool hasHeaderLayout = false;	/* the header is read without decoding it */
+    CtfHeaderLayout headerLayout;
+    unsigned int packet = 0;
+    bool packetOpen = false;
+    CtfCursor cursor;
+    uint64_t cycles = 0;		/* current value of the clock */
+    CtfEvent event;
+    std::vector<CtfValue> scratch;
+};
+
+/*
+ * Number of events of a stream file, by event id.
+ */
+struct CtfStreamCount {
+    std::string stream;	/* name of the stream file */
+    const CtfStreamClass *streamClass = nullptr;	/* null if no packet was read */
+    int cpu = -1;	/* cpu_id of the last packet read */
+    std::vector<uint64_t> events;
+};
+
+/*!
+ * \brief The CtfTrace class is a CTF decoder for LTTng kernel traces,
+ * used instead of babeltrace with --decoder native.
+ *
+ * The stream files are mapped and events are decoded in place using the
+ * layouts declared by the metadata. Packets are found with the packet
+ * index, so a time range is reached without decoding what precedes it.
+ * The metadata is read and parsed once, when the trace is opened, and all
+ * the workers of an analysis share it through the trace.
+ */
+class CtfTrace
+{
+public:
+    /*!
+     * \brief Iterator over the events of a time range, merged from all
+     * the streams in timestamp order.
+     */
+    class Iterator
+    {
+    public:
+        Iterator();
+        Iterator(Iterator &&other);
+        Iterator &operator=(Iterator &&other);
+        ~Iterator();
+
+        Iterator(const Iterator &other) = delete;
+        Iterator &operator=(const Iterator &other) = delete;
+
+        // Only meant to be compared with CtfTrace::end()
+        bool operator!=(const Iterator &other) const;
+        Iterator &operator++();
+        const CtfEvent &operator*() const;
+
+        /*!
+         * \brief Whether a stream file could not be opened. The iterator
+         * is then at the end, the events of the range are not complete.
+         */
+        bool hasFailed() const;
+
+    private:
+        friend class CtfTrace;
+
+        void pop();
+
+        std::shared_ptr<const std::vector<std::vector<CtfEventPlan>>> plans;
+        std::vector<std::unique_ptr<CtfStreamReader>> readers;
+        std::vector<CtfStreamReader *> heap;
+        uint64_t end = 0;
+        bool failed = false;
+    };
+
+    /*!
+     * \brief Parse the metadata and load the packet index of a trace,
+     * using the clock of the parsed metadata.
+     * \return false, after printing the error, if the trace can't be read.
+     */
+    bool open(const QString &tracePath);
+
+    /*!
+     * \brief Iterate over the events between two timestamps, inclusively.
+     * A null bound leaves the range open on that side.
+     * \param projection The events and fields to decode.
+     * \return The iterator, which has failed if a stream file could not
+     * be opened.
+     */
+    Iterator between(const uint64_t *begin, const uint64_t *end,
+                     const CtfProjection &projection = CtfProjection()) const;
+
+    /*!
+     * \brief Iterate over the events of some of the stream files only.
+     * \param streams Positions of the streams in the trace index.
+     */
+    Iterator between(const uint64_t *begin, const uint64_t *end, const CtfProjection &projection,
+                     const std::vector<size_t> &streams) const;
+    Iterator end() const;
+
+    /*!
+     * \brief Count the events of each stream file between two timestamps,
+     * inclusively. Only the event headers are read and the streams aren't
+     * merged in time order, so this is much cheaper than iterating.
+     * \return false if a stream file could not be opened, or on a decoding
+     * error.
+     */
+    bool count(const uint64_t *begin, const uint64_t *end, std::vector<CtfStreamCount> &counts) const;
+
+    /*!
+     * \brief Resolve a field of an event class, or a field of the context
+     * of its stream.
+     * \return The handle, invalid if the field doesn't exist.
+     */
+    CtfFieldHandle getFieldHandle(const CtfEventClass &eventClass, CtfScope scope, const std::string &field) const;
+
+    /*!
+     * \brief Resolve a field of the first event class with the given name.
+     * \return The handle, invalid if the event or field doesn't exist.
+     */
+    CtfFieldHandle getFieldHandle(const std::string &eventName, CtfScope scope, const std::string &field) const;
+
+    /*!
+     * \brief Get the event classes with the given name, one per stream
+     * class (i.e. channel) the event is enabled in.
+     */
+    std::vector<const CtfEventClass *> getEventClasses(const std::string &name) const;
+
+    /*!
+     * \brief Get the name of an event class from its CtfEventClass::index,
+     * or an empty string.
+     */
+    const std::string &getEventName(size_t index) const;
+    size_t getNumEventClasses() const;
+
+    uint64_t getBegin() const;
+    uint64_t getEnd() const;
+    const TraceIndex &getIndex() const;
+
+private:
+    std::string path;
+    CtfMetadata metadata;
+    TraceIndex index;
+};
+
+bool parseDecoder(const std::string &name, Decoder &decoder);
+std::string decoderName(Decoder decoder);
+
+#endif // CTFTRACE_H
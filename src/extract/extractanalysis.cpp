@@ -0,0 +1,252 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "extractanalysis.h"
+#include "common/traceindex.h"
+#include "common/utils.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+
+/*
+ * Copy a byte range between two files inside the kernel. copy_file_range()
+ * can share extents on filesystems that support it, sendfile() is used
+ * when the files are on different filesystems or the kernel is too old.
+ */
+static bool copyRange(int sourceFd, off_t sourceOffset, int destFd, off_t destOffset, size_t length)
+{
+    bool useSendfile = false;
+    while (length > 0) {
+        ssize_t ret;
+        if (!useSendfile) {
+            loff_t in = sourceOffset;
+            loff_t out = destOffset;
+            ret = copy_file_range(sourceFd, &in, destFd, &out, length, 0);
+            if (ret < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                useSendfile = true;
+                continue;
+            }
+        } else {
+            if (lseek(destFd, destOffset, SEEK_SET) < 0) {
+                return false;
+            }
+            off_t in = sourceOffset;
+            ret = sendfile(destFd, sourceFd, &in, length);
+        }
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            return false;
+        }
+        sourceOffset += ret;
+        destOffset += ret;
+        length -= ret;
+    }
+    return true;
+}
+
+ExtractResult ExtractAnalysis::doMap(const ExtractStream &stream)
+{
+    ExtractResult result;
+    std::shared_ptr<StreamFile> source = StreamFilePool::instance().acquire(stream.sourcePath);
+    if (!source) {
+        result.errors++;
+        return result;
+    }
+    int destFd = open(stream.destPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (destFd < 0) {
+        std::cerr << "Error: could not create " << stream.destPath << ": " << strerror(errno) << std::endl;
+        result.errors++;
+        return result;
+    }
+
+    // Packets are copied in runs of contiguous packets
+    const Indices &headers = stream.index->getPacketIndex();
+    std::vector<off_t> offsets;
+    off_t destOffset = 0;
+    unsigned int i = 0;
+    while (i < stream.packets.size()) {
+        off_t runOffset = headers[stream.packets[i]].offset;
+        off_t runLength = 0;
+        unsigned int j = i;
+        for (; j < stream.packets.size(); j++) {
+            const PacketHeader &header = headers[stream.packets[j]];
+            if (header.offset != runOffset + runLength) {
+                break;
+            }
+            offsets.push_back(destOffset + runLength);
+            runLength += header.packetSize / 8;
+        }
+        if (!copyRange(source->getFd(), runOffset, destFd, destOffset, runLength)) {
+            std::cerr << "Error: could not copy packets to " << stream.destPath << ": "
+                      << strerror(errno) << std::endl;
+            result.errors++;
+            close(destFd);
+            return result;
+        }
+        destOffset += runLength;
+        i = j;
+    }
+
+    if (close(destFd) != 0) {
+        result.errors++;
+        return result;
+    }
+    if (!stream.index->writeSubset(stream.destIndexPath, stream.packets, offsets)) {
+        result.errors++;
+        return result;
+    }
+
+    result.streams = 1;
+    result.packets = stream.packets.size();
+    result.bytes = destOffset;
+    return result;
+}
+
+void ExtractAnalysis::doReduce(ExtractResult &final, const ExtractResult &intermediate)
+{
+    final.streams += intermediate.streams;
+    final.packets += intermediate.packets;
+    final.bytes += intermediate.bytes;
+    final.errors += intermediate.errors;
+}
+
+bool ExtractAnalysis::isOrderedReduce()
+{
+    return false;
+}
+
+void ExtractAnalysis::doExecuteParallel()
+{
+    std::vector<ExtractStream> streams;
+    if (!getStreams(streams)) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QThreadPool::globalInstance()->setMaxThreadCount(this->threads);
+    auto future = QtConcurrent::mappedReduced(streams.begin(), streams.end(),
+                                              &ExtractAnalysis::doMap, &ExtractAnalysis::doReduce,
+                                              QtConcurrent::UnorderedReduce);
+    ExtractResult data = future.result();
+
+    printResults(data, timer.nsecsElapsed());
+}
+
+void ExtractAnalysis::doExecuteSerial()
+{
+    std::vector<ExtractStream> streams;
+    if (!getStreams(streams)) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    ExtractResult data;
+    for (const ExtractStream &stream : streams) {
+        doReduce(data, doMap(stream));
+    }
+
+    printResults(data, timer.nsecsElapsed());
+}
+
+bool ExtractAnalysis::getStreams(std::vector<ExtractStream> &streams)
+{
+    if (outputPath.isEmpty()) {
+        std::cerr << "Error: the extract analysis needs an --output directory" << std::endl;
+        return false;
+    }
+    QDir traceDir(tracePath);
+    QDir outputDir(outputPath);
+    if (outputDir.exists() && !outputDir.entryList(QStringList(), QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot).isEmpty()) {
+        std::cerr << "Error: the output directory " << qPrintable(outputPath) << " is not empty" << std::endl;
+        return false;
+    }
+    if (!outputDir.mkpath("index")) {
+        std::cerr << "Error: could not create " << qPrintable(outputPath) << std::endl;
+        return false;
+    }
+    if (!QFile::copy(traceDir.absoluteFilePath("metadata"), outputDir.absoluteFilePath("metadata"))) {
+        std::cerr << "Error: could not copy the metadata" << std::endl;
+        return false;
+    }
+
+    // Only the indices are needed, the trace isn't opened
+    TraceIndex traceIndex;
+    if (!traceIndex.open(tracePath)) {
+        return false;
+    }
+
+    for (const StreamIndex &streamIndex : traceIndex.getStreams()) {
+        ExtractStream stream;
+        stream.index = streamIndex.index;
+        const Indices &headers = stream.index->getPacketIndex();
+        for (unsigned int i = 0; i < headers.size(); i++) {
+            if (headers[i].tsReal.timestampEnd >= windowBegin && headers[i].tsReal.timestampBegin <= windowEnd) {
+                stream.packets.push_back(i);
+            }
+        }
+
+        // Streams without packets in the window are left out
+        if (stream.packets.empty()) {
+            continue;
+        }
+        QString name = QString::fromStdString(streamIndex.name);
+        stream.sourcePath = traceDir.absoluteFilePath(name).toStdString();
+        stream.destPath = outputDir.absoluteFilePath(name).toStdString();
+        stream.destIndexPath = outputDir.absoluteFilePath("index/" + name + ".idx").toStdString();
+        streams.push_back(std::move(stream));
+    }
+
+    return true;
+}
+
+void ExtractAnalysis::printResults(const ExtractResult &data, uint64_t nanoseconds)
+{
+    std::string line(80, '-');
+    double seconds = nanoseconds / 1000000000.0;
+    uint64_t throughput = seconds > 0 ? data.bytes / seconds : 0;
+
+    std::cout << line << std::endl;
+    std::cout << "Result of extract analysis" << std::endl << std::endl;
+    std::cout << std::setw(20) << std::left << "Output" << qPrintable(outputPath) << std::endl;
+    std::cout << std::setw(20) << std::left << "Streams" << data.streams << std::endl;
+    std::cout << std::setw(20) << std::left << "Packets" << data.packets << std::endl;
+    std::cout << std::setw(20) << std::left << "Size" << convertSize(data.bytes) << std::endl;
+    std::cout << std::setw(20) << std::left << "Throughput" << convertSize(throughput) << "/s" << std::endl;
+    if (data.errors) {
+        std::cout << std::setw(20) << std::left << "Errors" << data.errors << std::endl;
+    }
+    std::cout << line << std::endl;
+}
@@ -0,0 +1,70 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXTRACTANALYSIS_H
+#define EXTRACTANALYSIS_H
+
+#include "common/traceanalysis.h"
+
+/*
+ * A stream file and the packets to copy from it.
+ */
+struct ExtractStream {
+    std::string sourcePath;
+    std::string destPath;
+    std::string destIndexPath;
+    std::shared_ptr<const PacketIndex> index;
+    std::vector<unsigned int> packets;	/* positions in the index, in file order */
+};
+
+struct ExtractResult {
+    uint64_t streams = 0;
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t errors = 0;
+};
+
+/*!
+ * \brief The ExtractAnalysis class writes a smaller trace holding the
+ * packets of every stream that overlap a time window.
+ *
+ * Packets are picked from the packet index and copied whole, without
+ * decoding, with copy_file_range(). The metadata is copied and new index
+ * files are written, so the result is a valid trace. Since packets are
+ * kept whole, it may hold a few events just outside the window.
+ */
+class ExtractAnalysis : public AbstractTraceAnalysis
+{
+    Q_OBJECT
+public:
+    ExtractAnalysis(QObject *parent) : AbstractTraceAnalysis(parent) { }
+
+    static ExtractResult doMap(const ExtractStream &stream);
+    static void doReduce(ExtractResult &final, const ExtractResult &intermediate);
+
+protected:
+    virtual void doExecuteParallel();
+    virtual void doExecuteSerial();
+    virtual bool isOrderedReduce();
+
+private:
+    bool getStreams(std::vector<ExtractStream> &streams);
+    void printResults(const ExtractResult &data, uint64_t nanoseconds);
+};
+
+#endif // EXTRACTANALYSIS_H
@@ -0,0 +1,279 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "indexstatsanalysis.h"
+#include "common/utils.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+static void keepLargestHotspots(std::vector<DiscardedHotspot> &hotspots, unsigned int max)
+{
+    std::sort(hotspots.begin(), hotspots.end(), [](const DiscardedHotspot &a, const DiscardedHotspot &b) {
+        return a.count > b.count;
+    });
+    if (hotspots.size() > max) {
+        hotspots.resize(max);
+    }
+}
+
+/*
+ * Split the bytes of a packet across the intervals it spans, in
+ * proportion to the time it spends in each. The part of the packet outside
+ * the time window is not charged.
+ */
+static void addIntervalBytes(std::vector<uint64_t> &intervalBytes, const IndexStatsStream &stream,
+                             uint64_t packetBegin, uint64_t packetEnd, uint64_t bytes)
+{
+    uint64_t first = std::max(packetBegin, stream.begin);
+    uint64_t last = std::min(packetEnd, stream.end);
+    unsigned int interval = std::min<uint64_t>((first - stream.begin) / stream.intervalWidth,
+                                               stream.numIntervals - 1);
+    if (packetEnd <= packetBegin) {
+        intervalBytes[interval] += bytes;
+        return;
+    }
+
+    // Bytes of the packet before a timestamp, the differences of which
+    // add up to the packet size
+    uint64_t duration = packetEnd - packetBegin;
+    auto bytesBefore = [&](uint64_t ts) {
+        return (uint64_t) ((long double) bytes * (ts - packetBegin) / duration);
+    };
+    for (uint64_t ts = first; ts < last; interval++) {
+        uint64_t intervalEnd = interval + 1 < stream.numIntervals ?
+                    stream.begin + (interval + 1) * stream.intervalWidth : last;
+        uint64_t next = std::min(intervalEnd, last);
+        intervalBytes[interval] += bytesBefore(next) - bytesBefore(ts);
+        ts = next;
+    }
+}
+
+IndexStatsResult IndexStatsAnalysis::doMap(const IndexStatsStream &stream)
+{
+    IndexStatsResult result;
+    result.intervalBytes.resize(stream.numIntervals);
+
+    StreamStats stats;
+    stats.name = stream.stream->name;
+    stats.begin = stream.end;
+    stats.end = stream.begin;
+
+    // The discarded events counter of a packet is the total since the
+    // beginning of the stream
+    uint64_t previousDiscarded = 0;
+    for (const PacketHeader &header : stream.stream->index->getPacketIndex()) {
+        uint64_t discarded = header.eventsDiscarded - std::min(previousDiscarded, header.eventsDiscarded);
+        previousDiscarded = header.eventsDiscarded;
+        if (header.tsReal.timestampEnd < stream.begin || header.tsReal.timestampBegin > stream.end) {
+            continue;
+        }
+
+        uint64_t bytes = header.contentSize / 8;
+        stats.packets++;
+        stats.bytes += bytes;
+        stats.discarded += discarded;
+        stats.begin = std::min(stats.begin, header.tsReal.timestampBegin);
+        stats.end = std::max(stats.end, header.tsReal.timestampEnd);
+
+        addIntervalBytes(result.intervalBytes, stream, header.tsReal.timestampBegin,
+                         header.tsReal.timestampEnd, bytes);
+
+        if (discarded > 0) {
+            DiscardedHotspot hotspot;
+            hotspot.stream = stats.name;
+            hotspot.begin = header.tsReal.timestampBegin;
+            hotspot.end = header.tsReal.timestampEnd;
+            hotspot.count = discarded;
+            result.hotspots.push_back(hotspot);
+        }
+    }
+    keepLargestHotspots(result.hotspots, NUM_HOTSPOTS);
+
+    result.streams.push_back(stats);
+    return result;
+}
+
+void IndexStatsAnalysis::doReduce(IndexStatsResult &final, const IndexStatsResult &intermediate)
+{
+    final.streams.insert(final.streams.end(), intermediate.streams.begin(), intermediate.streams.end());
+    if (final.intervalBytes.size() < intermediate.intervalBytes.size()) {
+        final.intervalBytes.resize(intermediate.intervalBytes.size());
+    }
+    for (unsigned int i = 0; i < intermediate.intervalBytes.size(); i++) {
+        final.intervalBytes[i] += intermediate.intervalBytes[i];
+    }
+    final.hotspots.insert(final.hotspots.end(), intermediate.hotspots.begin(), intermediate.hotspots.end());
+    keepLargestHotspots(final.hotspots, NUM_HOTSPOTS);
+}
+
+bool IndexStatsAnalysis::isOrderedReduce()
+{
+    return false;
+}
+
+void IndexStatsAnalysis::doExecuteParallel()
+{
+    QThreadPool::globalInstance()->setMaxThreadCount(this->threads);
+    TraceIndex traceIndex;
+    if (!traceIndex.open(tracePath)) {
+        return;
+    }
+    std::vector<IndexStatsStream> streams = getStreams(traceIndex);
+    if (streams.empty()) {
+        return;
+    }
+
+    auto future = QtConcurrent::mappedReduced(streams.begin(), streams.end(),
+                                              &IndexStatsAnalysis::doMap, &IndexStatsAnalysis::doReduce,
+                                              QtConcurrent::UnorderedReduce);
+    IndexStatsResult data = future.result();
+
+    printResults(data, streams);
+}
+
+void IndexStatsAnalysis::doExecuteSerial()
+{
+    QThreadPool::globalInstance()->setMaxThreadCount(1);
+    TraceIndex traceIndex;
+    if (!traceIndex.open(tracePath)) {
+        return;
+    }
+    std::vector<IndexStatsStream> streams = getStreams(traceIndex);
+    if (streams.empty()) {
+        return;
+    }
+
+    IndexStatsResult data;
+    for (const IndexStatsStream &stream : streams) {
+        doReduce(data, doMap(stream));
+    }
+
+    printResults(data, streams);
+}
+
+std::vector<IndexStatsStream> IndexStatsAnalysis::getStreams(const TraceIndex &traceIndex)
+{
+    std::vector<IndexStatsStream> streams;
+
+    // Streams without packets are left out of the index
+    if (traceIndex.getStreams().empty()) {
+        std::cerr << "Error: the trace has no indexed packets" << std::endl;
+        return streams;
+    }
+
+    // The trace bounds come from the index, clipped to the time window
+    uint64_t begin = std::max<uint64_t>(traceIndex.getBegin(), windowBegin);
+    uint64_t end = std::min<uint64_t>(traceIndex.getEnd(), windowEnd);
+    if (begin > end) {
+        std::cerr << "Error: the time window does not overlap the trace" << std::endl;
+        return streams;
+    }
+    uint64_t intervalWidth = std::max<uint64_t>((end - begin) / NUM_INTERVALS + 1, 1);
+
+    for (const StreamIndex &stream : traceIndex.getStreams()) {
+        IndexStatsStream statsStream;
+        statsStream.stream = &stream;
+        statsStream.begin = begin;
+        statsStream.end = end;
+        statsStream.intervalWidth = intervalWidth;
+        statsStream.numIntervals = NUM_INTERVALS;
+        streams.push_back(statsStream);
+    }
+    return streams;
+}
+
+static std::string formatRate(uint64_t bytes, uint64_t nanoseconds)
+{
+    double seconds = nanoseconds / 1000000000.0;
+    return convertSize(seconds > 0 ? bytes / seconds : 0) + "/s";
+}
+
+void IndexStatsAnalysis::printResults(const IndexStatsResult &data, const std::vector<IndexStatsStream> &streams)
+{
+    std::string line(80, '-');
+    uint64_t begin = streams.front().begin;
+    uint64_t end = streams.front().end;
+    uint64_t intervalWidth = streams.front().intervalWidth;
+
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t discarded = 0;
+    for (const StreamStats &stats : data.streams) {
+        packets += stats.packets;
+        bytes += stats.bytes;
+        discarded += stats.discarded;
+    }
+
+    std::cout << line << std::endl;
+    std::cout << "Result of index-stats analysis" << std::endl << std::endl;
+    std::cout << std::setw(20) << std::left << "Begin" << begin << std::endl;
+    std::cout << std::setw(20) << std::left << "End" << end << std::endl;
+    std::cout << std::setw(20) << std::left << "Duration (s)"
+              << std::setprecision(3) << std::fixed << (end - begin) / 1000000000.0 << std::endl;
+    std::cout << std::setw(20) << std::left << "Streams" << data.streams.size() << std::endl;
+    std::cout << std::setw(20) << std::left << "Packets" << packets << std::endl;
+    std::cout << std::setw(20) << std::left << "Size" << convertSize(bytes) << std::endl;
+    std::cout << std::setw(20) << std::left << "Events discarded" << discarded << std::endl;
+
+    // Per stream (i.e. per CPU buffer) throughput
+    std::vector<StreamStats> sortedStreams = data.streams;
+    std::sort(sortedStreams.begin(), sortedStreams.end(), [](const StreamStats &a, const StreamStats &b) {
+        return a.bytes > b.bytes;
+    });
+    std::cout << line << std::endl;
+    std::cout << std::setw(20) << std::left << "Stream" << std::setw(12) << std::left << "Packets"
+              << std::setw(16) << std::left << "Size" << std::setw(16) << std::left << "Throughput"
+              << "Discarded" << std::endl;
+    for (const StreamStats &stats : sortedStreams) {
+        std::cout << std::setw(20) << std::left << stats.name << std::setw(12) << std::left << stats.packets
+                  << std::setw(16) << std::left << convertSize(stats.bytes)
+                  << std::setw(16) << std::left << formatRate(stats.bytes, stats.end > stats.begin ? stats.end - stats.begin : 0)
+                  << stats.discarded << std::endl;
+    }
+
+    // Throughput over time, of all the streams
+    std::cout << line << std::endl;
+    std::cout << std::setw(44) << std::left << "Interval" << "Throughput" << std::endl;
+    for (unsigned int i = 0; i < data.intervalBytes.size(); i++) {
+        uint64_t intervalBegin = begin + i * intervalWidth;
+        uint64_t intervalEnd = std::min(intervalBegin + intervalWidth, end);
+        std::stringstream ss;
+        ss << "[" << intervalBegin << ", " << intervalEnd << "]";
+        std::cout << std::setw(44) << std::left << ss.str()
+                  << formatRate(data.intervalBytes[i], intervalEnd - intervalBegin) << std::endl;
+    }
+
+    // Packets that lost the most events
+    if (!data.hotspots.empty()) {
+        std::cout << line << std::endl;
+        std::cout << std::setw(20) << std::left << "Stream" << std::setw(44) << std::left << "Packet"
+                  << "Discarded" << std::endl;
+        for (const DiscardedHotspot &hotspot : data.hotspots) {
+            std::stringstream ss;
+            ss << "[" << hotspot.begin << ", " << hotspot.end << "]";
+            std::cout << std::setw(20) << std::left << hotspot.stream << std::setw(44) << std::left << ss.str()
+                      << hotspot.count << std::endl;
+        }
+    }
+    std::cout << line << std::endl;
+}
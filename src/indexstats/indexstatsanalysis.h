@@ -0,0 +1,88 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INDEXSTATSANALYSIS_H
+#define INDEXSTATSANALYSIS_H
+
+#include "common/traceanalysis.h"
+#include "common/traceindex.h"
+
+/*
+ * A stream and the time grid its packets are accounted in.
+ */
+struct IndexStatsStream {
+    const StreamIndex *stream;
+    uint64_t begin;		/* time window */
+    uint64_t end;
+    uint64_t intervalWidth;	/* width of a throughput interval, in ns */
+    unsigned int numIntervals;
+};
+
+/*
+ * A packet that lost events.
+ */
+struct DiscardedHotspot {
+    std::string stream;
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    uint64_t count = 0;
+};
+
+struct StreamStats {
+    std::string name;
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t discarded = 0;
+    uint64_t begin = 0;
+    uint64_t end = 0;
+};
+
+struct IndexStatsResult {
+    std::vector<StreamStats> streams;
+    std::vector<uint64_t> intervalBytes;
+    std::vector<DiscardedHotspot> hotspots;	/* largest first */
+};
+
+/*!
+ * \brief The IndexStatsAnalysis class answers coarse questions about a
+ * trace from its packet indices only: bounds, per stream buffer
+ * throughput, throughput over time and where events were discarded.
+ */
+class IndexStatsAnalysis : public AbstractTraceAnalysis
+{
+    Q_OBJECT
+public:
+    IndexStatsAnalysis(QObject *parent) : AbstractTraceAnalysis(parent) { }
+
+    static IndexStatsResult doMap(const IndexStatsStream &stream);
+    static void doReduce(IndexStatsResult &final, const IndexStatsResult &intermediate);
+
+protected:
+    virtual void doExecuteParallel();
+    virtual void doExecuteSerial();
+    virtual bool isOrderedReduce();
+
+private:
+    static const unsigned int NUM_INTERVALS = 20;
+    static const unsigned int NUM_HOTSPOTS = 10;
+
+    std::vector<IndexStatsStream> getStreams(const TraceIndex &traceIndex);
+    void printResults(const IndexStatsResult &data, const std::vector<IndexStatsStream> &streams);
+};
+
+#endif // INDEXSTATSANALYSIS_H
@@ -20,11 +20,14 @@
 #include "iocontext.h"
 #include "common/utils.h"
 #include "common/packetindex.h"
+#include "common/pipeline.h"
+#include "common/recordbatch.h"
 
 #include <QtConcurrent>
 #include <QTemporaryDir>
 #include <QUuid>
 
+#include <fstream>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
@@ -64,49 +67,34 @@ IoWorker::IoWorker(int id, TraceSet &set, timestamp_t *begin, timestamp_t *end,
 
 IoContext IoWorker::doMap() const
 {
+    if (getColumnSegment()) {
+        return doMapColumns();
+    }
+    if (getCtfTrace()) {
+        return doMapNative();
+    }
+
     const TraceSet &set = getTraceSet();
     TraceSet::Iterator iter = set.between(getBeginPos(), getEndPos());
     TraceSet::Iterator endIter = set.end();
 
     IoContext data;
+    data.setSeriesWidth(getSeriesWidth());
+    data.setSketchCapacity(getSketchCapacity());
 
-    // Get event ids
-    std::set<event_id_t> readEventIds {};
-    for (const std::string &eventName : readSyscalls) {
-        event_id_t id = getEventId(set, eventName);
-        readEventIds.insert(id);
-    }
-    std::set<event_id_t> writeEventIds {};
-    for (const std::string &eventName : writeSyscalls) {
-        event_id_t id = getEventId(set, eventName);
-        writeEventIds.insert(id);
-    }
-    std::set<event_id_t> readWriteEventIds {};
-    for (const std::string &eventName : readWriteSyscalls) {
-        event_id_t id = getEventId(set, eventName);
-        readWriteEventIds.insert(id);
-    }
-    std::set<event_id_t> exitEventIds {};
-    for (const std::string &eventName : exitSyscalls) {
-        event_id_t id = getEventId(set, eventName);
-        exitEventIds.insert(id);
+    // The handlers are normally resolved once by the analysis
+    std::shared_ptr<const EventDispatch<IoContext>> ownDispatch;
+    const EventDispatch<IoContext> *dispatch = getDispatch();
+    if (!dispatch) {
+        ownDispatch = createDispatch(getMetadata());
+        dispatch = ownDispatch.get();
     }
 
     // Iterate through events
     uint64_t count = 0;
     for ((void)iter; iter != endIter; ++iter) {
         count++;
-        const auto &event = *iter;
-        event_id_t id = event.getId();
-        if (readEventIds.find(id) != readEventIds.end()) {
-            data.handleSysRead(event);
-        } else if (writeEventIds.find(id) != writeEventIds.end()) {
-            data.handleSysWrite(event);
-        } else if (readWriteEventIds.find(id) != readWriteEventIds.end()) {
-            data.handleSysReadWrite(event);
-        } else if (exitEventIds.find(id) != exitEventIds.end()) {
-            data.handleExitSyscall(event);
-        }
+        dispatch->dispatch(data, *iter);
     }
 
     if (getVerbose()) {
@@ -118,11 +106,191 @@ IoContext IoWorker::doMap() const
                   << beginString << " and " << endString << std::endl;
     }
 
-    data.handleEnd();
+    return data;
+}
+
+IoContext IoWorker::doMapColumns() const
+{
+    const ColumnSegment &segment = *getColumnSegment();
+    const timestamp_t *begin = getBeginPos();
+    const timestamp_t *end = getEndPos();
+    IoContext data;
+    data.setSeriesWidth(getSeriesWidth());
+    data.setSketchCapacity(getSketchCapacity());
+
+    uint64_t count = 0;
+    segment.forEachSyscall(begin ? *begin : 0, end ? *end : UINT64_MAX,
+                           [&](uint64_t timestamp, SyscallRowKind kind, int tid, name_id_t comm,
+                               name_id_t name, int fd, int64_t ret) {
+        count++;
+        switch (kind) {
+        case SyscallRowKind::READ:
+            data.handleSyscallEntry(timestamp, tid, comm, name, IOType::READ, fd);
+            break;
+        case SyscallRowKind::WRITE:
+            data.handleSyscallEntry(timestamp, tid, comm, name, IOType::WRITE, fd);
+            break;
+        case SyscallRowKind::READWRITE:
+            data.handleSyscallEntry(timestamp, tid, comm, name, IOType::READWRITE, fd);
+            break;
+        case SyscallRowKind::EXIT:
+            data.handleSyscallExit(timestamp, tid, comm, ret);
+            break;
+        }
+    });
+
+    if (getVerbose()) {
+        std::string beginString = begin ? std::to_string(*begin) : "START";
+        std::string endString = end ? std::to_string(*end) : "END";
+        std::cout << "Worker " << getId() << " replayed " << count << " syscalls between timestamps "
+                  << beginString << " and " << endString << std::endl;
+    }
 
     return data;
 }
 
+IoContext IoWorker::doMapNative() const
+{
+    const CtfTrace &trace = *getCtfTrace();
+    const timestamp_t *begin = getBeginPos();
+    const timestamp_t *end = getEndPos();
+    IoContext data;
+    data.setSeriesWidth(getSeriesWidth());
+    data.setSketchCapacity(getSketchCapacity());
+
+    // Resolve the fields of each syscall event once, indexed by event class
+    // since each channel has its own event ids
+    struct SyscallFields {
+        bool isSyscall = false;
+        bool isExit = false;
+        IOType type = IOType::UNKNOWN;
+        name_id_t name = NameTable::EMPTY;
+        CtfFieldHandle tid;
+        CtfFieldHandle procname;
+        CtfFieldHandle fd;
+        CtfFieldHandle ret;
+    };
+    std::vector<SyscallFields> syscalls(trace.getNumEventClasses());
+    NameTable &names = NameTable::instance();
+    auto addSyscalls = [&](const std::vector<std::string> &eventNames, IOType type, bool isExit) {
+        for (const std::string &eventName : eventNames) {
+            for (const CtfEventClass *eventClass : trace.getEventClasses(eventName)) {
+                SyscallFields &fields = syscalls[eventClass->index];
+                fields.isSyscall = true;
+                fields.isExit = isExit;
+                fields.type = type;
+                fields.name = names.intern(eventName);
+                fields.tid = trace.getFieldHandle(*eventClass, CtfScope::STREAM_EVENT_CONTEXT, "tid");
+                fields.procname = trace.getFieldHandle(*eventClass, CtfScope::STREAM_EVENT_CONTEXT, "procname");
+                fields.fd = trace.getFieldHandle(*eventClass, CtfScope::FIELDS, "fd");
+                fields.ret = trace.getFieldHandle(*eventClass, CtfScope::FIELDS, "ret");
+            }
+        }
+    };
+    addSyscalls(readSyscalls, IOType::READ, false);
+    addSyscalls(writeSyscalls, IOType::WRITE, false);
+    addSyscalls(readWriteSyscalls, IOType::READWRITE, false);
+    addSyscalls(exitSyscalls, IOType::UNKNOWN, true);
+
+    auto decode = [&](const CtfEvent &event, SyscallRecord &record) -> bool {
+        const SyscallFields &fields = syscalls[event.getEventClass().index];
+        if (!fields.isSyscall) {
+            return false;
+        }
+
+        if (!event.hasField(fields.tid)) {
+            std::cerr << "Missing tid context info" << std::endl;
+            return false;
+        }
+        const char *procname;
+        size_t procnameLength;
+        event.getText(fields.procname, procname, procnameLength);
+        record.timestamp = event.getTimestamp();
+        record.tid = event.getInteger(fields.tid);
+        record.comm = names.intern(procname, procnameLength);
+        record.isExit = fields.isExit;
+        record.ret = fields.isExit ? event.getInteger(fields.ret) : 0;
+        record.fd = fields.isExit || fields.type == IOType::READWRITE ? -1 : event.getInteger(fields.fd, -1);
+        record.name = fields.name;
+        record.type = fields.type;
+        return true;
+    };
+    auto handle = [&](const SyscallRecord *records, size_t size) {
+        data.handleSyscalls(records, size);
+    };
+
+    uint64_t count = 0;
+    if (getPipelineDecoders() > 0) {
+        Pipeline<SyscallRecord> pipeline(getPipelineDecoders());
+        if (!pipeline.run(trace, begin, end, getProjection(), decode, handle)) {
+            setFailed();
+        }
+        for (const PipelineStageStats &stats : pipeline.getDecoderStats()) {
+            count += stats.events;
+        }
+        if (getVerbose()) {
+            pipeline.printStats(std::cout, getId());
+        }
+    } else {
+        // Events are decoded into batches of records, then handed to the analysis
+        RecordBatch<SyscallRecord> batch;
+        SyscallRecord record;
+        CtfTrace::Iterator iter = trace.between(begin, end, getProjection());
+        CtfTrace::Iterator endIter = trace.end();
+        for ((void)iter; iter != endIter; ++iter) {
+            count++;
+            if (!decode(*iter, record)) {
+                continue;
+            }
+            batch.add() = record;
+            if (batch.isFull()) {
+                handle(batch.data(), batch.size());
+                batch.clear();
+            }
+        }
+        handle(batch.data(), batch.size());
+        if (iter.hasFailed()) {
+            setFailed();
+        }
+    }
+
+    if (getVerbose()) {
+        std::string beginString = begin ? std::to_string(*begin) : "START";
+        std::string endString = end ? std::to_string(*end) : "END";
+        std::cout << "Worker " << getId() << " decoded " << count << " events between timestamps "
+                  << beginString << " and " << endString << std::endl;
+    }
+
+    return data;
+}
+
+std::shared_ptr<const EventDispatch<IoContext>> IoWorker::createDispatch(const TraceMetadata &metadata)
+{
+    std::shared_ptr<EventDispatch<IoContext>> dispatch = std::make_shared<EventDispatch<IoContext>>(metadata);
+    dispatch->add(metadata, readSyscalls, &IoContext::handleSysRead);
+    dispatch->add(metadata, writeSyscalls, &IoContext::handleSysWrite);
+    dispatch->add(metadata, readWriteSyscalls, &IoContext::handleSysReadWrite);
+    dispatch->add(metadata, exitSyscalls, &IoContext::handleExitSyscall);
+    return dispatch;
+}
+
+CtfProjection IoWorker::getProjection()
+{
+    CtfProjection projection;
+    for (const std::vector<std::string> *names : {&readSyscalls, &writeSyscalls}) {
+        for (const std::string &eventName : *names) {
+            projection.addEvent(eventName, {"tid", "procname", "fd"});
+        }
+    }
+    for (const std::string &eventName : readWriteSyscalls) {
+        projection.addEvent(eventName, {"tid", "procname"});
+    }
+    for (const std::string &eventName : exitSyscalls) {
+        projection.addEvent(eventName, {"tid", "procname", "ret"});
+    }
+    return projection;
+}
+
 void IoWorker::doReduce(IoContext &final, const IoContext &intermediate)
 {
     final.merge(intermediate);
@@ -133,59 +301,41 @@ bool IoAnalysis::isOrderedReduce()
     return true;
 }
 
+bool IoAnalysis::supportsColumns()
+{
+    return true;
+}
+
 void IoAnalysis::doExecuteSerial()
 {
     TraceSet set;
     set.addTrace(this->tracePath.toStdString());
+    TraceMetadata metadata(set);
 
     IoContext data;
+    data.setSeriesWidth(seriesWidth);
+    data.setSketchCapacity(sketchCapacity);
+    std::shared_ptr<const Dispatch> dispatch = createDispatch(metadata);
 
-    // Get event ids
-    std::set<event_id_t> readEventIds {};
-    for (const std::string &eventName : readSyscalls) {
-        event_id_t id = getEventId(set, eventName);
-        readEventIds.insert(id);
-    }
-    std::set<event_id_t> writeEventIds {};
-    for (const std::string &eventName : writeSyscalls) {
-        event_id_t id = getEventId(set, eventName);
-        writeEventIds.insert(id);
-    }
-    std::set<event_id_t> readWriteEventIds {};
-    for (const std::string &eventName : readWriteSyscalls) {
-        event_id_t id = getEventId(set, eventName);
-        readWriteEventIds.insert(id);
-    }
-
-    std::set<event_id_t> exitEventIds {};
-    for (const std::string &eventName : exitSyscalls) {
-        event_id_t id = getEventId(set, eventName);
-        exitEventIds.insert(id);
-    }
     // Iterate through events
-    for (const auto &event : set) {
-        event_id_t id = event.getId();
-        if (readEventIds.find(id) != readEventIds.end()) {
-            data.handleSysRead(event);
-        } else if (writeEventIds.find(id) != writeEventIds.end()) {
-            data.handleSysWrite(event);
-        } else if (readWriteEventIds.find(id) != readWriteEventIds.end()) {
-            data.handleSysReadWrite(event);
-        } else if (exitEventIds.find(id) != exitEventIds.end()) {
-            data.handleExitSyscall(event);
-        }
+    TraceSet::Iterator iter = set.between(getWindowBeginPos(), getWindowEndPos());
+    TraceSet::Iterator endIter = set.end();
+    for ((void)iter; iter != endIter; ++iter) {
+        dispatch->dispatch(data, *iter);
     }
 
-    data.handleEnd();
-
     printResults(data);
 }
 
+std::shared_ptr<const IoAnalysis::Dispatch> IoAnalysis::createDispatch(const TraceMetadata &metadata)
+{
+    return IoWorker::createDispatch(metadata);
+}
+
 void IoAnalysis::printResults(IoContext &data)
 {
     std::string line(80, '-');
     int max = 10;
-    int count = 0;
     int colWidth = 30;
 
     std::cout << line << std::endl;
@@ -194,32 +344,73 @@ void IoAnalysis::printResults(IoContext &data)
     std::cout << std::setw(colWidth) << std::left << "Process" <<
                  std::setw(colWidth) << std::left << "Size" << std::endl;
 
-    for (const IoProcess &process : data.getTidsByRead()) {
-        if (++count > max) {
-            break;
-        }
+    for (const IoProcess &process : data.getTopTidsByRead(max)) {
         std::stringstream ss;
-        ss << process.comm << " (" << process.tid << ")";
+        ss << NameTable::instance().resolve(process.comm) << " (" << process.tid << ")";
         std::cout << std::setw(colWidth) << std::left << ss.str() <<
                      std::setw(colWidth) << std::left << convertSize(process.readBytes) << std::endl;
     }
+    if (data.getTopTidsByReadError()) {
+        std::cout << "Approximate: each size is at most " << convertSize(data.getTopTidsByReadError())
+                  << " below the real one" << std::endl;
+    }
     std::cout << line << std::endl;
     std::cout << "Syscall I/O Write" << std::endl << std::endl;
     std::cout << std::setw(colWidth) << std::left << "Process" <<
                  std::setw(colWidth) << std::left << "Size" << std::endl;
-    count = 0;
-    for (const IoProcess &process : data.getTidsByWrite()) {
-        if (++count > max) {
-            break;
-        }
+    for (const IoProcess &process : data.getTopTidsByWrite(max)) {
         std::stringstream ss;
-        ss << process.comm << " (" << process.tid << ")";
+        ss << NameTable::instance().resolve(process.comm) << " (" << process.tid << ")";
         std::cout << std::setw(colWidth) << std::left << ss.str() <<
                      std::setw(colWidth) << std::left << convertSize(process.writeBytes) << std::endl;
     }
+    if (data.getTopTidsByWriteError()) {
+        std::cout << "Approximate: each size is at most " << convertSize(data.getTopTidsByWriteError())
+                  << " below the real one" << std::endl;
+    }
+    std::cout << line << std::endl;
+    std::cout << "Syscall I/O Latency" << std::endl << std::endl;
+    printLatencyHeader("Type", colWidth);
+    printLatencies("Read", data.getReadLatencies(), colWidth);
+    printLatencies("Write", data.getWriteLatencies(), colWidth);
+
+    std::cout << std::endl;
+    printLatencyHeader("Process (read)", colWidth);
+    for (const IoProcess &process : data.getTopTidsByReadLatency(max)) {
+        if (!process.readLatencies.getCount()) {
+            continue;
+        }
+        std::stringstream ss;
+        ss << NameTable::instance().resolve(process.comm) << " (" << process.tid << ")";
+        printLatencies(ss.str(), process.readLatencies, colWidth);
+    }
+    std::cout << std::endl;
+    printLatencyHeader("Process (write)", colWidth);
+    for (const IoProcess &process : data.getTopTidsByWriteLatency(max)) {
+        if (!process.writeLatencies.getCount()) {
+            continue;
+        }
+        std::stringstream ss;
+        ss << NameTable::instance().resolve(process.comm) << " (" << process.tid << ")";
+        printLatencies(ss.str(), process.writeLatencies, colWidth);
+    }
+
+    const TimeSeries<IoBucket> &series = data.getSeries();
+    if (series.isEnabled()) {
+        // One row per time bucket, with the bytes of the syscalls that
+        // returned in it
+        std::ofstream file;
+        std::ostream &out = openSeriesOutput(file);
+        out << "timestamp,read_bytes,write_bytes" << std::endl;
+        for (uint64_t timestamp = series.getBegin(); timestamp < series.getEnd(); timestamp += series.getWidth()) {
+            IoBucket bucket = series.get(timestamp);
+            out << timestamp << "," << bucket.readBytes << "," << bucket.writeBytes << "\n";
+        }
+        out.flush();
+    }
 }
 
 void IoAnalysis::doEnd(IoContext &data)
 {
-    data.handleEnd();
+    (void) data;
 }
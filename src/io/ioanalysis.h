@@ -22,6 +22,12 @@
 #include "common/traceanalysis.h"
 #include "iocontext.h"
 
+// Event names handled by the analysis, also used by the column store
+extern std::vector<std::string> readSyscalls;
+extern std::vector<std::string> writeSyscalls;
+extern std::vector<std::string> readWriteSyscalls;
+extern std::vector<std::string> exitSyscalls;
+
 class IoWorker : public TraceWorker<IoContext>
 {
 public:
@@ -37,6 +43,10 @@ public:
     }
 
     virtual IoContext doMap() const;
+    IoContext doMapColumns() const;
+    IoContext doMapNative() const;
+    static std::shared_ptr<const EventDispatch<IoContext>> createDispatch(const TraceMetadata &metadata);
+    static CtfProjection getProjection();
     static void doReduce(IoContext &final, const IoContext &intermediate);
 
 };
@@ -49,6 +59,20 @@ public:
 
 protected:
     virtual bool isOrderedReduce();
+    virtual QString getCacheName()
+    {
+        return "io";
+    }
+    virtual int getCacheVersion()
+    {
+        return 5;
+    }
+    virtual bool supportsColumns();
+    virtual bool supportsNativeDecoder()
+    {
+        return true;
+    }
+    virtual std::shared_ptr<const Dispatch> createDispatch(const TraceMetadata &metadata);
     virtual void doExecuteSerial();
     virtual void printResults(IoContext &data);
     virtual void doEnd(IoContext &data);
@@ -40,77 +40,225 @@ void IoContext::handleSysReadWrite(const tibee::trace::EventValue &event)
 void IoContext::handleExitSyscall(const tibee::trace::EventValue &event)
 {
     uint64_t timestamp = event.getTimestamp();
-    if (!event.getStreamEventContext()->HasField("tid")) {
+    const auto *context = event.getStreamEventContext();
+    if (!context->HasField("tid")) {
         std::cerr << "Missing tid context info" << std::endl;
         return;
     }
-    std::string comm = "";
-    if (event.getStreamEventContext()->HasField("procname")) {
-        comm = event.getStreamEventContext()->GetField("procname")->AsString();
+    name_id_t comm = NameTable::EMPTY;
+    if (context->HasField("procname")) {
+        comm = NameTable::instance().intern(context->GetField("procname")->AsString());
     }
-    int tid = event.getStreamEventContext()->GetField("tid")->AsInteger();
+    int tid = context->GetField("tid")->AsInteger();
     int64_t ret = event.getFields()->GetField("ret")->AsLong();
 
-    if (!tids.contains(tid)) {
-        IoProcess p;
-        p.tid = tid;
-        p.comm = comm;
-        tids[tid] = p;
-    }
-    IoProcess &p = tids[tid];
-    if (!p.currentSyscall) {
-        if (!p.unknownSyscall) {
-            // We have an unkown syscall, save it
-            p.unknownSyscall = Syscall();
-            p.unknownSyscall->end = timestamp;
-            p.unknownSyscall->ret = ret;
+    handleSyscallExit(timestamp, tid, comm, ret);
+}
+
+void IoContext::handleSyscallExit(uint64_t timestamp, int tid, name_id_t comm, int64_t ret)
+{
+    SyscallRecord record = {timestamp, ret, tid, -1, comm, NameTable::EMPTY, IOType::UNKNOWN, true};
+    handleSyscalls(&record, 1);
+}
+
+void IoContext::handleSyscalls(const SyscallRecord *records, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const SyscallRecord &record = records[i];
+        IoProcess &p = tids[record.tid];
+        if (p.tid == UNKNOWN_TID) {
+            p.tid = record.tid;
+            p.comm = record.comm;
         }
-    } else {
-        if (ret >= 0) {
-            uint64_t latency = timestamp - p.currentSyscall->start;
-            if (p.currentSyscall->type == IOType::READ ||
-                p.currentSyscall->type == IOType::READWRITE) {
-                p.totalReadLatency += latency;
-                p.readBytes += ret;
-                p.readCount++;
+
+        if (!record.isExit) {
+            p.currentSyscall = Syscall();
+            p.currentSyscall->type = record.type;
+            p.currentSyscall->start = record.timestamp;
+            p.currentSyscall->name = record.name;
+            p.currentSyscall->fd = record.fd;
+        } else if (!p.currentSyscall) {
+            if (!p.unknownSyscall) {
+                // We have an unkown syscall, save it
+                p.unknownSyscall = Syscall();
+                p.unknownSyscall->end = record.timestamp;
+                p.unknownSyscall->ret = record.ret;
             }
-            if (p.currentSyscall->type == IOType::WRITE ||
-                       p.currentSyscall->type == IOType::READWRITE) {
-                p.totalWriteLatency += latency;
-                p.writeBytes += ret;
-                p.writeCount++;
+        } else {
+            if (record.ret >= 0) {
+                addToSeries(*p.currentSyscall, record.timestamp, record.ret);
+                uint64_t latency = record.timestamp - p.currentSyscall->start;
+                addLatency(p, p.currentSyscall->type, latency);
+                if (p.currentSyscall->type == IOType::READ ||
+                    p.currentSyscall->type == IOType::READWRITE) {
+                    p.totalReadLatency += latency;
+                    p.readBytes += record.ret;
+                    p.readCount++;
+                }
+                if (p.currentSyscall->type == IOType::WRITE ||
+                           p.currentSyscall->type == IOType::READWRITE) {
+                    p.totalWriteLatency += latency;
+                    p.writeBytes += record.ret;
+                    p.writeCount++;
+                }
+            }
+            p.currentSyscall = boost::none;
+            if (readSketch.isEnabled()) {
+                flushToSketches(p);
+                if (!p.unknownSyscall) {
+                    tids.erase(record.tid);
+                }
             }
         }
-        p.currentSyscall = boost::none;
     }
 }
-const std::list<IoProcess> &IoContext::getTidsByWrite()
+/*
+ * Get the top of a sketch as processes, with the guaranteed bytes.
+ */
+static std::vector<IoProcess> getTopProcesses(const SpaceSaving &sketch, size_t count, bool isRead)
+{
+    std::vector<IoProcess> top;
+    for (const SpaceSaving::Counter &counter : sketch.getTop(count)) {
+        IoProcess p;
+        p.tid = counter.key;
+        p.comm = counter.name;
+        (isRead ? p.readBytes : p.writeBytes) = counter.weight - counter.error;
+        top.push_back(p);
+    }
+    return top;
+}
+
+void IoContext::setSketchCapacity(size_t value)
 {
-    sortedTids.sort([](const IoProcess &a, const IoProcess &b) -> bool {
+    readSketch.setCapacity(value);
+    writeSketch.setCapacity(value);
+}
+
+std::vector<IoProcess> IoContext::getTopTidsByWrite(size_t count) const
+{
+    if (writeSketch.isEnabled()) {
+        return getTopProcesses(writeSketch, count, false);
+    }
+    return tids.getTop(count, [](const IoProcess &a, const IoProcess &b) -> bool {
         return a.writeBytes > b.writeBytes;
     });
-    return sortedTids;
 }
 
-const std::list<IoProcess> &IoContext::getTidsByRead()
+std::vector<IoProcess> IoContext::getTopTidsByRead(size_t count) const
 {
-    sortedTids.sort([](const IoProcess &a, const IoProcess &b) -> bool {
+    if (readSketch.isEnabled()) {
+        return getTopProcesses(readSketch, count, true);
+    }
+    return tids.getTop(count, [](const IoProcess &a, const IoProcess &b) -> bool {
         return a.readBytes > b.readBytes;
     });
-    return sortedTids;
 }
 
-void IoContext::handleEnd()
+std::vector<IoProcess> IoContext::getTopTidsByReadLatency(size_t count) const
+{
+    return tids.getTopBy(count, [](const IoProcess &process) {
+        return process.readLatencies.getPercentile(99);
+    });
+}
+
+std::vector<IoProcess> IoContext::getTopTidsByWriteLatency(size_t count) const
+{
+    return tids.getTopBy(count, [](const IoProcess &process) {
+        return process.writeLatencies.getPercentile(99);
+    });
+}
+
+const LatencyHistogram &IoContext::getReadLatencies() const
+{
+    return readLatencies;
+}
+
+const LatencyHistogram &IoContext::getWriteLatencies() const
+{
+    return writeLatencies;
+}
+
+uint64_t IoContext::getTopTidsByWriteError() const
+{
+    return writeSketch.getMaxError();
+}
+
+uint64_t IoContext::getTopTidsByReadError() const
+{
+    return readSketch.getMaxError();
+}
+
+void IoContext::addLatency(IoProcess &process, IOType type, uint64_t latency)
+{
+    // Processes don't outlive their syscalls with sketches, only the
+    // latencies of each syscall class are kept
+    bool perProcess = !readSketch.isEnabled();
+    if (type == IOType::READ || type == IOType::READWRITE) {
+        if (perProcess) {
+            process.readLatencies.add(latency);
+        }
+        readLatencies.add(latency);
+    }
+    if (type == IOType::WRITE || type == IOType::READWRITE) {
+        if (perProcess) {
+            process.writeLatencies.add(latency);
+        }
+        writeLatencies.add(latency);
+    }
+}
+
+/*
+ * Move the bytes of a process to the sketches.
+ */
+void IoContext::flushToSketches(IoProcess &process)
+{
+    if (process.readBytes) {
+        readSketch.add(process.tid, process.readBytes, process.comm);
+        process.readBytes = 0;
+    }
+    if (process.writeBytes) {
+        writeSketch.add(process.tid, process.writeBytes, process.comm);
+        process.writeBytes = 0;
+    }
+}
+
+void IoContext::setSeriesWidth(uint64_t value)
+{
+    series.setWidth(value);
+}
+
+const TimeSeries<IoBucket> &IoContext::getSeries() const
 {
-    QList<IoProcess> l = tids.values();
-    sortedTids = l.toStdList();
+    return series;
+}
+
+void IoContext::addToSeries(const Syscall &syscall, uint64_t timestamp, int64_t ret)
+{
+    if (!series.isEnabled()) {
+        return;
+    }
+    IoBucket &bucket = series.at(timestamp);
+    if (syscall.type == IOType::READ || syscall.type == IOType::READWRITE) {
+        bucket.readBytes += ret;
+    }
+    if (syscall.type == IOType::WRITE || syscall.type == IOType::READWRITE) {
+        bucket.writeBytes += ret;
+    }
 }
 
 void IoContext::merge(const IoContext &other)
 {
-    for (const IoProcess &otherProcess : other.tids.values()) {
-        if (tids.contains(otherProcess.tid)) {
-            IoProcess &thisProcess = tids[otherProcess.tid];
+    // The time series of consecutive chunks share their boundary bucket
+    series.merge(other.series);
+    readLatencies.merge(other.readLatencies);
+    writeLatencies.merge(other.writeLatencies);
+    readSketch.merge(other.readSketch);
+    writeSketch.merge(other.writeSketch);
+
+    other.tids.forEach([&](int tid, const IoProcess &otherProcess) {
+        IoProcess *thisProcessPtr = tids.find(tid);
+        if (thisProcessPtr) {
+            IoProcess &thisProcess = *thisProcessPtr;
 
             thisProcess.totalReadLatency += otherProcess.totalReadLatency;
             thisProcess.totalWriteLatency += otherProcess.totalWriteLatency;
@@ -121,11 +269,19 @@ void IoContext::merge(const IoContext &other)
             thisProcess.readCount += otherProcess.readCount;
             thisProcess.writeCount += otherProcess.writeCount;
 
+            thisProcess.readLatencies.merge(otherProcess.readLatencies);
+            thisProcess.writeLatencies.merge(otherProcess.writeLatencies);
+
             if (thisProcess.currentSyscall) {
                 // We have an unfinished syscall
                 if (otherProcess.unknownSyscall) {
                     // We need to check, in case we are at the end of the trace
                     uint64_t latency = otherProcess.unknownSyscall->end - thisProcess.currentSyscall->start;
+                    if (otherProcess.unknownSyscall->ret >= 0) {
+                        addToSeries(*thisProcess.currentSyscall, otherProcess.unknownSyscall->end,
+                                    otherProcess.unknownSyscall->ret);
+                        addLatency(thisProcess, thisProcess.currentSyscall->type, latency);
+                    }
                     if (thisProcess.currentSyscall->type == IOType::READ ||
                         thisProcess.currentSyscall->type == IOType::READWRITE) {
                         int64_t ret = otherProcess.unknownSyscall->ret;
@@ -147,44 +303,144 @@ void IoContext::merge(const IoContext &other)
                 }
             }
             thisProcess.currentSyscall = otherProcess.currentSyscall;
+            if (readSketch.isEnabled()) {
+                flushToSketches(thisProcess);
+                if (!thisProcess.currentSyscall && !thisProcess.unknownSyscall) {
+                    tids.erase(tid);
+                }
+            }
         } else {
-            tids[otherProcess.tid] = otherProcess;
+            tids[tid] = otherProcess;
         }
-    }
+    });
 }
 
 void IoContext::handleReadWrite(const tibee::trace::EventValue &event, IOType type)
 {
     uint64_t timestamp = event.getTimestamp();
-    std::string name = event.getName();
-    if (!event.getStreamEventContext()->HasField("tid")) {
+    name_id_t name = NameTable::instance().intern(event.getName());
+    const auto *context = event.getStreamEventContext();
+    if (!context->HasField("tid")) {
         std::cerr << "Missing tid context info" << std::endl;
         return;
     }
-    int tid = event.getStreamEventContext()->GetField("tid")->AsInteger();
-
-    std::string comm = "";
-    if (event.getStreamEventContext()->HasField("procname")) {
-        comm = event.getStreamEventContext()->GetField("procname")->AsString();
-    }
+    int tid = context->GetField("tid")->AsInteger();
 
-    if (!tids.contains(tid)) {
-        IoProcess p;
-        p.tid = tid;
-        p.comm = comm;
-        tids[tid] = p;
+    name_id_t comm = NameTable::EMPTY;
+    if (context->HasField("procname")) {
+        comm = NameTable::instance().intern(context->GetField("procname")->AsString());
     }
-    IoProcess &p = tids[tid];
-    p.currentSyscall = Syscall();
-    p.currentSyscall->type = type;
-    p.currentSyscall->start = timestamp;
-    p.currentSyscall->name = name;
 
+    int fd = -1;
     if (type == IOType::READ || type == IOType::WRITE) {
-        int fd = event.getFields()->GetField("fd")->AsInteger();
-        p.currentSyscall->fd = fd;
+        fd = event.getFields()->GetField("fd")->AsInteger();
     } else if (type == IOType::READWRITE) {
         // TODO: fd analysis
     }
 
+    handleSyscallEntry(timestamp, tid, comm, name, type, fd);
+}
+
+void IoContext::handleSyscallEntry(uint64_t timestamp, int tid, name_id_t comm, name_id_t name, IOType type, int fd)
+{
+    SyscallRecord record = {timestamp, 0, tid, fd, comm, name, type, false};
+    handleSyscalls(&record, 1);
+}
+
+static void writeSyscall(QDataStream &out, const boost::optional<Syscall> &syscall)
+{
+    out << (bool) syscall;
+    if (syscall) {
+        out << (qint32) syscall->type << QString::fromStdString(NameTable::instance().resolve(syscall->name))
+            << (quint64) syscall->start << (quint64) syscall->end
+            << (qint32) syscall->fd << (qint32) syscall->ret << (quint64) syscall->count;
+    }
+}
+
+static void readSyscall(QDataStream &in, boost::optional<Syscall> &syscall)
+{
+    bool hasSyscall;
+    in >> hasSyscall;
+    if (hasSyscall) {
+        qint32 type, fd, ret;
+        QString name;
+        quint64 start, end, count;
+        in >> type >> name >> start >> end >> fd >> ret >> count;
+        syscall = Syscall();
+        syscall->type = static_cast<IOType>(type);
+        syscall->name = NameTable::instance().intern(name.toStdString());
+        syscall->start = start;
+        syscall->end = end;
+        syscall->fd = fd;
+        syscall->ret = ret;
+        syscall->count = count;
+    } else {
+        syscall = boost::none;
+    }
+}
+
+QDataStream &operator<<(QDataStream &out, const IoContext &context)
+{
+    out << (quint32) context.tids.size();
+    context.tids.forEach([&](int, const IoProcess &p) {
+        out << (qint32) p.pid << (qint32) p.tid << (quint64) p.cpu_ns
+            << QString::fromStdString(NameTable::instance().resolve(p.comm));
+        writeSyscall(out, p.currentSyscall);
+        writeSyscall(out, p.unknownSyscall);
+        out << (quint64) p.totalReadLatency << (quint64) p.readCount
+            << (quint64) p.totalWriteLatency << (quint64) p.writeCount
+            << (quint64) p.readBytes << (quint64) p.writeBytes
+            << p.readLatencies << p.writeLatencies;
+    });
+    out << context.series << context.readLatencies << context.writeLatencies
+        << context.readSketch << context.writeSketch;
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, IoContext &context)
+{
+    quint32 numTids;
+    in >> numTids;
+    context.tids.clear();
+    for (quint32 i = 0; i < numTids && in.status() == QDataStream::Ok; i++) {
+        qint32 pid, tid;
+        quint64 cpuNs;
+        QString comm;
+        in >> pid >> tid >> cpuNs >> comm;
+        IoProcess p;
+        p.pid = pid;
+        p.tid = tid;
+        p.cpu_ns = cpuNs;
+        p.comm = NameTable::instance().intern(comm.toStdString());
+        readSyscall(in, p.currentSyscall);
+        readSyscall(in, p.unknownSyscall);
+        quint64 totalReadLatency, readCount, totalWriteLatency, writeCount, readBytes, writeBytes;
+        in >> totalReadLatency >> readCount >> totalWriteLatency >> writeCount >> readBytes >> writeBytes;
+        p.totalReadLatency = totalReadLatency;
+        p.readCount = readCount;
+        p.totalWriteLatency = totalWriteLatency;
+        p.writeCount = writeCount;
+        p.readBytes = readBytes;
+        p.writeBytes = writeBytes;
+        in >> p.readLatencies >> p.writeLatencies;
+        context.tids[tid] = p;
+    }
+    in >> context.series >> context.readLatencies >> context.writeLatencies
+       >> context.readSketch >> context.writeSketch;
+    return in;
+}
+
+QDataStream &operator<<(QDataStream &out, const IoBucket &bucket)
+{
+    out << (quint64) bucket.readBytes << (quint64) bucket.writeBytes;
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, IoBucket &bucket)
+{
+    quint64 readBytes, writeBytes;
+    in >> readBytes >> writeBytes;
+    bucket.readBytes = readBytes;
+    bucket.writeBytes = writeBytes;
+    return in;
 }
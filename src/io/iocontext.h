@@ -19,6 +19,9 @@
 #ifndef IOCONTEXT_H
 #define IOCONTEXT_H
 
+#include "common/latencyhistogram.h"
+#include "common/spacesaving.h"
+#include "common/timeseries.h"
 #include "cpu/cpucontext.h"
 
 #include <trace/BasicTypes.hpp>
@@ -30,7 +33,7 @@ static const std::string IOTypeStrings[] = { "UNKNOWN", "READ", "WRITE", "READWR
 
 struct Syscall {
     IOType type = IOType::UNKNOWN;
-    std::string name {};
+    name_id_t name = NameTable::EMPTY;
     uint64_t start {};
     uint64_t end {};
     int fd = -1;
@@ -38,6 +41,22 @@ struct Syscall {
     uint64_t count {};
 };
 
+/*
+ * Fields of a syscall entry or exit, as handed to the batch handler.
+ * Entries and exits share a record type since they must be handled in
+ * order.
+ */
+struct SyscallRecord {
+    uint64_t timestamp;
+    int64_t ret;	/* exits only */
+    int32_t tid;
+    int32_t fd;		/* entries only */
+    name_id_t comm;
+    name_id_t name;	/* entries only */
+    IOType type;	/* entries only */
+    bool isExit;
+};
+
 struct IoProcess : public Process
 {
     boost::optional<Syscall> currentSyscall {};
@@ -51,8 +70,29 @@ struct IoProcess : public Process
 
     uint64_t readBytes {};
     uint64_t writeBytes {};
+
+    LatencyHistogram readLatencies;
+    LatencyHistogram writeLatencies;
 };
 
+/*
+ * Bytes read and written by the syscalls that returned in a time bucket.
+ */
+struct IoBucket {
+    uint64_t readBytes = 0;
+    uint64_t writeBytes = 0;
+
+    IoBucket &operator+=(const IoBucket &other)
+    {
+        readBytes += other.readBytes;
+        writeBytes += other.writeBytes;
+        return *this;
+    }
+};
+
+QDataStream &operator<<(QDataStream &out, const IoBucket &bucket);
+QDataStream &operator>>(QDataStream &in, IoBucket &bucket);
+
 class IoContext
 {
 public:
@@ -62,18 +102,70 @@ public:
     void handleSysWrite(const tibee::trace::EventValue &event);
     void handleSysReadWrite(const tibee::trace::EventValue &event);
     void handleExitSyscall(const tibee::trace::EventValue &event);
-    void handleEnd();
+    void handleSyscallEntry(uint64_t timestamp, int tid, name_id_t comm, name_id_t name, IOType type, int fd);
+    void handleSyscallExit(uint64_t timestamp, int tid, name_id_t comm, int64_t ret);
+    void handleSyscalls(const SyscallRecord *records, size_t count);
 
     void merge(const IoContext &other);
 
-    const std::list<IoProcess> &getTidsByWrite();
-    const std::list<IoProcess> &getTidsByRead();
+    /*!
+     * \brief Number of counters of the sketches ranking the processes by
+     * bytes read and written, or 0 to keep the exact totals of every
+     * process. With sketches, only the processes with a syscall to match
+     * across chunks are kept.
+     */
+    void setSketchCapacity(size_t value);
+
+    /*!
+     * \brief Get the processes that read or wrote the most bytes, most
+     * first. With sketches, the bytes are lower bounds.
+     */
+    std::vector<IoProcess> getTopTidsByWrite(size_t count) const;
+    std::vector<IoProcess> getTopTidsByRead(size_t count) const;
+
+    /*!
+     * \brief Get the bound on how many bytes the processes returned by
+     * getTopTidsByWrite() and getTopTidsByRead() are below the real ones,
+     * 0 if exact.
+     */
+    uint64_t getTopTidsByWriteError() const;
+    uint64_t getTopTidsByReadError() const;
+
+    /*!
+     * \brief Get the processes with the highest 99th percentile read or
+     * write latency, highest first.
+     */
+    std::vector<IoProcess> getTopTidsByReadLatency(size_t count) const;
+    std::vector<IoProcess> getTopTidsByWriteLatency(size_t count) const;
+
+    /*!
+     * \brief Get the latencies of all the read or write syscalls.
+     */
+    const LatencyHistogram &getReadLatencies() const;
+    const LatencyHistogram &getWriteLatencies() const;
+
+    /*!
+     * \brief Width of the time buckets of the I/O time series, or 0 to
+     * only compute the totals.
+     */
+    void setSeriesWidth(uint64_t value);
+    const TimeSeries<IoBucket> &getSeries() const;
+
+    // Serialization of the map results, for the result cache
+    friend QDataStream &operator<<(QDataStream &out, const IoContext &context);
+    friend QDataStream &operator>>(QDataStream &in, IoContext &context);
 
 private:
-    typedef QHash<int, IoProcess> IoProcessMap;
-    IoProcessMap tids;
-    std::list<IoProcess> sortedTids;
+    FlatMap<IoProcess> tids;
+    TimeSeries<IoBucket> series;
+    LatencyHistogram readLatencies;
+    LatencyHistogram writeLatencies;
+    SpaceSaving readSketch;	/* replace the per process totals when enabled */
+    SpaceSaving writeSketch;
     void handleReadWrite(const tibee::trace::EventValue &event, IOType type);
+    void addToSeries(const Syscall &syscall, uint64_t timestamp, int64_t ret);
+    void addLatency(IoProcess &process, IOType type, uint64_t latency);
+    void flushToSketches(IoProcess &process);
 };
 
 #endif // IOCONTEXT_H
@@ -18,14 +18,20 @@
 
 #include "common/traceanalysis.h"
 #include "count/countanalysis.h"
+#include "countbytype/countbytypeanalysis.h"
 #include "cpu/cpuanalysis.h"
 #include "io/ioanalysis.h"
+#include "sched/schedanalysis.h"
+#include "read/readanalysis.h"
+#include "extract/extractanalysis.h"
+#include "indexstats/indexstatsanalysis.h"
 
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QTimer>
 
 #include <iostream>
+#include <limits>
 
 enum class CommandLineParseResult {
     OK,
@@ -40,11 +46,24 @@ struct Options {
     bool verbose = false;
     bool benchmark = false;
     bool balanced = false;
+    bool coldCache = false;
+    IoEngine ioEngine = IoEngine::MMAP;
+    unsigned int queueDepth = 32;
+    Decoder decoder = Decoder::TIGERBEETLE;
+    QString columnsPath = "";
+    QString cachePath = "";
+    uint64_t windowBegin = 0;
+    uint64_t windowEnd = std::numeric_limits<uint64_t>::max();
+    QString outputPath = "";
+    bool breakdown = false;
+    unsigned int pipelineDecoders = 0;
+    uint64_t seriesWidth = 0;
+    size_t sketchCapacity = 0;
     bool parallel = true;
     QString tracePath = "";
 };
 
-QStringList analysisList = QStringList() << "count" << "cpu" << "io";
+QStringList analysisList = QStringList() << "count" << "count-by-type" << "cpu" << "io" << "sched" << "read" << "extract" << "index-stats";
 
 CommandLineParseResult parseCommandLine(QCommandLineParser &parser, Options &opts, QString *errorMessage) {
     const QCommandLineOption helpOption = parser.addHelpOption();
@@ -62,13 +81,74 @@ CommandLineParseResult parseCommandLine(QCommandLineParser &parser, Options &opt
     const QCommandLineOption balancedOption(QStringList() << "l" << "balanced", "Use balanced parallel analysis.");
     parser.addOption(balancedOption);
 
+    // Optimize I/O for a cold page cache
+    const QCommandLineOption coldCacheOption(QStringList() << "c" << "cold-cache", "Read each stream file sequentially with readahead hints (balanced babeltrace runs only).");
+    parser.addOption(coldCacheOption);
+
+    // I/O engine used to read packets
+    const QCommandLineOption ioEngineOption(QStringList() << "io-engine", "I/O engine used to read packets [ mmap | read | uring ] (read only).",
+                                            "engine", "mmap");
+    parser.addOption(ioEngineOption);
+
+    // Number of reads in flight for the uring engine
+    const QCommandLineOption queueDepthOption(QStringList() << "queue-depth", "Number of packet reads in flight with the uring I/O engine (read only).",
+                                              "depth", "32");
+    parser.addOption(queueDepthOption);
+
+    // Event decoder
+    const QCommandLineOption decoderOption(QStringList() << "decoder", "Event decoder [ tigerbeetle | native ] (count, count-by-type, cpu, io and sched only).",
+                                           "decoder", "tigerbeetle");
+    parser.addOption(decoderOption);
+
+    // Decoding and analysis on separate threads
+    const QCommandLineOption pipelineOption(QStringList() << "pipeline", "Decode each chunk on this many threads, feeding the analysis through lock-free queues (cpu, io and sched with the native decoder only).",
+                                            "decoders", "0");
+    parser.addOption(pipelineOption);
+
+    // Column store used instead of the trace
+    const QCommandLineOption columnsOption(QStringList() << "columns", "Run from a column store in this directory, converting the trace on the first run (cpu and io only).",
+                                           "dir");
+    parser.addOption(columnsOption);
+
+    // Cache of the per chunk results
+    const QCommandLineOption cacheOption(QStringList() << "cache", "Save the result of each chunk in this directory, and reuse it on later runs over the same trace (parallel only).",
+                                         "dir");
+    parser.addOption(cacheOption);
+
+    // Time window
+    const QCommandLineOption beginOption(QStringList() << "begin", "Beginning of the time window, in nanoseconds since the epoch.",
+                                         "timestamp");
+    parser.addOption(beginOption);
+    const QCommandLineOption endOption(QStringList() << "end", "End of the time window, in nanoseconds since the epoch.",
+                                       "timestamp");
+    parser.addOption(endOption);
+
+    // Time series
+    const QCommandLineOption seriesOption(QStringList() << "window", "Also compute a time series with buckets of this width, in nanoseconds, written as CSV to the --output file or the standard output (cpu and io only).",
+                                          "ns");
+    parser.addOption(seriesOption);
+
+    // Approximate process rankings
+    const QCommandLineOption approximateOption(QStringList() << "approximate", "Rank the processes with sketches of this many counters per chunk instead of keeping every process (cpu and io only).",
+                                               "counters");
+    parser.addOption(approximateOption);
+
+    // Output trace of the extract analysis, or time series
+    const QCommandLineOption outputOption(QStringList() << "o" << "output", "Directory where the extract analysis writes the trace, or file where the --window time series is written.",
+                                          "path");
+    parser.addOption(outputOption);
+
+    // Breakdown of the event count
+    const QCommandLineOption breakdownOption(QStringList() << "breakdown", "Also print the number of events of each stream file or CPU and event type (count), or of each CPU and stream file (count-by-type).");
+    parser.addOption(breakdownOption);
+
     // Number of threads to use
     const QCommandLineOption threadOption(QStringList() << "t" << "thread", "Maximum number of threads to use.",
                                           "num threads", "4");
     parser.addOption(threadOption);
 
     // Analysis name
-    const QCommandLineOption analysisOption(QStringList() << "a" << "analysis", "Name of analysis to execute [ count | cpu | io ].",
+    const QCommandLineOption analysisOption(QStringList() << "a" << "analysis", "Name of analysis to execute [ count | count-by-type | cpu | io | sched | read | extract | index-stats ].",
                                             "analysis name", "count");
     parser.addOption(analysisOption);
 
@@ -104,6 +184,14 @@ CommandLineParseResult parseCommandLine(QCommandLineParser &parser, Options &opt
         opts.balanced = true;
     }
 
+    if (parser.isSet(coldCacheOption)) {
+        opts.coldCache = true;
+    }
+
+    if (parser.isSet(breakdownOption)) {
+        opts.breakdown = true;
+    }
+
     if (parser.isSet(serialOption)) {
         opts.parallel = false;
     }
@@ -116,6 +204,78 @@ CommandLineParseResult parseCommandLine(QCommandLineParser &parser, Options &opt
     }
     opts.threads = threads;
 
+    const QString ioEngineString = parser.value(ioEngineOption);
+    if (!parseIoEngine(ioEngineString.toStdString(), opts.ioEngine)) {
+        *errorMessage = "Invalid I/O engine name.";
+        return CommandLineParseResult::Error;
+    }
+
+    const QString queueDepthString = parser.value(queueDepthOption);
+    int queueDepth = queueDepthString.toInt();
+    if (queueDepth <= 0) {
+        *errorMessage = "Queue depth must be 1 or more.";
+        return CommandLineParseResult::Error;
+    }
+    opts.queueDepth = queueDepth;
+
+    const QString decoderString = parser.value(decoderOption);
+    if (!parseDecoder(decoderString.toStdString(), opts.decoder)) {
+        *errorMessage = "Invalid decoder name.";
+        return CommandLineParseResult::Error;
+    }
+
+    const QString pipelineString = parser.value(pipelineOption);
+    bool pipelineOk;
+    int pipelineDecoders = pipelineString.toInt(&pipelineOk);
+    if (!pipelineOk || pipelineDecoders < 0) {
+        *errorMessage = "Number of pipeline decoders must be 0 or more.";
+        return CommandLineParseResult::Error;
+    }
+    opts.pipelineDecoders = pipelineDecoders;
+
+    opts.columnsPath = parser.value(columnsOption);
+    opts.cachePath = parser.value(cacheOption);
+    opts.outputPath = parser.value(outputOption);
+
+    if (parser.isSet(beginOption)) {
+        bool ok;
+        opts.windowBegin = parser.value(beginOption).toULongLong(&ok);
+        if (!ok) {
+            *errorMessage = "Invalid begin timestamp.";
+            return CommandLineParseResult::Error;
+        }
+    }
+    if (parser.isSet(endOption)) {
+        bool ok;
+        opts.windowEnd = parser.value(endOption).toULongLong(&ok);
+        if (!ok) {
+            *errorMessage = "Invalid end timestamp.";
+            return CommandLineParseResult::Error;
+        }
+    }
+    if (opts.windowBegin > opts.windowEnd) {
+        *errorMessage = "The begin timestamp must not be after the end timestamp.";
+        return CommandLineParseResult::Error;
+    }
+
+    if (parser.isSet(seriesOption)) {
+        bool ok;
+        opts.seriesWidth = parser.value(seriesOption).toULongLong(&ok);
+        if (!ok || opts.seriesWidth == 0) {
+            *errorMessage = "The time series window must be 1 ns or more.";
+            return CommandLineParseResult::Error;
+        }
+    }
+
+    if (parser.isSet(approximateOption)) {
+        bool ok;
+        opts.sketchCapacity = parser.value(approximateOption).toULongLong(&ok);
+        if (!ok || opts.sketchCapacity == 0) {
+            *errorMessage = "The number of sketch counters must be 1 or more.";
+            return CommandLineParseResult::Error;
+        }
+    }
+
     const QString analysisString = parser.value(analysisOption);
     if (!analysisList.contains(analysisString)) {
         *errorMessage = "Invalid analysis name.";
@@ -123,6 +283,29 @@ CommandLineParseResult parseCommandLine(QCommandLineParser &parser, Options &opt
     }
     opts.analysisName = analysisString;
 
+    // The other analyses read through babeltrace or the native decoder,
+    // which don't go through the packet reader
+    if ((parser.isSet(ioEngineOption) || parser.isSet(queueDepthOption)) && analysisString != "read") {
+        *errorMessage = "The --io-engine and --queue-depth options only apply to the read analysis.";
+        return CommandLineParseResult::Error;
+    }
+
+    // Only the CPU and I/O analyses have a quantity to bucket in time
+    if (opts.seriesWidth && analysisString != "cpu" && analysisString != "io") {
+        *errorMessage = "The --window option only applies to the cpu and io analyses.";
+        return CommandLineParseResult::Error;
+    }
+
+    // Only the balanced babeltrace runs dispatch chunks stream by stream,
+    // the option would otherwise be silently ignored
+    QStringList coldCacheAnalyses = QStringList() << "count" << "count-by-type" << "cpu" << "sched";
+    if (opts.coldCache && (!opts.balanced || !opts.parallel || opts.decoder == Decoder::NATIVE ||
+                           !opts.columnsPath.isEmpty() || !coldCacheAnalyses.contains(analysisString))) {
+        *errorMessage = "The --cold-cache option only applies to parallel --balanced runs of the count, "
+                        "count-by-type, cpu and sched analyses, with the babeltrace decoder and without --columns.";
+        return CommandLineParseResult::Error;
+    }
+
     const QStringList positionalArguments = parser.positionalArguments();
     if (positionalArguments.isEmpty()) {
         *errorMessage = "Argument '<path/to/trace>' missing.";
@@ -140,10 +323,20 @@ CommandLineParseResult parseCommandLine(QCommandLineParser &parser, Options &opt
 AbstractTraceAnalysis* getAnalysisFromName(QString analysisName, QCoreApplication *app) {
     if (analysisName == "count") {
         return new CountAnalysis(app);
+    } else if (analysisName == "count-by-type") {
+        return new CountByTypeAnalysis(app);
     } else if (analysisName == "cpu") {
         return new CpuAnalysis(app);
     } else if (analysisName == "io") {
         return new IoAnalysis(app);
+    } else if (analysisName == "sched") {
+        return new SchedAnalysis(app);
+    } else if (analysisName == "read") {
+        return new ReadAnalysis(app);
+    } else if (analysisName == "extract") {
+        return new ExtractAnalysis(app);
+    } else if (analysisName == "index-stats") {
+        return new IndexStatsAnalysis(app);
     }
     return nullptr;
 }
@@ -197,6 +390,19 @@ int main(int argc, char *argv[]) {
     analysis->setVerbose(opts.verbose);
     analysis->setDoBenchmark(opts.benchmark);
     analysis->setBalanced(opts.balanced);
+    analysis->setColdCache(opts.coldCache);
+    analysis->setIoEngine(opts.ioEngine);
+    analysis->setQueueDepth(opts.queueDepth);
+    analysis->setDecoder(opts.decoder);
+    analysis->setColumnsPath(opts.columnsPath);
+    analysis->setCachePath(opts.cachePath);
+    analysis->setWindowBegin(opts.windowBegin);
+    analysis->setWindowEnd(opts.windowEnd);
+    analysis->setOutputPath(opts.outputPath);
+    analysis->setBreakdown(opts.breakdown);
+    analysis->setPipelineDecoders(opts.pipelineDecoders);
+    analysis->setSeriesWidth(opts.seriesWidth);
+    analysis->setSketchCapacity(opts.sketchCapacity);
     analysis->setIsParallel(opts.parallel);
 
     QObject::connect(analysis, SIGNAL(finished()), &a, SLOT(quit()));
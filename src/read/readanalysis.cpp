@@ -0,0 +1,142 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "readanalysis.h"
+#include "common/traceindex.h"
+#include "common/utils.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QtConcurrent>
+
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+
+ReadResult ReadAnalysis::doMap(const ReadStream &stream)
+{
+    ReadResult result;
+    std::unique_ptr<PacketReader> reader = PacketReader::create(stream.engine, stream.path,
+                                                                stream.packets, stream.queueDepth);
+    if (!reader) {
+        return result;
+    }
+
+    // Touch every byte, like a decoder would
+    PacketBuffer packet;
+    while (reader->next(packet)) {
+        const char *data = packet.data;
+        for (size_t i = 0; i + sizeof(uint64_t) <= packet.size; i += sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, data + i, sizeof(word));
+            result.checksum ^= word;
+        }
+        result.packets++;
+        result.bytes += packet.size;
+    }
+
+    return result;
+}
+
+void ReadAnalysis::doReduce(ReadResult &final, const ReadResult &intermediate)
+{
+    final.packets += intermediate.packets;
+    final.bytes += intermediate.bytes;
+    final.checksum ^= intermediate.checksum;
+}
+
+bool ReadAnalysis::isOrderedReduce()
+{
+    return false;
+}
+
+void ReadAnalysis::doExecuteParallel()
+{
+    std::vector<ReadStream> streams = getStreams();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QThreadPool::globalInstance()->setMaxThreadCount(this->threads);
+    auto future = QtConcurrent::mappedReduced(streams.begin(), streams.end(),
+                                              &ReadAnalysis::doMap, &ReadAnalysis::doReduce,
+                                              QtConcurrent::UnorderedReduce);
+    ReadResult data = future.result();
+
+    printResults(data, timer.nsecsElapsed());
+}
+
+void ReadAnalysis::doExecuteSerial()
+{
+    std::vector<ReadStream> streams = getStreams();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    ReadResult data;
+    for (const ReadStream &stream : streams) {
+        doReduce(data, doMap(stream));
+    }
+
+    printResults(data, timer.nsecsElapsed());
+}
+
+std::vector<ReadStream> ReadAnalysis::getStreams()
+{
+    std::vector<ReadStream> streams;
+
+    // Only the indices are needed, the trace isn't opened
+    TraceIndex traceIndex;
+    if (!traceIndex.open(tracePath)) {
+        return streams;
+    }
+
+    for (const StreamIndex &streamIndex : traceIndex.getStreams()) {
+        ReadStream stream;
+        stream.path = QDir(tracePath).absoluteFilePath(QString::fromStdString(streamIndex.name)).toStdString();
+        for (const PacketHeader &header : streamIndex.index->getPacketIndex()) {
+            if (header.tsReal.timestampEnd >= windowBegin && header.tsReal.timestampBegin <= windowEnd) {
+                stream.packets.push_back(header);
+            }
+        }
+        stream.engine = ioEngine;
+        stream.queueDepth = queueDepth;
+        streams.push_back(std::move(stream));
+    }
+
+    return streams;
+}
+
+void ReadAnalysis::printResults(const ReadResult &data, uint64_t nanoseconds)
+{
+    std::string line(80, '-');
+    double seconds = nanoseconds / 1000000000.0;
+    uint64_t throughput = seconds > 0 ? data.bytes / seconds : 0;
+
+    std::cout << line << std::endl;
+    std::cout << "Result of read analysis" << std::endl << std::endl;
+    std::cout << std::setw(20) << std::left << "I/O engine" << ioEngineName(ioEngine) << std::endl;
+    std::cout << std::setw(20) << std::left << "Packets" << data.packets << std::endl;
+    std::cout << std::setw(20) << std::left << "Size" << convertSize(data.bytes) << std::endl;
+    std::cout << std::setw(20) << std::left << "Throughput" << convertSize(throughput) << "/s" << std::endl;
+    if (verbose) {
+        std::cout << std::setw(20) << std::left << "Checksum" << std::hex << data.checksum << std::dec << std::endl;
+    }
+    std::cout << line << std::endl;
+}
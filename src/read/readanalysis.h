@@ -0,0 +1,65 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef READANALYSIS_H
+#define READANALYSIS_H
+
+#include "common/traceanalysis.h"
+#include "common/packetreader.h"
+
+/*
+ * A stream file and the packets to read from it.
+ */
+struct ReadStream {
+    std::string path;
+    Indices packets;
+    IoEngine engine;
+    unsigned int queueDepth;
+};
+
+struct ReadResult {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t checksum = 0;
+};
+
+/*!
+ * \brief The ReadAnalysis class reads every packet of the trace with the
+ * selected I/O engine, without decoding. It measures the raw throughput
+ * of an engine, to compare it with the others.
+ */
+class ReadAnalysis : public AbstractTraceAnalysis
+{
+    Q_OBJECT
+public:
+    ReadAnalysis(QObject *parent) : AbstractTraceAnalysis(parent) { }
+
+    static ReadResult doMap(const ReadStream &stream);
+    static void doReduce(ReadResult &final, const ReadResult &intermediate);
+
+protected:
+    virtual void doExecuteParallel();
+    virtual void doExecuteSerial();
+    virtual bool isOrderedReduce();
+
+private:
+    std::vector<ReadStream> getStreams();
+    void printResults(const ReadResult &data, uint64_t nanoseconds);
+};
+
+#endif // READANALYSIS_H
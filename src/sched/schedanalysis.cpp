@@ -0,0 +1,263 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "schedanalysis.h"
+#include "schedcontext.h"
+#include "common/pipeline.h"
+#include "common/recordbatch.h"
+#include "common/utils.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// sched_waking is traced by newer kernels before sched_wakeup
+static const std::vector<std::string> wakeupEvents = {"sched_waking", "sched_wakeup", "sched_wakeup_new"};
+
+SchedWorker::SchedWorker(int id, TraceSet &set, timestamp_t *begin, timestamp_t *end, bool verbose) :
+    TraceWorker(id, set, begin, end, verbose)
+{
+}
+
+SchedContext SchedWorker::doMap() const
+{
+    if (getCtfTrace()) {
+        return doMapNative();
+    }
+
+    const TraceSet &set = getTraceSet();
+    TraceSet::Iterator iter = set.between(getBeginPos(), getEndPos());
+    TraceSet::Iterator endIter = set.end();
+
+    SchedContext data;
+
+    // The handlers are normally resolved once by the analysis
+    std::shared_ptr<const EventDispatch<SchedContext>> ownDispatch;
+    const EventDispatch<SchedContext> *dispatch = getDispatch();
+    if (!dispatch) {
+        ownDispatch = createDispatch(getMetadata());
+        dispatch = ownDispatch.get();
+    }
+
+    // Iterate through events
+    uint64_t count = 0;
+    for ((void)iter; iter != endIter; ++iter) {
+        count++;
+        dispatch->dispatch(data, *iter);
+    }
+
+    if (getVerbose()) {
+        const timestamp_t *begin = getBeginPos();
+        const timestamp_t *end = getEndPos();
+        std::string beginString = begin ? std::to_string(*begin) : "START";
+        std::string endString = end ? std::to_string(*end) : "END";
+        std::cout << "Worker " << getId() << " processed " << count << " events between timestamps "
+                  << beginString << " and " << endString << std::endl;
+    }
+
+    return data;
+}
+
+SchedContext SchedWorker::doMapNative() const
+{
+    const CtfTrace &trace = *getCtfTrace();
+    const timestamp_t *begin = getBeginPos();
+    const timestamp_t *end = getEndPos();
+    SchedContext data;
+
+    // Resolve the fields of each event once, indexed by event class since
+    // each channel has its own event ids
+    struct SchedFields {
+        bool isSched = false;
+        bool isSwitch = false;
+        CtfFieldHandle tid;
+        CtfFieldHandle comm;
+    };
+    std::vector<SchedFields> events(trace.getNumEventClasses());
+    auto addEvent = [&](const std::string &eventName, bool isSwitch) {
+        for (const CtfEventClass *eventClass : trace.getEventClasses(eventName)) {
+            SchedFields &fields = events[eventClass->index];
+            fields.isSched = true;
+            fields.isSwitch = isSwitch;
+            fields.tid = trace.getFieldHandle(*eventClass, CtfScope::FIELDS, isSwitch ? "next_tid" : "tid");
+            fields.comm = trace.getFieldHandle(*eventClass, CtfScope::FIELDS, isSwitch ? "next_comm" : "comm");
+        }
+    };
+    for (const std::string &eventName : wakeupEvents) {
+        addEvent(eventName, false);
+    }
+    addEvent("sched_switch", true);
+
+    NameTable &names = NameTable::instance();
+    auto decode = [&](const CtfEvent &event, SchedRecord &record) -> bool {
+        const SchedFields &fields = events[event.getEventClass().index];
+        if (!fields.isSched) {
+            return false;
+        }
+        const char *comm;
+        size_t commLength;
+        event.getText(fields.comm, comm, commLength);
+        record.timestamp = event.getTimestamp();
+        record.cpu = fields.isSwitch ? event.getCpu() : -1;
+        record.tid = event.getInteger(fields.tid);
+        record.comm = names.intern(comm, commLength);
+        record.isSwitch = fields.isSwitch;
+        return true;
+    };
+    auto handle = [&](const SchedRecord *records, size_t size) {
+        data.handleSchedEvents(records, size);
+    };
+
+    uint64_t count = 0;
+    if (getPipelineDecoders() > 0) {
+        Pipeline<SchedRecord> pipeline(getPipelineDecoders());
+        if (!pipeline.run(trace, begin, end, getProjection(), decode, handle)) {
+            setFailed();
+        }
+        for (const PipelineStageStats &stats : pipeline.getDecoderStats()) {
+            count += stats.events;
+        }
+        if (getVerbose()) {
+            pipeline.printStats(std::cout, getId());
+        }
+    } else {
+        // Events are decoded into batches of records, then handed to the analysis
+        RecordBatch<SchedRecord> batch;
+        SchedRecord record;
+        CtfTrace::Iterator iter = trace.between(begin, end, getProjection());
+        CtfTrace::Iterator endIter = trace.end();
+        for ((void)iter; iter != endIter; ++iter) {
+            count++;
+            if (!decode(*iter, record)) {
+                continue;
+            }
+            batch.add() = record;
+            if (batch.isFull()) {
+                handle(batch.data(), batch.size());
+                batch.clear();
+            }
+        }
+        handle(batch.data(), batch.size());
+        if (iter.hasFailed()) {
+            setFailed();
+        }
+    }
+
+    if (getVerbose()) {
+        std::string beginString = begin ? std::to_string(*begin) : "START";
+        std::string endString = end ? std::to_string(*end) : "END";
+        std::cout << "Worker " << getId() << " decoded " << count << " events between timestamps "
+                  << beginString << " and " << endString << std::endl;
+    }
+
+    return data;
+}
+
+std::shared_ptr<const EventDispatch<SchedContext>> SchedWorker::createDispatch(const TraceMetadata &metadata)
+{
+    std::shared_ptr<EventDispatch<SchedContext>> dispatch = std::make_shared<EventDispatch<SchedContext>>(metadata);
+    dispatch->add(metadata, wakeupEvents, &SchedContext::handleSchedWakeup);
+    dispatch->add(metadata, {"sched_switch"}, &SchedContext::handleSchedSwitch);
+    return dispatch;
+}
+
+CtfProjection SchedWorker::getProjection()
+{
+    CtfProjection projection;
+    for (const std::string &eventName : wakeupEvents) {
+        projection.addEvent(eventName, {"tid", "comm"});
+    }
+    projection.addEvent("sched_switch", {"next_tid", "next_comm"});
+    return projection;
+}
+
+void SchedWorker::doReduce(SchedContext &final, const SchedContext &intermediate)
+{
+    final.merge(intermediate);
+}
+
+bool SchedAnalysis::isOrderedReduce()
+{
+    return true;
+}
+
+void SchedAnalysis::doExecuteSerial()
+{
+    TraceSet set;
+    set.addTrace(this->tracePath.toStdString());
+    TraceMetadata metadata(set);
+
+    SchedContext data;
+    std::shared_ptr<const Dispatch> dispatch = createDispatch(metadata);
+
+    // Iterate through events
+    TraceSet::Iterator iter = set.between(getWindowBeginPos(), getWindowEndPos());
+    TraceSet::Iterator endIter = set.end();
+    for ((void)iter; iter != endIter; ++iter) {
+        dispatch->dispatch(data, *iter);
+    }
+
+    data.handleEnd();
+
+    printResults(data);
+}
+
+std::shared_ptr<const SchedAnalysis::Dispatch> SchedAnalysis::createDispatch(const TraceMetadata &metadata)
+{
+    return SchedWorker::createDispatch(metadata);
+}
+
+void SchedAnalysis::doEnd(SchedContext &data)
+{
+    data.handleEnd();
+}
+
+void SchedAnalysis::printResults(SchedContext &data)
+{
+    std::string line(80, '-');
+    int max = 10;
+    int colWidth = 30;
+
+    std::cout << line << std::endl;
+    std::cout << "Result of sched analysis" << std::endl << std::endl;
+    std::cout << "Wakeup Latency" << std::endl << std::endl;
+    printLatencyHeader("CPU", colWidth);
+    printLatencies("All", data.getLatencies(), colWidth);
+    const std::vector<LatencyHistogram> &cpuLatencies = data.getCpuLatencies();
+    for (size_t cpu = 0; cpu < cpuLatencies.size(); cpu++) {
+        if (!cpuLatencies[cpu].getCount()) {
+            continue;
+        }
+        std::stringstream ss;
+        ss << "CPU " << cpu;
+        printLatencies(ss.str(), cpuLatencies[cpu], colWidth);
+    }
+
+    std::cout << line << std::endl;
+    printLatencyHeader("Process", colWidth);
+    for (const WakeupTask &task : data.getTopTidsByLatency(max)) {
+        if (!task.latencies.getCount()) {
+            continue;
+        }
+        std::stringstream ss;
+        ss << NameTable::instance().resolve(task.comm) << " (" << task.tid << ")";
+        printLatencies(ss.str(), task.latencies, colWidth);
+    }
+}
@@ -0,0 +1,77 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCHEDANALYSIS_H
+#define SCHEDANALYSIS_H
+
+#include "common/traceanalysis.h"
+#include "schedcontext.h"
+
+class SchedWorker : public TraceWorker<SchedContext>
+{
+public:
+    SchedWorker(int id, TraceSet &set, timestamp_t *begin, timestamp_t *end, bool verbose = false);
+    SchedWorker(SchedWorker &other) = delete;
+    SchedWorker &operator =(const SchedWorker &other) = delete;
+
+    SchedWorker(SchedWorker &&other) : TraceWorker<SchedContext>(std::move(other)) {}
+    SchedWorker &operator =(SchedWorker &&other)
+    {
+        TraceWorker<SchedContext>::operator =(std::move(other));
+        return *this;
+    }
+
+    virtual SchedContext doMap() const;
+    SchedContext doMapNative() const;
+    static std::shared_ptr<const EventDispatch<SchedContext>> createDispatch(const TraceMetadata &metadata);
+    static CtfProjection getProjection();
+    static void doReduce(SchedContext &final, const SchedContext &intermediate);
+};
+
+class SchedAnalysis : public TraceAnalysis<SchedWorker, SchedContext>
+{
+    Q_OBJECT
+public:
+    SchedAnalysis(QObject *parent) : TraceAnalysis(parent) {}
+
+protected:
+    virtual bool isOrderedReduce();
+    virtual QString getCacheName()
+    {
+        return "sched";
+    }
+    virtual int getCacheVersion()
+    {
+        return 2;
+    }
+    virtual bool supportsNativeDecoder()
+    {
+        return true;
+    }
+    virtual std::shared_ptr<const Dispatch> createDispatch(const TraceMetadata &metadata);
+    virtual void doExecuteSerial();
+    virtual void printResults(SchedContext &data);
+    virtual void doEnd(SchedContext &data);
+    virtual void doExecuteParallelBalanced()
+    {
+        // Wakeups and switches of a task are on different streams
+        std::cerr << "Balanced analysis not yet supported." << std::endl;
+    }
+};
+
+#endif // SCHEDANALYSIS_H
@@ -0,0 +1,215 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "schedcontext.h"
+
+SchedContext::SchedContext()
+{
+}
+
+void SchedContext::handleSchedWakeup(const tibee::trace::EventValue &event)
+{
+    const auto *fields = event.getFields();
+    SchedRecord record;
+    record.timestamp = event.getTimestamp();
+    record.cpu = -1;
+    record.tid = fields->GetField("tid")->AsInteger();
+    record.comm = NameTable::instance().intern(fields->GetField("comm")->AsString());
+    record.isSwitch = false;
+    handleSchedEvents(&record, 1);
+}
+
+void SchedContext::handleSchedSwitch(const tibee::trace::EventValue &event)
+{
+    const auto *fields = event.getFields();
+    SchedRecord record;
+    record.timestamp = event.getTimestamp();
+    record.cpu = event.getStreamPacketContext()->GetField("cpu_id")->AsUInteger();
+    record.tid = fields->GetField("next_tid")->AsInteger();
+    record.comm = NameTable::instance().intern(fields->GetField("next_comm")->AsString());
+    record.isSwitch = true;
+    handleSchedEvents(&record, 1);
+}
+
+void SchedContext::handleSchedEvents(const SchedRecord *records, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const SchedRecord &record = records[i];
+
+        // The idle task is never woken up
+        if (record.tid == 0) {
+            continue;
+        }
+        WakeupTask &task = tasks[record.tid];
+        task.tid = record.tid;
+        task.comm = record.comm;
+
+        if (!record.isSwitch) {
+            // sched_waking and sched_wakeup both trace the same wakeup,
+            // keep the first one
+            if (!task.wakeup) {
+                task.wakeup = record.timestamp;
+            }
+            continue;
+        }
+
+        if (!task.switchedIn) {
+            // The wakeup may be in an earlier chunk
+            task.switchedIn = true;
+            task.firstWakeup = task.wakeup;
+            task.firstSwitch = record.timestamp;
+            task.firstCpu = record.cpu;
+        } else if (task.wakeup) {
+            addLatency(task, record.cpu, record.timestamp - task.wakeup);
+        }
+        // Preempted tasks are switched in again without a wakeup
+        task.wakeup = 0;
+    }
+}
+
+void SchedContext::handleEnd()
+{
+    tasks.forEach([&](int tid, const WakeupTask &) {
+        WakeupTask &task = tasks[tid];
+        if (task.switchedIn && task.firstWakeup) {
+            addLatency(task, task.firstCpu, task.firstSwitch - task.firstWakeup);
+        }
+        task.switchedIn = false;
+    });
+}
+
+void SchedContext::merge(const SchedContext &other)
+{
+    latencies.merge(other.latencies);
+    if (cpuLatencies.size() < other.cpuLatencies.size()) {
+        cpuLatencies.resize(other.cpuLatencies.size());
+    }
+    for (size_t cpu = 0; cpu < other.cpuLatencies.size(); cpu++) {
+        cpuLatencies[cpu].merge(other.cpuLatencies[cpu]);
+    }
+
+    // Do fixing
+    other.tasks.forEach([&](int tid, const WakeupTask &otherTask) {
+        WakeupTask &task = tasks[tid];
+        task.tid = tid;
+        task.comm = otherTask.comm;
+        task.latencies.merge(otherTask.latencies);
+
+        if (!otherTask.switchedIn) {
+            // Keep the oldest wakeup, the task has not run since
+            if (!task.wakeup) {
+                task.wakeup = otherTask.wakeup;
+            }
+            return;
+        }
+
+        // The first switch in of the other chunk runs our pending wakeup,
+        // or else the one it saw itself
+        uint64_t wakeup = task.wakeup ? task.wakeup : otherTask.firstWakeup;
+        if (task.switchedIn) {
+            if (wakeup) {
+                addLatency(task, otherTask.firstCpu, otherTask.firstSwitch - wakeup);
+            }
+        } else {
+            // We did not see the task run either, an earlier chunk may
+            // still hold an older wakeup
+            task.switchedIn = true;
+            task.firstWakeup = wakeup;
+            task.firstSwitch = otherTask.firstSwitch;
+            task.firstCpu = otherTask.firstCpu;
+        }
+        task.wakeup = otherTask.wakeup;
+    });
+}
+
+const LatencyHistogram &SchedContext::getLatencies() const
+{
+    return latencies;
+}
+
+const std::vector<LatencyHistogram> &SchedContext::getCpuLatencies() const
+{
+    return cpuLatencies;
+}
+
+std::vector<WakeupTask> SchedContext::getTopTidsByLatency(size_t count) const
+{
+    return tasks.getTopBy(count, [](const WakeupTask &task) {
+        return task.latencies.getPercentile(99);
+    });
+}
+
+void SchedContext::addLatency(WakeupTask &task, int cpu, uint64_t latency)
+{
+    task.latencies.add(latency);
+    if (cpu >= 0) {
+        if ((size_t) cpu >= cpuLatencies.size()) {
+            cpuLatencies.resize(cpu + 1);
+        }
+        cpuLatencies[cpu].add(latency);
+    }
+    latencies.add(latency);
+}
+
+QDataStream &operator<<(QDataStream &out, const SchedContext &context)
+{
+    out << (quint32) context.tasks.size();
+    context.tasks.forEach([&](int, const WakeupTask &task) {
+        out << (qint32) task.tid << QString::fromStdString(NameTable::instance().resolve(task.comm))
+            << (quint64) task.wakeup << task.switchedIn << (quint64) task.firstWakeup
+            << (quint64) task.firstSwitch << (qint32) task.firstCpu << task.latencies;
+    });
+    out << (quint32) context.cpuLatencies.size();
+    for (const LatencyHistogram &histogram : context.cpuLatencies) {
+        out << histogram;
+    }
+    out << context.latencies;
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, SchedContext &context)
+{
+    quint32 numTasks;
+    in >> numTasks;
+    context.tasks.clear();
+    for (quint32 i = 0; i < numTasks && in.status() == QDataStream::Ok; i++) {
+        qint32 tid, firstCpu;
+        QString comm;
+        quint64 wakeup, firstWakeup, firstSwitch;
+        bool switchedIn;
+        WakeupTask task;
+        in >> tid >> comm >> wakeup >> switchedIn >> firstWakeup >> firstSwitch >> firstCpu >> task.latencies;
+        task.tid = tid;
+        task.comm = NameTable::instance().intern(comm.toStdString());
+        task.wakeup = wakeup;
+        task.switchedIn = switchedIn;
+        task.firstWakeup = firstWakeup;
+        task.firstSwitch = firstSwitch;
+        task.firstCpu = firstCpu;
+        context.tasks[tid] = task;
+    }
+    quint32 numCpus;
+    in >> numCpus;
+    context.cpuLatencies.clear();
+    for (quint32 i = 0; i < numCpus && in.status() == QDataStream::Ok; i++) {
+        context.cpuLatencies.emplace_back();
+        in >> context.cpuLatencies.back();
+    }
+    in >> context.latencies;
+    return in;
+}
@@ -0,0 +1,109 @@
+/* Copyright (c) 2015 Fabien Reumont-Locke <fabien.reumont-locke@polymtl.ca>
+ *
+ * This file is part of lttng-parallel-analyses.
+ *
+ * lttng-parallel-analyses is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * lttng-parallel-analyses is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with lttng-parallel-analyses.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCHEDCONTEXT_H
+#define SCHEDCONTEXT_H
+
+#include "common/flatmap.h"
+#include "common/latencyhistogram.h"
+#include "common/nametable.h"
+#include "cpu/cpucontext.h"
+
+#include <trace/value/EventValue.hpp>
+
+#include <QDataStream>
+#include <vector>
+
+/*
+ * Fields of a wakeup or of a sched_switch, as handed to the batch
+ * handler. Both share a record type since they must be handled in order.
+ */
+struct SchedRecord {
+    uint64_t timestamp;
+    int32_t cpu;	/* switches only */
+    int32_t tid;	/* task woken up or switched in */
+    name_id_t comm;
+    bool isSwitch;
+};
+
+struct WakeupTask
+{
+    int tid = UNKNOWN_TID;
+    name_id_t comm = NameTable::EMPTY;
+    uint64_t wakeup = 0;	/* wakeup waiting for the task to run, or 0 */
+
+    /* First switch in of the task and the wakeup it ran, left to the merge
+     * since an earlier chunk may hold an older wakeup */
+    bool switchedIn = false;
+    uint64_t firstWakeup = 0;
+    uint64_t firstSwitch = 0;
+    int firstCpu = -1;
+
+    LatencyHistogram latencies;
+};
+
+class SchedContext
+{
+public:
+    SchedContext();
+
+    void handleSchedWakeup(const tibee::trace::EventValue &event);
+    void handleSchedSwitch(const tibee::trace::EventValue &event);
+    void handleSchedEvents(const SchedRecord *records, size_t count);
+
+    /*!
+     * \brief Account for the first switch in of each task, once nothing
+     * can be merged before this context.
+     */
+    void handleEnd();
+
+    /*!
+     * \brief Merge the context of the chunk following this one.
+     */
+    void merge(const SchedContext &other);
+
+    /*!
+     * \brief Get the wakeup latencies of all the tasks.
+     */
+    const LatencyHistogram &getLatencies() const;
+
+    /*!
+     * \brief Get the wakeup latencies of the tasks run by each CPU,
+     * indexed by CPU id.
+     */
+    const std::vector<LatencyHistogram> &getCpuLatencies() const;
+
+    /*!
+     * \brief Get the tasks with the highest 99th percentile wakeup
+     * latency, highest first.
+     */
+    std::vector<WakeupTask> getTopTidsByLatency(size_t count) const;
+
+    // Serialization of the map results, for the result cache
+    friend QDataStream &operator<<(QDataStream &out, const SchedContext &context);
+    friend QDataStream &operator>>(QDataStream &in, SchedContext &context);
+
+private:
+    void addLatency(WakeupTask &task, int cpu, uint64_t latency);
+
+    FlatMap<WakeupTask> tasks;
+    std::vector<LatencyHistogram> cpuLatencies;
+    LatencyHistogram latencies;
+};
+
+#endif // SCHEDCONTEXT_H